@@ -142,6 +142,40 @@ namespace StackExchange.Redis
             return (RedisValue[])await db.ExecuteAsync("GRID.RANGE", key, rowStart, rowEnd, columnStart, columnEnd);
         }
 
+        /// <summary>
+        /// Query a range of rows and columns in a grid a column at a time.
+        /// 
+        /// If the start row or column is less than the end row or column the results will obey the direction.
+        /// </summary>
+        /// <param name="db">The database in which the grid is stored.</param>
+        /// <param name="key">The key against which the grid is associated.</param>
+        /// <param name="rowStart">The first row where 0 is the first element and -1 is the last.</param>
+        /// <param name="rowEnd">The last row where 0 is the first element and -1 is the last.</param>
+        /// <param name="columnStart">The first column where 0 is the first element and -1 is the last.</param>
+        /// <param name="columnEnd">The last column where 0 is the first element and -1 is the last.</param>
+        /// <returns>A one dimentional array of the range ordered column-wise.</returns>
+        public static RedisValue[] GridRangeColumns(this IDatabase db, RedisKey key, int rowStart, int rowEnd, int columnStart, int columnEnd)
+        {
+            return (RedisValue[])db.Execute("GRID.RANGE", key, rowStart, rowEnd, columnStart, columnEnd, "ORDER", "COLUMNS");
+        }
+
+        /// <summary>
+        /// Query a range of rows and columns in a grid a column at a time asynchronously.
+        /// 
+        /// If the start row or column is less than the end row or column the results will obey the direction.
+        /// </summary>
+        /// <param name="db">The database in which the grid is stored.</param>
+        /// <param name="key">The key against which the grid is associated.</param>
+        /// <param name="rowStart">The first row where 0 is the first element and -1 is the last.</param>
+        /// <param name="rowEnd">The last row where 0 is the first element and -1 is the last.</param>
+        /// <param name="columnStart">The first column where 0 is the first element and -1 is the last.</param>
+        /// <param name="columnEnd">The last column where 0 is the first element and -1 is the last.</param>
+        /// <returns>A one dimentional array of the range ordered column-wise.</returns>
+        public static async Task<RedisValue[]> GridRangeColumnsAsync(this IDatabase db, RedisKey key, int rowStart, int rowEnd, int columnStart, int columnEnd)
+        {
+            return (RedisValue[])await db.ExecuteAsync("GRID.RANGE", key, rowStart, rowEnd, columnStart, columnEnd, "ORDER", "COLUMNS");
+        }
+
         /// <summary>
         /// Set a range of values in a grid.
         /// </summary>
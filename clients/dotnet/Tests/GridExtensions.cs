@@ -19,8 +19,8 @@ namespace Tests
             }
 
             // Check it's values.
-            for (var i = a.GetLowerBound(0); i < a.GetUpperBound(0); ++i)
-                for (var j = a.GetLowerBound(1); j < a.GetUpperBound(1); ++j)
+            for (var i = a.GetLowerBound(0); i <= a.GetUpperBound(0); ++i)
+                for (var j = a.GetLowerBound(1); j <= a.GetUpperBound(1); ++j)
                     if (!Equals(a[i, j], b[i, j]))
                         return false;
 
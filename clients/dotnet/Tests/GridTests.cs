@@ -129,6 +129,197 @@ namespace Tests
             db.GridDim(key, 0, 0);
         }
 
+        [TestMethod]
+        public void ShouldCopyThenWriteIndependently()
+        {
+            var redis = ConnectionMultiplexer.Connect("10.11.153.125");
+            var db = redis.GetDatabase();
+
+            foreach (var storage in Storages)
+            {
+                // Create and store a grid, then copy it.
+                var key = Guid.NewGuid().ToString();
+                var copyKey = Guid.NewGuid().ToString();
+                var source = GridExtensions.CreateOrdinalGrid(3, 4);
+                DimWithStorage(db, key, storage, source);
+                Assert.AreEqual("OK", (string)db.Execute("GRID.COPY", key, copyKey));
+
+                // A write to the copy is not seen by the source.
+                db.GridSet(copyKey, 1, 1, new[,] { { "a" } });
+                Assert.IsTrue(GridExtensions.Equals(source, db.GridDump(key).AsStringGrid()), storage);
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(copyKey).AsStringGrid(), new[,] { { "0", "1", "2", "3" }, { "4", "a", "6", "7" }, { "8", "9", "10", "11" } }), storage);
+
+                // A write to the source is not seen by the copy.
+                db.GridSet(key, 2, 3, new[,] { { "b" } });
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { "0", "1", "2", "3" }, { "4", "5", "6", "7" }, { "8", "9", "10", "b" } }), storage);
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(copyKey).AsStringGrid(), new[,] { { "0", "1", "2", "3" }, { "4", "a", "6", "7" }, { "8", "9", "10", "11" } }), storage);
+
+                // Delete them.
+                db.GridDim(key, 0, 0);
+                db.GridDim(copyKey, 0, 0);
+            }
+        }
+
+        [TestMethod]
+        public void ShouldDropOldestRowsWhenCapped()
+        {
+            var redis = ConnectionMultiplexer.Connect("10.11.153.125");
+            var db = redis.GetDatabase();
+
+            foreach (var storage in new[] { "ARRAY", "ROW" })
+            {
+                // Create an empty capped grid, and push past the cap.
+                var key = Guid.NewGuid().ToString();
+                db.GridDim(key, 0, 2, "CAPPED", "2", "STORAGE", storage);
+                Assert.AreEqual(1, (int)db.Execute("GRID.PUSHROW", key, "09:30", "101.5"));
+                Assert.AreEqual(2, (int)db.Execute("GRID.PUSHROW", key, "09:31", "101.7"));
+                Assert.AreEqual(2, (int)db.Execute("GRID.PUSHROW", key, "09:32", "101.6"));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { "09:31", "101.7" }, { "09:32", "101.6" } }), storage);
+
+                // Appending drops as many of the oldest rows as were appended.
+                Assert.AreEqual(2, (int)db.Execute("GRID.APPENDROWS", key, "09:33", "101.8", "09:34", "101.9", "09:35", "102.0"));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { "09:34", "101.9" }, { "09:35", "102.0" } }), storage);
+
+                // The grid can not be dimensioned past its cap.
+                AssertServerError(() => db.GridDim(key, 3, 2), "Rows exceed the capped rows of the grid");
+
+                // Delete it.
+                db.GridDim(key, 0, 0);
+            }
+
+            // Only array and row storage can be capped.
+            AssertServerError(() => db.GridDim(Guid.NewGuid().ToString(), 0, 2, "CAPPED", "2", "STORAGE", "COLUMNAR"), "Capped grids must use ARRAY or ROW storage");
+        }
+
+        [TestMethod]
+        public void ShouldInsertAndDeleteRowsAndColumns()
+        {
+            var redis = ConnectionMultiplexer.Connect("10.11.153.125");
+            var db = redis.GetDatabase();
+
+            foreach (var storage in Storages)
+            {
+                // Create and store a grid.
+                var key = Guid.NewGuid().ToString();
+                DimWithStorage(db, key, storage, GridExtensions.CreateOrdinalGrid(3, 3));
+
+                // Insert an empty row, then delete the first row.
+                Assert.AreEqual("OK", (string)db.Execute("GRID.INSERTROWS", key, 1, 1));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { "0", "1", "2" }, { null, null, null }, { "3", "4", "5" }, { "6", "7", "8" } }), storage);
+                Assert.AreEqual("OK", (string)db.Execute("GRID.DELETEROWS", key, 0, 1));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { null, null, null }, { "3", "4", "5" }, { "6", "7", "8" } }), storage);
+
+                // Insert an empty column, then delete the last column.
+                Assert.AreEqual("OK", (string)db.Execute("GRID.INSERTCOLS", key, 1, 1));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { null, null, null, null }, { "3", null, "4", "5" }, { "6", null, "7", "8" } }), storage);
+                Assert.AreEqual("OK", (string)db.Execute("GRID.DELETECOLS", key, -1, 1));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { null, null, null }, { "3", null, "4" }, { "6", null, "7" } }), storage);
+
+                // Delete it.
+                db.GridDim(key, 0, 0);
+            }
+        }
+
+        [TestMethod]
+        public void ShouldSort()
+        {
+            var redis = ConnectionMultiplexer.Connect("10.11.153.125");
+            var db = redis.GetDatabase();
+
+            foreach (var storage in Storages)
+            {
+                // Create and store a grid.
+                var key = Guid.NewGuid().ToString();
+                var storeKey = Guid.NewGuid().ToString();
+                var source = new[,] { { "USD", "50" }, { "EUR", "250" }, { "GBP", "75" }, { "USD", "300" } };
+                DimWithStorage(db, key, storage, source);
+
+                // Sort a copy, leaving the source as it is.
+                Assert.AreEqual("OK", (string)db.Execute("GRID.SORT", key, "BY", 1, "NUMERIC", "STORE", storeKey));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(storeKey).AsStringGrid(), new[,] { { "USD", "50" }, { "GBP", "75" }, { "EUR", "250" }, { "USD", "300" } }), storage);
+                Assert.IsTrue(GridExtensions.Equals(source, db.GridDump(key).AsStringGrid()), storage);
+
+                // Sort in place, and stored onto itself.
+                Assert.AreEqual("OK", (string)db.Execute("GRID.SORT", key, "BY", 1, "DESC", "NUMERIC"));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { "USD", "300" }, { "EUR", "250" }, { "GBP", "75" }, { "USD", "50" } }), storage);
+                Assert.AreEqual("OK", (string)db.Execute("GRID.SORT", key, "BY", 1, "NUMERIC", "STORE", key));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new[,] { { "USD", "50" }, { "GBP", "75" }, { "EUR", "250" }, { "USD", "300" } }), storage);
+
+                // Delete them.
+                db.GridDim(key, 0, 0);
+                db.GridDim(storeKey, 0, 0);
+            }
+        }
+
+        [TestMethod]
+        public void ShouldTrackChanges()
+        {
+            var redis = ConnectionMultiplexer.Connect("10.11.153.125");
+            var db = redis.GetDatabase();
+
+            // Create and store a grid, every cell of which has changed.
+            var key = Guid.NewGuid().ToString();
+            db.GridDim(key, 3, 2, "USD", "50", "EUR", "250", "GBP", "75");
+            var changes = (RedisResult[])db.Execute("GRID.CHANGES", key, 0);
+            Assert.AreEqual(3, (int)changes[1]);
+            Assert.AreEqual(2, (int)changes[2]);
+            Assert.AreEqual(0, (int)changes[3]);
+            AssertRectangles(changes, new[,] { { 0, 2, 0, 1 } });
+
+            // Only the cell set has changed since.
+            var version = (long)changes[0];
+            db.GridSet(key, 1, 1, new[,] { { "260" } });
+            changes = (RedisResult[])db.Execute("GRID.CHANGES", key, version);
+            Assert.IsTrue((long)changes[0] > version);
+            AssertRectangles(changes, new[,] { { 1, 1, 1, 1 } });
+
+            // Nothing has changed since the latest version.
+            version = (long)changes[0];
+            changes = (RedisResult[])db.Execute("GRID.CHANGES", key, version);
+            Assert.AreEqual(version, (long)changes[0]);
+            AssertRectangles(changes, new int[0, 4]);
+
+            // Inserting a row changes the rows after it.
+            db.Execute("GRID.INSERTROWS", key, 2, 1);
+            changes = (RedisResult[])db.Execute("GRID.CHANGES", key, version);
+            Assert.AreEqual(4, (int)changes[1]);
+            AssertRectangles(changes, new[,] { { 2, 3, 0, 1 } });
+
+            // Delete it.
+            db.GridDim(key, 0, 0);
+        }
+
+        [TestMethod]
+        public void ShouldHandleGridWithoutColumns()
+        {
+            var redis = ConnectionMultiplexer.Connect("10.11.153.125");
+            var db = redis.GetDatabase();
+
+            foreach (var storage in Storages)
+            {
+                // Create a grid with rows but no columns.
+                var key = Guid.NewGuid().ToString();
+                db.GridDim(key, 3, 0, "STORAGE", storage);
+
+                // There are no columns to append or push.
+                AssertServerError(() => db.Execute("GRID.APPENDROWS", key, "a"), "The grid has no columns");
+                AssertServerError(() => db.Execute("GRID.PUSHROW", key, "a"), "The grid has no columns");
+
+                // Rows can still be inserted and deleted.
+                Assert.AreEqual("OK", (string)db.Execute("GRID.INSERTROWS", key, 1, 2));
+                Assert.AreEqual(5, db.GridShape(key)[0], storage);
+                Assert.AreEqual("OK", (string)db.Execute("GRID.DELETEROWS", key, 0, 1));
+                Assert.AreEqual(4, db.GridShape(key)[0], storage);
+
+                // Inserting columns gives empty cells.
+                Assert.AreEqual("OK", (string)db.Execute("GRID.INSERTCOLS", key, 0, 2));
+                Assert.IsTrue(GridExtensions.Equals(db.GridDump(key).AsStringGrid(), new string[4, 2]), storage);
+
+                // Delete it.
+                db.GridDim(key, 0, 0);
+            }
+        }
+
         public void Resize(IDatabase db, int startRows, int startColumns, int endRows, int endColumns)
         {
             // Create and store a grid.
@@ -160,5 +351,39 @@ namespace Tests
             // Delete it.
             db.GridDim(key, 0, 0);
         }
+
+        private static readonly string[] Storages = { "ARRAY", "ROW", "COLUMNAR", "SPARSE", "TILE" };
+
+        public void DimWithStorage(IDatabase db, string key, string storage, string[,] source)
+        {
+            // The options are followed by no values, so the values are set afterwards.
+            db.GridDim(key, source.GetRowCount(), source.GetColumnCount(), "STORAGE", storage);
+            db.GridSet(key, 0, 0, source);
+        }
+
+        public void AssertServerError(Action action, string message)
+        {
+            try
+            {
+                action();
+                Assert.Fail("Should throw on previous call");
+            }
+            catch (RedisServerException error)
+            {
+                Assert.AreEqual(message, error.Message);
+            }
+        }
+
+        public void AssertRectangles(RedisResult[] changes, int[,] expected)
+        {
+            var rectangles = (RedisResult[])changes[4];
+            Assert.AreEqual(expected.GetLength(0), rectangles.Length);
+            for (var i = 0; i < rectangles.Length; ++i)
+            {
+                var bounds = (RedisResult[])rectangles[i];
+                for (var j = 0; j < 4; ++j)
+                    Assert.AreEqual(expected[i, j], (int)bounds[j]);
+            }
+        }
     }
 }
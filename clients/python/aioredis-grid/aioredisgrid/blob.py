@@ -0,0 +1,90 @@
+"""Support for the packed binary grid format used by GRID.RANGEBLOB,
+GRID.LOADBLOB and GRID.SETBLOB
+"""
+
+import struct
+
+MAGIC = b'GRB1'
+
+TYPE_INT64 = 1
+TYPE_DOUBLE = 2
+TYPE_STRING = 3
+
+def _align(n):
+    return (n + 7) & ~7
+
+def unpack_grid(data):
+    """Unpack a blob into a list of columns, each a list of values.
+
+    Numeric columns hold int or float values, string columns hold bytes, and
+    empty cells are None. With numpy a numeric column can instead be read with
+    numpy.frombuffer(data, '<i8' or '<f8', rows, offset + bitmap size).
+
+    :raises ValueError: if the data is not a grid blob
+    """
+    data = memoryview(data)
+    if bytes(data[:4]) != MAGIC:
+        raise ValueError("not a grid blob")
+    rows, columns, _ = struct.unpack_from('<III', data, 4)
+    types = bytes(data[16:16 + columns])
+    offsets = struct.unpack_from('<%dQ' % columns, data, 16 + _align(columns))
+    bitmap_size = _align((rows + 7) // 8)
+
+    unpacked = []
+    for column_type, offset in zip(types, offsets):
+        bitmap = data[offset:offset + bitmap_size]
+        valid = [bitmap[r // 8] >> (r % 8) & 1 for r in range(rows)]
+        start = offset + bitmap_size
+        if column_type == TYPE_STRING:
+            positions = struct.unpack_from('<%dI' % (rows + 1), data, start)
+            start += _align(4 * (rows + 1))
+            values = [bytes(data[start + positions[r]:start + positions[r + 1]]) for r in range(rows)]
+        else:
+            values = struct.unpack_from(('<%dq' if column_type == TYPE_INT64 else '<%dd') % rows, data, start)
+        unpacked.append([value if is_valid else None for value, is_valid in zip(values, valid)])
+    return unpacked
+
+def _pad(buf):
+    buf.extend(bytes(_align(len(buf)) - len(buf)))
+
+def pack_grid(columns):
+    """Pack a list of columns into a blob.
+
+    Each column is a tuple of (type, values) where type is one of TYPE_INT64,
+    TYPE_DOUBLE or TYPE_STRING. String values may be str or bytes, and None
+    marks an empty cell. Every column must have the same number of values.
+    """
+    rows = len(columns[0][1]) if columns else 0
+    header = bytearray(MAGIC)
+    header.extend(struct.pack('<III', rows, len(columns), 0))
+    header.extend(bytes(column_type for column_type, _ in columns))
+    _pad(header)
+
+    body = bytearray()
+    offsets = []
+    start = len(header) + 8 * len(columns)
+    for column_type, values in columns:
+        if len(values) != rows:
+            raise ValueError("columns must have the same number of rows")
+        offsets.append(start + len(body))
+        bitmap = bytearray((rows + 7) // 8)
+        for r, value in enumerate(values):
+            if value is not None:
+                bitmap[r // 8] |= 1 << (r % 8)
+        _pad(bitmap)
+        body.extend(bitmap)
+        if column_type == TYPE_STRING:
+            encoded = [b'' if value is None else value if isinstance(value, bytes) else str(value).encode('utf-8') for value in values]
+            positions = [0]
+            for value in encoded:
+                positions.append(positions[-1] + len(value))
+            body.extend(struct.pack('<%dI' % (rows + 1), *positions))
+            _pad(body)
+            body.extend(b''.join(encoded))
+        else:
+            fmt = '<%dq' if column_type == TYPE_INT64 else '<%dd'
+            body.extend(struct.pack(fmt % rows, *(0 if value is None else value for value in values)))
+        _pad(body)
+
+    header.extend(struct.pack('<%dQ' % len(columns), *offsets))
+    return bytes(header + body)
@@ -4,6 +4,7 @@
 import pandas as pd
 from aioredis.util import _NOTSET
 from aioredisgrid.grid import wait_make_grid
+from aioredisgrid.blob import pack_grid, TYPE_INT64, TYPE_DOUBLE, TYPE_STRING
 
 async def wait_make_dataframe(fut):
     unpacked = await wait_make_grid(fut)
@@ -20,18 +21,38 @@ def _encode(value):
     else:
         return str(value)
 
+def _column_type(dtypes):
+    if all(dtype.kind in 'iu' for dtype in dtypes):
+        return TYPE_INT64
+    elif all(dtype.kind == 'f' for dtype in dtypes):
+        return TYPE_DOUBLE
+    else:
+        return TYPE_STRING
+
+def _pack_column(column_type, values):
+    if column_type == TYPE_INT64:
+        return (column_type, [int(x) for x in values])
+    elif column_type == TYPE_DOUBLE:
+        return (column_type, [None if pd.isnull(x) else float(x) for x in values])
+    else:
+        return (column_type, [_encode(x) for x in values])
+
 class DataFrameCommandsMixin:
     """DataFrame commands mixin
     """
 
     def grid_save_df(self, key, df):
         """Save the dataframe
+
+        Each series is stored as a row holding the name, the dtype and the
+        values, and the grid is sent as a single packed blob.
         """
-        columns, rows = df.shape
-        values = [(name, series.dtype.name, *series.tolist()) for name, series in df.iteritems()]
-        columns += 2
-        values = [_encode(x) for sublist in values for x in sublist]
-        return self.execute(b'GRID.DIM', key, rows, columns, *values)
+        names = [str(name) for name in df.columns]
+        dtypes = [series.dtype.name for _, series in df.iteritems()]
+        column_type = _column_type(df.dtypes)
+        columns = [(TYPE_STRING, names), (TYPE_STRING, dtypes)]
+        columns += [_pack_column(column_type, row) for row in df.itertuples(index=False)]
+        return self.execute(b'GRID.LOADBLOB', key, pack_grid(columns))
         
     
     def grid_load_df(self, key, *, encoding=_NOTSET):
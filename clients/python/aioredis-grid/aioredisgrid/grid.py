@@ -3,13 +3,14 @@
 
 from aioredis.util import _NOTSET
 
-async def wait_make_grid(fut):
-    """Transform a grid dump into a list of lists"""
+async def wait_make_grid(fut, by_columns=False):
+    """Transform a grid dump into a list of lists, one for each row or for each column"""
     res = await fut
     if res in (b'QUEUED', 'QUEUED'):
         return res
-    _, columns = res[:2]
-    unpacked = [res[x:x+columns] for x in range(2, len(res), columns)]
+    rows, columns = res[:2]
+    count = rows if by_columns else columns
+    unpacked = [res[x:x+count] for x in range(2, len(res), count)]
     return unpacked
 
 class GridCommandsMixin:
@@ -17,8 +18,11 @@ class GridCommandsMixin:
     Support for commands provided by the RedisGrid module.
     """
 
-    def grid_dim(self, key, rows, columns, *values):
-        """Dimension a grid, and optionally populate it's values
+    def grid_dim(self, key, rows, columns, *values, capped=None, storage=None):
+        """Dimension a grid, and optionally populate it's values.
+        A capped grid holds at most capped rows, pushing out its oldest rows.
+        The storage (ARRAY, ROW, COLUMNAR, SPARSE or TILE) replaces the one the module was loaded with.
+        The options are sent before the values.
 
         :raises TypeError: if rows or columns is not set
         """
@@ -26,10 +30,43 @@ class GridCommandsMixin:
             raise TypeError("rows argument must be int")
         if not isinstance(columns, int):
             raise TypeError("columns argument must be int")
-        return self.execute(b'GRID.DIM', key, rows, columns, *values)
+        args = [b'CAPPED', capped] if capped is not None else []
+        if storage is not None:
+            args.extend((b'STORAGE', storage))
+        return self.execute(b'GRID.DIM', key, rows, columns, *args, *values)
         
-    def grid_range(self, key, row_start, row_end, column_start, column_end, *, encoding=_NOTSET):
-        """Returns the specified elements of the grid stored at key
+    def grid_copy(self, source, destination, replace=False):
+        """Copies the grid stored at source to destination. The copy shares
+        its storage with the source until either grid is changed.
+        """
+        args = [b'REPLACE'] if replace else []
+        return self.execute(b'GRID.COPY', source, destination, *args)
+
+    def grid_load_blob(self, key, blob):
+        """Dimension a grid and populate it's values from a blob.
+        See aioredisgrid.blob.pack_grid.
+        """
+        return self.execute(b'GRID.LOADBLOB', key, blob)
+
+    def grid_set_blob(self, key, row_start, row_end, column_start, column_end, blob):
+        """Sets the values in a grid stored at key from a blob matching the range.
+
+        :raises TypeError: if row_start, row_end, column_start or column_end is not set
+        """
+        if not isinstance(row_start, int):
+            raise TypeError("row_start argument must be int")
+        if not isinstance(row_end, int):
+            raise TypeError("row_end argument must be int")
+        if not isinstance(column_start, int):
+            raise TypeError("column_start argument must be int")
+        if not isinstance(column_end, int):
+            raise TypeError("column_end argument must be int")
+        return self.execute(b'GRID.SETBLOB', key, row_start, row_end, column_start, column_end, blob)
+
+    def grid_range(self, key, row_start, row_end, column_start, column_end, *, order=None, step=None, encoding=_NOTSET):
+        """Returns the specified elements of the grid stored at key,
+        a row at a time or a column at a time when order is COLUMNS.
+        A step tuple of (rows, columns) returns every given row and column.
 
         :raises TypeError: if row_start, row_end, column_start or column_end is not set
         """
@@ -41,8 +78,105 @@ class GridCommandsMixin:
             raise TypeError("column_start argument must be int")
         if not isinstance(column_end, int):
             raise TypeError("column_end argument must be int")
-        return self.execute(b'GRID.RANGE', key, row_start, row_end, column_start, column_end, encoding=encoding)
+        args = [b'STEP', step[0], step[1]] if step is not None else []
+        if order is not None:
+            args.extend((b'ORDER', order))
+        return self.execute(b'GRID.RANGE', key, row_start, row_end, column_start, column_end, *args, encoding=encoding)
+
+    def grid_downsample(self, key, row_start, row_end, column_start, column_end, bucket_rows):
+        """Returns the first, last, lowest and highest numbers of each column for
+        buckets of bucket_rows rows of the specified range of the grid stored at key.
+
+        :raises TypeError: if a range bound or bucket_rows is not an int
+        """
+        for bound in (row_start, row_end, column_start, column_end, bucket_rows):
+            if not isinstance(bound, int):
+                raise TypeError("range and bucket_rows arguments must be int")
+        return self.execute(b'GRID.DOWNSAMPLE', key, row_start, row_end, column_start, column_end, bucket_rows)
+
+    def grid_where(self, key, *conditions, select=None):
+        """Returns the indexes of the rows of the grid stored at key which match the conditions,
+        given as column, operator and value joined by AND or OR, for example 7, '>', 100.
+        A select tuple of (column_start, column_end) follows each index with the values of those columns.
+        """
+        args = [b'SELECT', select[0], select[1]] if select is not None else []
+        return self.execute(b'GRID.WHERE', key, *conditions, *args)
+
+    def grid_index_create(self, key, column, index_type='HASH'):
+        """Indexes a column of the grid stored at key, with a HASH index for lookups of values
+        or a SORTED index for lookups of values and ranges.
+        """
+        return self.execute(b'GRID.INDEX', b'CREATE', key, column, index_type)
+
+    def grid_index_drop(self, key, column):
+        """Drops the index on a column of the grid stored at key, returning whether there was one."""
+        return self.execute(b'GRID.INDEX', b'DROP', key, column)
+
+    def grid_lookup(self, key, column, value, select=None):
+        """Returns the indexes of the rows of the grid stored at key whose indexed column holds value.
+        A select tuple of (column_start, column_end) follows each index with the values of those columns.
+        """
+        args = [b'SELECT', select[0], select[1]] if select is not None else []
+        return self.execute(b'GRID.LOOKUP', key, column, value, *args)
+
+    def grid_lookup_range(self, key, column, min_value, max_value, select=None):
+        """Returns the indexes of the rows of the grid stored at key whose column, which must have
+        a SORTED index, holds a value from min_value to max_value, in the order of their values.
+        A select tuple of (column_start, column_end) follows each index with the values of those columns.
+        """
+        args = [b'SELECT', select[0], select[1]] if select is not None else []
+        return self.execute(b'GRID.LOOKUPRANGE', key, column, min_value, max_value, *args)
     
+    def grid_sort(self, key, column, desc=False, by=None, store=None):
+        """Sorts the rows of the grid stored at key by a column, from the highest value when desc is set.
+        By NUMERIC sorts the numbers ahead of the other cells, and by ALPHA sorts every cell by its text.
+        With store the grid is left as it is and the sorted grid is stored at that key.
+        """
+        args = [b'DESC'] if desc else []
+        if by is not None:
+            args.append(by)
+        if store is not None:
+            args.extend((b'STORE', store))
+        return self.execute(b'GRID.SORT', key, b'BY', column, *args)
+
+    def grid_changes(self, key, since):
+        """Returns the version of the grid stored at key, its rows and columns, the rows dropped from
+        its front, and the rectangles changed since a version as lists of
+        [row_start, row_end, column_start, column_end]. Since 0 returns the whole grid.
+        """
+        return self.execute(b'GRID.CHANGES', key, since)
+
+    def grid_mrange(self, *ranges, encoding=_NOTSET):
+        """Returns the specified elements of several grids in one command.
+        Each range is a tuple of (key, row_start, row_end, column_start, column_end),
+        the reply holds a list of elements for each range or None for a missing key.
+
+        :raises TypeError: if a range bound is not an int
+        """
+        args = []
+        for key, row_start, row_end, column_start, column_end in ranges:
+            for bound in (row_start, row_end, column_start, column_end):
+                if not isinstance(bound, int):
+                    raise TypeError("range arguments must be int")
+            args.extend((key, row_start, row_end, column_start, column_end))
+        return self.execute(b'GRID.MRANGE', *args, encoding=encoding)
+
+    def grid_range_blob(self, key, row_start, row_end, column_start, column_end):
+        """Returns the specified elements of the grid stored at key packed into
+        a single binary blob. See aioredisgrid.blob.unpack_grid.
+
+        :raises TypeError: if row_start, row_end, column_start or column_end is not set
+        """
+        if not isinstance(row_start, int):
+            raise TypeError("row_start argument must be int")
+        if not isinstance(row_end, int):
+            raise TypeError("row_end argument must be int")
+        if not isinstance(column_start, int):
+            raise TypeError("column_start argument must be int")
+        if not isinstance(column_end, int):
+            raise TypeError("column_end argument must be int")
+        return self.execute(b'GRID.RANGEBLOB', key, row_start, row_end, column_start, column_end)
+
     def grid_shape(self, key):
         """Returns a tuple (rows,columns) of the grid stored at key.
         """
@@ -63,9 +197,87 @@ class GridCommandsMixin:
             raise TypeError("column_end argument must be int")
         return self.execute(b"GRID.SET", key, row_start, row_end, column_start, column_end, *values)
    
-    def grid_dump(self, key):
-        """Returns the entire grid stored at key.
+    def grid_mset(self, key, *ranges):
+        """Sets the values in several ranges of the grid stored at key in one command.
+        Each range is a tuple of (row_start, row_end, column_start, column_end, values).
+
+        :raises TypeError: if a range bound is not an int
+        """
+        args = []
+        for row_start, row_end, column_start, column_end, values in ranges:
+            for bound in (row_start, row_end, column_start, column_end):
+                if not isinstance(bound, int):
+                    raise TypeError("range arguments must be int")
+            args.extend((row_start, row_end, column_start, column_end))
+            args.extend(values)
+        return self.execute(b"GRID.MSET", key, *args)
+
+    def grid_mset_cells(self, key, *cells):
+        """Sets single cells of the grid stored at key in one command.
+        Each cell is a tuple of (row, column, value).
+
+        :raises TypeError: if a row or column is not an int
+        """
+        args = []
+        for row, column, value in cells:
+            if not isinstance(row, int) or not isinstance(column, int):
+                raise TypeError("row and column arguments must be int")
+            args.extend((row, column, value))
+        return self.execute(b"GRID.MSET", key, b"CELLS", *args)
+
+    def grid_append_rows(self, key, *values):
+        """Appends rows of values to the grid stored at key and returns the new number of rows.
+        The number of values must be a multiple of the columns of the grid.
+        """
+        return self.execute(b"GRID.APPENDROWS", key, *values)
+
+    def grid_push_row(self, key, *values):
+        """Pushes a row of values onto the grid stored at key and returns the new number of rows.
+        A capped grid which is full drops its oldest row.
+        """
+        return self.execute(b"GRID.PUSHROW", key, *values)
+
+    def grid_insert_rows(self, key, row, count):
+        """Inserts count empty rows at row of the grid stored at key.
+
+        :raises TypeError: if row or count is not an int
+        """
+        if not isinstance(row, int) or not isinstance(count, int):
+            raise TypeError("row and count arguments must be int")
+        return self.execute(b"GRID.INSERTROWS", key, row, count)
+
+    def grid_delete_rows(self, key, row, count):
+        """Deletes count rows from row of the grid stored at key.
+
+        :raises TypeError: if row or count is not an int
+        """
+        if not isinstance(row, int) or not isinstance(count, int):
+            raise TypeError("row and count arguments must be int")
+        return self.execute(b"GRID.DELETEROWS", key, row, count)
+
+    def grid_insert_columns(self, key, column, count):
+        """Inserts count empty columns at column of the grid stored at key.
+
+        :raises TypeError: if column or count is not an int
+        """
+        if not isinstance(column, int) or not isinstance(count, int):
+            raise TypeError("column and count arguments must be int")
+        return self.execute(b"GRID.INSERTCOLS", key, column, count)
+
+    def grid_delete_columns(self, key, column, count):
+        """Deletes count columns from column of the grid stored at key.
+
+        :raises TypeError: if column or count is not an int
+        """
+        if not isinstance(column, int) or not isinstance(count, int):
+            raise TypeError("column and count arguments must be int")
+        return self.execute(b"GRID.DELETECOLS", key, column, count)
+
+    def grid_dump(self, key, order=None):
+        """Returns the entire grid stored at key, as a list for each row
+        or a list for each column when order is COLUMNS.
         """
-        fut = self.execute(b"GRID.DUMP", key)   
-        return wait_make_grid(fut)
+        args = [b'ORDER', order] if order is not None else []
+        fut = self.execute(b"GRID.DUMP", key, *args)   
+        return wait_make_grid(fut, by_columns=order is not None and order.upper() == 'COLUMNS')
 
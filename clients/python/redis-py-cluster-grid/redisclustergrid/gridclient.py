@@ -3,8 +3,10 @@ import rediscluster
 from redis.client import bool_ok
 
 def _parse_grid_dump(response, **options):
-    _, columns = response[:2]
-    unpacked = [response[x:x+columns] for x in range(2, len(response), columns)]
+    rows, columns = response[:2]
+    # A dump ordered by columns is unpacked into a list for each column.
+    count = rows if options.get('by_columns') else columns
+    unpacked = [response[x:x+count] for x in range(2, len(response), count)]
     return unpacked
 
 class StrictRedisCluster(rediscluster.StrictRedisCluster):
@@ -17,16 +19,68 @@ class StrictRedisCluster(rediscluster.StrictRedisCluster):
                 'GRID.DUMP': _parse_grid_dump,
                 'GRID.DIM': bool_ok,
                 'GRID.SET': bool_ok,
+                'GRID.INSERTROWS': bool_ok,
+                'GRID.DELETEROWS': bool_ok,
+                'GRID.INSERTCOLS': bool_ok,
+                'GRID.DELETECOLS': bool_ok,
+                'GRID.SORT': bool_ok,
                 "GRID.SHAPE": tuple
                 }
         for k, v in six.iteritems(MODULE_CALLBACKS):
             self.set_response_callback(k, v)
     
+    def _determine_slot(self, *args):
+        # The key of GRID.INDEX follows its subcommand.
+        if len(args) > 2 and str(args[0]).upper() == 'GRID.INDEX':
+            return self.connection_pool.nodes.keyslot(args[2])
+        return super()._determine_slot(*args)
+    
     def grid_dim(self, key, rows, columns, *args):
         return self.execute_command("GRID.DIM", key, rows, columns, *args)
     
-    def grid_range(self, key, row_start, row_end, column_start, column_end):
-        return self.execute_command("GRID.RANGE", key, row_start, row_end, column_start, column_end)
+    def grid_range(self, key, row_start, row_end, column_start, column_end, order=None, step=None):
+        args = ["STEP", step[0], step[1]] if step else []
+        if order:
+            args.extend(("ORDER", order))
+        return self.execute_command("GRID.RANGE", key, row_start, row_end, column_start, column_end, *args)
+    
+    def grid_downsample(self, key, row_start, row_end, column_start, column_end, bucket_rows):
+        return self.execute_command("GRID.DOWNSAMPLE", key, row_start, row_end, column_start, column_end, bucket_rows)
+    
+    def grid_where(self, key, *conditions, select=None):
+        args = ["SELECT", select[0], select[1]] if select else []
+        return self.execute_command("GRID.WHERE", key, *conditions, *args)
+    
+    def grid_index_create(self, key, column, index_type="HASH"):
+        return self.execute_command("GRID.INDEX", "CREATE", key, column, index_type)
+    
+    def grid_index_drop(self, key, column):
+        return self.execute_command("GRID.INDEX", "DROP", key, column)
+    
+    def grid_lookup(self, key, column, value, select=None):
+        args = ["SELECT", select[0], select[1]] if select else []
+        return self.execute_command("GRID.LOOKUP", key, column, value, *args)
+    
+    def grid_lookup_range(self, key, column, min_value, max_value, select=None):
+        args = ["SELECT", select[0], select[1]] if select else []
+        return self.execute_command("GRID.LOOKUPRANGE", key, column, min_value, max_value, *args)
+    
+    def grid_sort(self, key, column, desc=False, by=None, store=None):
+        args = ["DESC"] if desc else []
+        if by:
+            args.append(by)
+        if store is not None:
+            args.extend(("STORE", store))
+        return self.execute_command("GRID.SORT", key, "BY", column, *args)
+    
+    def grid_changes(self, key, since):
+        return self.execute_command("GRID.CHANGES", key, since)
+    
+    def grid_mrange(self, *ranges):
+        args = []
+        for rect in ranges:
+            args.extend(rect)
+        return self.execute_command("GRID.MRANGE", *args)
     
     def grid_shape(self, key):
         return self.execute_command("GRID.SHAPE", key)
@@ -34,6 +88,25 @@ class StrictRedisCluster(rediscluster.StrictRedisCluster):
     def grid_set(self, key, row_start, row_end, column_start, column_end, *args):
         return self.execute_command("GRID.SET", key, row_start, row_end, column_start, column_end, *args)
     
-    def grid_dump(self, key):
-        return self.execute_command("GRID.DUMP", key)
+    def grid_append_rows(self, key, *args):
+        return self.execute_command("GRID.APPENDROWS", key, *args)
+    
+    def grid_push_row(self, key, *args):
+        return self.execute_command("GRID.PUSHROW", key, *args)
+    
+    def grid_insert_rows(self, key, row, count):
+        return self.execute_command("GRID.INSERTROWS", key, row, count)
+    
+    def grid_delete_rows(self, key, row, count):
+        return self.execute_command("GRID.DELETEROWS", key, row, count)
+    
+    def grid_insert_columns(self, key, column, count):
+        return self.execute_command("GRID.INSERTCOLS", key, column, count)
+    
+    def grid_delete_columns(self, key, column, count):
+        return self.execute_command("GRID.DELETECOLS", key, column, count)
+    
+    def grid_dump(self, key, order=None):
+        args = ["ORDER", order] if order else []
+        return self.execute_command("GRID.DUMP", key, *args, by_columns=(order or "").upper() == "COLUMNS")
 
@@ -0,0 +1,241 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <strings.h>
+
+#include "utils.h"
+#include "aggregate.h"
+
+int Aggregate_parseFunction(const char *name)
+{
+    if (strcasecmp(name, "SUM") == 0)
+        return AGGREGATE_SUM;
+    if (strcasecmp(name, "MEAN") == 0)
+        return AGGREGATE_MEAN;
+    if (strcasecmp(name, "MIN") == 0)
+        return AGGREGATE_MIN;
+    if (strcasecmp(name, "MAX") == 0)
+        return AGGREGATE_MAX;
+    if (strcasecmp(name, "COUNT") == 0)
+        return AGGREGATE_COUNT;
+    if (strcasecmp(name, "STDDEV") == 0)
+        return AGGREGATE_STDDEV;
+    return 0;
+}
+
+void Aggregate_init(struct Aggregate *a)
+{
+    a->count = 0;
+    a->sum = 0;
+    a->mean = 0;
+    a->m2 = 0;
+    a->min = INFINITY;
+    a->max = -INFINITY;
+    a->first = 0;
+    a->last = 0;
+}
+
+void Aggregate_add(struct Aggregate *a, double value)
+{
+    if (a->count == 0)
+        a->first = value;
+    a->last = value;
+    ++a->count;
+    a->sum += value;
+    double delta = value - a->mean;
+    a->mean += delta / a->count;
+    a->m2 += delta * (value - a->mean);
+    if (value < a->min)
+        a->min = value;
+    if (value > a->max)
+        a->max = value;
+}
+
+void Aggregate_merge(struct Aggregate *a, const struct Aggregate *b)
+{
+    if (b->count == 0)
+        return;
+
+    if (a->count == 0)
+    {
+        *a = *b;
+        return;
+    }
+
+    long long count = a->count + b->count;
+    double delta = b->mean - a->mean;
+    a->mean += delta * b->count / count;
+    a->m2 += b->m2 + delta * delta * ((double)a->count * b->count / count);
+    a->sum += b->sum;
+    a->count = count;
+    if (b->min < a->min)
+        a->min = b->min;
+    if (b->max > a->max)
+        a->max = b->max;
+    a->last = b->last;
+}
+
+// The block kernels keep four independent accumulators so the compiler can
+// keep them in vector registers, and take a second pass over the (cached)
+// block for the squared deviations.
+static void Aggregate_blockDoubles(struct Aggregate *a, const double *v, size_t n)
+{
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    double lo0 = INFINITY, lo1 = INFINITY, hi0 = -INFINITY, hi1 = -INFINITY;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        s0 += v[i];
+        s1 += v[i + 1];
+        s2 += v[i + 2];
+        s3 += v[i + 3];
+        lo0 = min(lo0, min(v[i], v[i + 1]));
+        lo1 = min(lo1, min(v[i + 2], v[i + 3]));
+        hi0 = max(hi0, max(v[i], v[i + 1]));
+        hi1 = max(hi1, max(v[i + 2], v[i + 3]));
+    }
+    for (; i < n; ++i)
+    {
+        s0 += v[i];
+        lo0 = min(lo0, v[i]);
+        hi0 = max(hi0, v[i]);
+    }
+
+    struct Aggregate b;
+    b.count = (long long)n;
+    b.sum = (s0 + s1) + (s2 + s3);
+    b.mean = b.sum / n;
+    b.min = min(lo0, lo1);
+    b.max = max(hi0, hi1);
+    b.first = v[0];
+    b.last = v[n - 1];
+
+    double d0 = 0, d1 = 0;
+    for (i = 0; i + 2 <= n; i += 2)
+    {
+        d0 += (v[i] - b.mean) * (v[i] - b.mean);
+        d1 += (v[i + 1] - b.mean) * (v[i + 1] - b.mean);
+    }
+    if (i < n)
+        d0 += (v[i] - b.mean) * (v[i] - b.mean);
+    b.m2 = d0 + d1;
+
+    Aggregate_merge(a, &b);
+}
+
+#define AGGREGATE_BLOCK_SIZE 64
+
+void Aggregate_addDoubles(struct Aggregate *a, const double *values, const uint64_t *nulls, size_t start, size_t end)
+{
+    // Walk the range a null bitmap word at a time; words with no nulls go through the block kernel.
+    while (start < end)
+    {
+        size_t block_end = min(end, (start / AGGREGATE_BLOCK_SIZE + 1) * AGGREGATE_BLOCK_SIZE);
+        size_t shift = start % AGGREGATE_BLOCK_SIZE, n = block_end - start;
+        uint64_t mask = n == AGGREGATE_BLOCK_SIZE ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1) << shift;
+        uint64_t word = nulls[start / AGGREGATE_BLOCK_SIZE] & mask;
+
+        if (word == 0)
+        {
+            Aggregate_blockDoubles(a, values + start, n);
+        }
+        else if (word != mask)
+        {
+            for (size_t r = start; r < block_end; ++r)
+            {
+                if (!((word >> (r % AGGREGATE_BLOCK_SIZE)) & 1))
+                    Aggregate_add(a, values[r]);
+            }
+        }
+
+        start = block_end;
+    }
+}
+
+void Aggregate_addInts(struct Aggregate *a, const long long *values, const uint64_t *nulls, size_t start, size_t end)
+{
+    double block[AGGREGATE_BLOCK_SIZE];
+
+    while (start < end)
+    {
+        size_t block_end = min(end, (start / AGGREGATE_BLOCK_SIZE + 1) * AGGREGATE_BLOCK_SIZE);
+        size_t shift = start % AGGREGATE_BLOCK_SIZE, n = block_end - start;
+        uint64_t mask = n == AGGREGATE_BLOCK_SIZE ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1) << shift;
+        uint64_t word = nulls[start / AGGREGATE_BLOCK_SIZE] & mask;
+
+        if (word == 0)
+        {
+            for (size_t i = 0; i < n; ++i)
+                block[i] = (double)values[start + i];
+            Aggregate_blockDoubles(a, block, n);
+        }
+        else if (word != mask)
+        {
+            for (size_t r = start; r < block_end; ++r)
+            {
+                if (!((word >> (r % AGGREGATE_BLOCK_SIZE)) & 1))
+                    Aggregate_add(a, (double)values[r]);
+            }
+        }
+
+        start = block_end;
+    }
+}
+
+void Aggregate_reply(RedisModuleCtx *ctx, const struct Aggregate *a, int function)
+{
+    switch (function)
+    {
+    case AGGREGATE_COUNT:
+        RedisModule_ReplyWithLongLong(ctx, a->count);
+        return;
+    case AGGREGATE_SUM:
+        RedisModule_ReplyWithDouble(ctx, a->sum);
+        return;
+    }
+
+    if (a->count == 0 || (function == AGGREGATE_STDDEV && a->count < 2))
+    {
+        RedisModule_ReplyWithNull(ctx);
+        return;
+    }
+
+    switch (function)
+    {
+    case AGGREGATE_MEAN:
+        RedisModule_ReplyWithDouble(ctx, a->sum / a->count);
+        break;
+    case AGGREGATE_MIN:
+        RedisModule_ReplyWithDouble(ctx, a->min);
+        break;
+    case AGGREGATE_MAX:
+        RedisModule_ReplyWithDouble(ctx, a->max);
+        break;
+    default:
+        RedisModule_ReplyWithDouble(ctx, sqrt(a->m2 / (a->count - 1)));
+        break;
+    }
+}
@@ -0,0 +1,64 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __AGGREGATE_H
+#define __AGGREGATE_H
+
+#include "redismodule.h"
+
+#define AGGREGATE_SUM 1
+#define AGGREGATE_MEAN 2
+#define AGGREGATE_MIN 3
+#define AGGREGATE_MAX 4
+#define AGGREGATE_COUNT 5
+#define AGGREGATE_STDDEV 6
+
+#define AGGREGATE_AXIS_NONE 0
+#define AGGREGATE_AXIS_ROWS 1
+#define AGGREGATE_AXIS_COLUMNS 2
+
+// Running statistics for a set of numbers. The squared deviations from the
+// mean are kept rather than the sum of squares so the variance stays accurate.
+// The first and last numbers are in the order they were added.
+struct Aggregate {
+    long long count;
+    double sum;
+    double mean;
+    double m2;
+    double min;
+    double max;
+    double first;
+    double last;
+};
+
+int Aggregate_parseFunction(const char *name);
+void Aggregate_init(struct Aggregate *a);
+void Aggregate_add(struct Aggregate *a, double value);
+void Aggregate_merge(struct Aggregate *a, const struct Aggregate *b);
+void Aggregate_addDoubles(struct Aggregate *a, const double *values, const uint64_t *nulls, size_t start, size_t end);
+void Aggregate_addInts(struct Aggregate *a, const long long *values, const uint64_t *nulls, size_t start, size_t end);
+void Aggregate_reply(RedisModuleCtx *ctx, const struct Aggregate *a, int function);
+
+#endif // __AGGREGATE_H
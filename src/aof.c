@@ -0,0 +1,107 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "redismodule.h"
+
+#include "utils.h"
+#include "aof.h"
+
+void Aof_open(struct AofWriter *writer, RedisModuleIO *aof, RedisModuleString *key, size_t rows, size_t columns)
+{
+    writer->aof = aof;
+    writer->ctx = RedisModule_GetContextFromIO(aof);
+    writer->key = key;
+    writer->columns = columns;
+    writer->band_columns = max(min(columns, (size_t)AOF_BATCH_CELLS), (size_t)1);
+    writer->band_rows = AOF_BATCH_CELLS / writer->band_columns;
+    writer->row = 0;
+    writer->column = 0;
+    writer->count = 0;
+    writer->populated = 0;
+    writer->cells = (RedisModuleString**)RedisModule_Alloc(sizeof(RedisModuleString*) * writer->band_rows * writer->band_columns);
+
+    RedisModule_EmitAOF(aof, "GRID.DIM", "sll", key, (long long)rows, (long long)columns);
+}
+
+void Aof_flush(struct AofWriter *writer)
+{
+    size_t rows, columns;
+    if (writer->band_columns == writer->columns)
+    {
+        rows = writer->count / writer->columns;
+        columns = writer->columns;
+    }
+    else
+    {
+        rows = 1;
+        columns = writer->count;
+    }
+
+    // The grid starts empty, so a band without a value need not be sent.
+    if (writer->populated > 0)
+        RedisModule_EmitAOF(writer->aof, "GRID.SET", "sllllv", writer->key,
+            (long long)writer->row, (long long)(writer->row + rows - 1),
+            (long long)writer->column, (long long)(writer->column + columns - 1),
+            writer->cells, writer->count);
+
+    for (RedisModuleString **p = writer->cells, **end = writer->cells + writer->count; p < end; ++p)
+        RedisModule_FreeString(writer->ctx, *p);
+
+    writer->column += columns;
+    if (writer->column == writer->columns)
+    {
+        writer->row += rows;
+        writer->column = 0;
+    }
+    writer->count = 0;
+    writer->populated = 0;
+}
+
+void Aof_writeCell(struct AofWriter *writer, const char *data, size_t len)
+{
+    if (data && len > 0)
+        ++writer->populated;
+    else
+    {
+        data = "";
+        len = 0;
+    }
+
+    writer->cells[writer->count++] = RedisModule_CreateString(writer->ctx, data, len);
+
+    // A row wider than the batch is flushed at its end as well.
+    if (writer->count == writer->band_rows * writer->band_columns ||
+        (writer->band_columns < writer->columns && writer->column + writer->count == writer->columns))
+        Aof_flush(writer);
+}
+
+void Aof_close(struct AofWriter *writer)
+{
+    if (writer->count > 0)
+        Aof_flush(writer);
+
+    RedisModule_Free(writer->cells);
+    writer->cells = NULL;
+}
@@ -0,0 +1,57 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __AOF_H
+#define __AOF_H
+
+#include <stddef.h>
+
+#include "redismodule.h"
+
+// The most cells emitted by a single GRID.SET when a grid is rewritten.
+#define AOF_BATCH_CELLS 4096
+
+// Rewrites a grid as an empty GRID.DIM followed by a GRID.SET for each band
+// of rows, or for each segment of a row wider than the batch. Cells are
+// written in row major order.
+struct AofWriter {
+    RedisModuleIO *aof;
+    RedisModuleCtx *ctx;
+    RedisModuleString *key;
+    size_t columns;
+    size_t band_rows;
+    size_t band_columns;
+    size_t row;
+    size_t column;
+    size_t count;
+    size_t populated;
+    RedisModuleString **cells;
+};
+
+void Aof_open(struct AofWriter *writer, RedisModuleIO *aof, RedisModuleString *key, size_t rows, size_t columns);
+void Aof_writeCell(struct AofWriter *writer, const char *data, size_t len);
+void Aof_close(struct AofWriter *writer);
+
+#endif // __AOF_H
@@ -0,0 +1,155 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "utils.h"
+#include "arena.h"
+
+void Arena_init(struct Arena *a)
+{
+    a->chunks = NULL;
+    a->capacity = 0;
+    a->used = 0;
+    a->garbage = 0;
+}
+
+void Arena_free(struct Arena *a)
+{
+    // Stop at the first chunk which is still referenced by another arena, as it holds the rest of the list.
+    struct ArenaChunk *chunk = a->chunks;
+    while (chunk && --chunk->refcount == 0)
+    {
+        struct ArenaChunk *next = chunk->next;
+        RedisModule_Free(chunk);
+        chunk = next;
+    }
+
+    Arena_init(a);
+}
+
+void Arena_share(struct Arena *a, const struct Arena *source)
+{
+    *a = *source;
+    if (a->chunks)
+        ++a->chunks->refcount;
+}
+
+static inline int Arena_isShared(const struct ArenaChunk *chunk)
+{
+    return chunk->refcount > 1;
+}
+
+struct ArenaChunk *Arena_allocChunk(size_t capacity)
+{
+    struct ArenaChunk *chunk = (struct ArenaChunk*)RedisModule_Alloc(sizeof(struct ArenaChunk) + capacity);
+    if (!chunk)
+        return NULL;
+
+    chunk->next = NULL;
+    chunk->refcount = 1;
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    return chunk;
+}
+
+int Arena_reserve(struct Arena *a, size_t len)
+{
+    if (len == 0 || (a->chunks && !Arena_isShared(a->chunks) && a->chunks->capacity - a->chunks->used >= len))
+        return REDISMODULE_OK;
+
+    // Grow geometrically so small grids stay small and large grids use few chunks.
+    size_t capacity = min(max(a->capacity, (size_t)ARENA_MIN_CHUNK_SIZE), (size_t)ARENA_MAX_CHUNK_SIZE);
+    struct ArenaChunk *chunk = Arena_allocChunk(max(len, capacity));
+    if (!chunk)
+        return REDISMODULE_ERR;
+
+    chunk->next = a->chunks;
+    a->chunks = chunk;
+    a->capacity += chunk->capacity;
+
+    return REDISMODULE_OK;
+}
+
+char *Arena_alloc(struct Arena *a, size_t len)
+{
+    struct ArenaChunk *chunk = a->chunks;
+
+    if (!chunk || Arena_isShared(chunk) || chunk->capacity - chunk->used < len)
+    {
+        // Oversized values get a chunk of their own behind the current one, so
+        // the space left in the current chunk is not abandoned.
+        if (chunk && !Arena_isShared(chunk) && len > ARENA_MAX_CHUNK_SIZE / 4)
+        {
+            struct ArenaChunk *large = Arena_allocChunk(len);
+            if (!large)
+                return NULL;
+
+            large->next = chunk->next;
+            chunk->next = large;
+            chunk = large;
+            a->capacity += large->capacity;
+        }
+        else
+        {
+            if (Arena_reserve(a, len) != REDISMODULE_OK)
+                return NULL;
+            chunk = a->chunks;
+        }
+    }
+
+    char *p = chunk->data + chunk->used;
+    chunk->used += len;
+    a->used += len;
+    return p;
+}
+
+void Arena_release(struct Arena *a, size_t len)
+{
+    a->garbage += len;
+}
+
+size_t Arena_liveBytes(const struct Arena *a)
+{
+    return a->used - a->garbage;
+}
+
+int Arena_shouldCompact(const struct Arena *a)
+{
+    return a->garbage >= ARENA_COMPACT_THRESHOLD && a->garbage * 2 >= a->used;
+}
+
+// A chunk is counted in equal parts by the arenas and chunks which point to it, so the
+// chunks shared by copies of a grid are counted once across the copies.
+size_t Arena_memUsage(const struct Arena *a)
+{
+    double usage = 0, share = 1;
+    for (const struct ArenaChunk *chunk = a->chunks; chunk; chunk = chunk->next)
+    {
+        share /= (double)chunk->refcount;
+        usage += share * (double)(sizeof(struct ArenaChunk) + chunk->capacity);
+    }
+    return (size_t)usage;
+}
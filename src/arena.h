@@ -0,0 +1,64 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_MIN_CHUNK_SIZE 256
+#define ARENA_MAX_CHUNK_SIZE (64 * 1024)
+#define ARENA_COMPACT_THRESHOLD (64 * 1024)
+
+struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t refcount;
+    size_t capacity;
+    size_t used;
+    char data[];
+};
+
+// A bump allocator for cell bytes. Released bytes are only counted as garbage;
+// the owning grid reclaims them by copying the live cells into a fresh arena.
+// A copy of a grid shares the chunks of the original, so a chunk counts the
+// arenas and chunks which point to it, and a shared chunk is never allocated from.
+struct Arena {
+    struct ArenaChunk *chunks;
+    size_t capacity;
+    size_t used;
+    size_t garbage;
+};
+
+void Arena_init(struct Arena *a);
+void Arena_free(struct Arena *a);
+void Arena_share(struct Arena *a, const struct Arena *source);
+int Arena_reserve(struct Arena *a, size_t len);
+char *Arena_alloc(struct Arena *a, size_t len);
+void Arena_release(struct Arena *a, size_t len);
+size_t Arena_liveBytes(const struct Arena *a);
+int Arena_shouldCompact(const struct Arena *a);
+size_t Arena_memUsage(const struct Arena *a);
+
+#endif //  __ARENA_H
@@ -23,30 +23,86 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <string.h>
 
 #include "utils.h"
+#include "aof.h"
 #include "array_grid.h"
 
-void ArrayGrid_clearRedisStrings(char **start, char **end)
+static inline struct ArrayGridSlots *ArrayGrid_header(struct GridSlot *slots)
 {
-    for (char **p = start; p < end; ++p)
-    {
-        if (*p)
-        {
-            RedisModule_Free(*p);
-            *p = NULL;
-        }
-    }
+    return (struct ArrayGridSlots*)((char*)slots - offsetof(struct ArrayGridSlots, slots));
+}
+
+struct GridSlot *ArrayGrid_allocSlots(size_t len)
+{
+    struct ArrayGridSlots *header = (struct ArrayGridSlots*)RedisModule_Alloc(sizeof(struct ArrayGridSlots) + sizeof(struct GridSlot) * len);
+    if (!header)
+        return NULL;
+    header->refcount = 1;
+    return header->slots;
+}
+
+struct GridSlot *ArrayGrid_reallocSlots(struct GridSlot *slots, size_t len)
+{
+    struct ArrayGridSlots *header = (struct ArrayGridSlots*)RedisModule_Realloc(ArrayGrid_header(slots), sizeof(struct ArrayGridSlots) + sizeof(struct GridSlot) * len);
+    return header ? header->slots : NULL;
+}
+
+void ArrayGrid_freeSlots(struct GridSlot *slots)
+{
+    if (slots && --ArrayGrid_header(slots)->refcount == 0)
+        RedisModule_Free(ArrayGrid_header(slots));
+}
+
+int ArrayGrid_isShared(const struct ArrayGrid *o)
+{
+    return ArrayGrid_header(o->base)->refcount > 1;
+}
+
+// Copies the slots shared with another grid before they are written, so the other grid is
+// unchanged. The copy holds no spare rows.
+int ArrayGrid_own(struct ArrayGrid *o)
+{
+    if (!ArrayGrid_isShared(o))
+        return REDISMODULE_OK;
+
+    size_t len = o->rows * o->columns;
+    struct GridSlot *start = ArrayGrid_allocSlots(len);
+    if (!start)
+        return REDISMODULE_ERR;
+    memcpy(start, o->start, sizeof(struct GridSlot) * len);
+
+    ArrayGrid_freeSlots(o->base);
+    o->capacity = o->rows;
+    o->base = start;
+    o->start = start;
+    o->end = start + len;
+
+    return REDISMODULE_OK;
+}
+
+void ArrayGrid_clearRedisStrings(struct Arena *arena, struct GridSlot *start, struct GridSlot *end)
+{
+    for (struct GridSlot *p = start; p < end; ++p)
+        GridSlot_clear(arena, p);
 }
 
-int ArrayGrid_copyRedisStrings(RedisModuleString** source, char **start, char **end)
+int ArrayGrid_copyRedisStrings(struct Arena *arena, RedisModuleString** source, struct GridSlot *start, struct GridSlot *end)
 {
-    for (char **p = start; p < end; ++p, ++source)
+    memset(start, 0, (end - start) * sizeof(struct GridSlot));
+    if (!source)
+        return REDISMODULE_OK;
+
+    if (Arena_reserve(arena, GridSlot_measureRedisStrings(source, end - start)) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    for (struct GridSlot *p = start; p < end; ++p, ++source)
     {
-        if (GridType_setRedisString(source, p) != REDISMODULE_OK)
+        if (GridSlot_setRedisString(arena, *source, p) != REDISMODULE_OK)
         {
-            ArrayGrid_clearRedisStrings(start, p);
+            ArrayGrid_clearRedisStrings(arena, start, p);
             return REDISMODULE_ERR;
         }
     }
@@ -54,15 +110,15 @@ int ArrayGrid_copyRedisStrings(RedisModuleString** source, char **start, char **
     return REDISMODULE_OK;
 }
 
-char **ArrayGrid_copyAndAllocRedisStrings(RedisModuleString **source, size_t len)
+struct GridSlot *ArrayGrid_copyAndAllocRedisStrings(struct Arena *arena, RedisModuleString **source, size_t len)
 {
-    char **destination = (char**)RedisModule_Alloc(sizeof(char*) * len);
+    struct GridSlot *destination = ArrayGrid_allocSlots(len);
     if (!destination)
         return NULL;
 
-    if (ArrayGrid_copyRedisStrings(source, destination, destination + len) != REDISMODULE_OK)
+    if (ArrayGrid_copyRedisStrings(arena, source, destination, destination + len) != REDISMODULE_OK)
     {
-        RedisModule_Free(destination);
+        ArrayGrid_freeSlots(destination);
         return NULL;
     }
 
@@ -74,45 +130,322 @@ struct ArrayGrid *ArrayGrid_createObject(size_t rows, size_t columns, RedisModul
     struct ArrayGrid *o = (struct ArrayGrid *)RedisModule_Alloc(sizeof(struct ArrayGrid));
     if (!o)
         return NULL;
-        
+
+    Arena_init(&o->arena);
+
     size_t len = rows * columns;
-    o->start = ArrayGrid_copyAndAllocRedisStrings(source, len);
+    o->start = ArrayGrid_copyAndAllocRedisStrings(&o->arena, source, len);
     if (!o->start)
     {
+        Arena_free(&o->arena);
         RedisModule_Free(o);
         return NULL;
     }
 
     o->rows = rows;
     o->columns = columns;
+    o->capacity = rows;
+    o->base = o->start;
     o->end = o->start + len;
 
     return o;
 }
 
+struct ArrayGrid *ArrayGrid_copyObject(const struct ArrayGrid *o)
+{
+    struct ArrayGrid *copy = (struct ArrayGrid *)RedisModule_Alloc(sizeof(struct ArrayGrid));
+    if (!copy)
+        return NULL;
+
+    // The slots are shared until one of the grids writes to them, and the longer values are
+    // shared with the original through the arena.
+    ++ArrayGrid_header(o->base)->refcount;
+
+    copy->rows = o->rows;
+    copy->columns = o->columns;
+    copy->capacity = o->capacity;
+    copy->base = o->base;
+    copy->start = o->start;
+    copy->end = o->end;
+    Arena_share(&copy->arena, &o->arena);
+
+    return copy;
+}
+
 void ArrayGrid_releaseObject(struct ArrayGrid *o)
 {
-    ArrayGrid_clearRedisStrings(o->start, o->end);
-    RedisModule_Free(o->start);
+    Arena_free(&o->arena);
+    ArrayGrid_freeSlots(o->base);
     RedisModule_Free(o);
 }
 
+void ArrayGrid_compact(struct ArrayGrid *o)
+{
+    if (ArrayGrid_own(o) != REDISMODULE_OK)
+        return;
+
+    struct Arena arena;
+    Arena_init(&arena);
+    if (Arena_reserve(&arena, Arena_liveBytes(&o->arena)) != REDISMODULE_OK)
+        return;
+
+    for (struct GridSlot *p = o->start; p < o->end; ++p)
+        GridSlot_copy(&arena, p);
+
+    Arena_free(&o->arena);
+    o->arena = arena;
+}
+
 int ArrayGrid_setObject(struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source)
 {
+    if (ArrayGrid_own(o) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
     long long row_sign = row_start < row_end ? 1 : -1;
     long long column_sign = column_start < column_end ? 1 : -1;
 
     for (long long r = row_start; r != row_end + row_sign; r += row_sign)
     {
-        char **p = o->start + r * o->columns + column_start;
+        struct GridSlot *p = o->start + r * o->columns + column_start;
 
         for (long long c = column_start; c != column_end + column_sign; c += column_sign, p += column_sign, ++source)
         {
-            if (GridType_resetRedisString(source, p) != REDISMODULE_OK)
+            if (GridSlot_setRedisString(&o->arena, *source, p) != REDISMODULE_OK)
                 return REDISMODULE_ERR;
         }
     }
 
+    if (Arena_shouldCompact(&o->arena))
+        ArrayGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int ArrayGrid_setBlobObject(struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob)
+{
+    if (ArrayGrid_own(o) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    // The blob is column oriented, so fill the range a column at a time.
+    size_t j = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++j)
+    {
+        size_t i = 0;
+        for (long long r = row_start; r != row_end + row_sign; r += row_sign, ++i)
+        {
+            char buf[GRID_NUMBER_BUFSIZE];
+            size_t len;
+            const char *text = Blob_formatCell(blob, j, i, buf, &len);
+            if (GridSlot_set(&o->arena, text, len, o->start + r * o->columns + c) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (Arena_shouldCompact(&o->arena))
+        ArrayGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+// Makes room for the given rows after the start, doubling the capacity so appending a row at a time is amortized.
+int ArrayGrid_reserveRows(struct ArrayGrid *o, size_t rows)
+{
+    size_t dropped = (size_t)(o->start - o->base);
+    if (dropped + rows * o->columns <= o->capacity * o->columns)
+        return REDISMODULE_OK;
+
+    // The room left by dropped rows is reused once it is half of the vector, which keeps a capped grid amortized too.
+    if (dropped > 0)
+    {
+        memmove(o->base, o->start, sizeof(struct GridSlot) * (size_t)(o->end - o->start));
+        o->start = o->base;
+        o->end = o->base + o->rows * o->columns;
+        if (dropped >= o->capacity * o->columns / 2 && rows <= o->capacity)
+            return REDISMODULE_OK;
+    }
+
+    size_t capacity = max(rows, o->capacity * 2);
+    struct GridSlot *base = ArrayGrid_reallocSlots(o->base, capacity * o->columns);
+    if (!base)
+        return REDISMODULE_ERR;
+
+    o->base = base;
+    o->start = base;
+    o->end = base + o->rows * o->columns;
+    o->capacity = capacity;
+
+    return REDISMODULE_OK;
+}
+
+int ArrayGrid_appendRows(struct ArrayGrid *o, size_t rows, RedisModuleString **source)
+{
+    if (ArrayGrid_own(o) != REDISMODULE_OK || ArrayGrid_reserveRows(o, o->rows + rows) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    struct GridSlot *end = o->end + rows * o->columns;
+    if (ArrayGrid_copyRedisStrings(&o->arena, source, o->end, end) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    o->rows += rows;
+    o->end = end;
+
+    return REDISMODULE_OK;
+}
+
+// The first rows are dropped by moving the start past them, their room is reused by a later append.
+void ArrayGrid_dropRows(struct ArrayGrid *o, size_t rows)
+{
+    // The slots of shared rows are left as they are for the other grid, and only counted as garbage.
+    struct GridSlot *start = o->start + rows * o->columns;
+    if (ArrayGrid_isShared(o))
+    {
+        for (struct GridSlot *p = o->start; p < start; ++p)
+        {
+            if (p->tag == GRID_SLOT_CELL)
+                Arena_release(&o->arena, GridCell_size(p->cell));
+        }
+    }
+    else
+        ArrayGrid_clearRedisStrings(&o->arena, o->start, start);
+    o->start = start;
+    o->rows -= rows;
+
+    if (Arena_shouldCompact(&o->arena))
+        ArrayGrid_compact(o);
+}
+
+// Rows are inserted by moving the slots on the shorter side of them, the rows before move
+// down into the room left by dropped rows when there is enough of it. Values are held in
+// their slots or by pointer, so no value is copied.
+int ArrayGrid_insertRows(struct ArrayGrid *o, size_t row, size_t count)
+{
+    if (ArrayGrid_own(o) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t len = count * o->columns;
+    struct GridSlot *p;
+    if (row < o->rows / 2 && (size_t)(o->start - o->base) >= len)
+    {
+        memmove(o->start - len, o->start, sizeof(struct GridSlot) * row * o->columns);
+        o->start -= len;
+        p = o->start + row * o->columns;
+    }
+    else
+    {
+        if (ArrayGrid_reserveRows(o, o->rows + count) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+        p = o->start + row * o->columns;
+        memmove(p + len, p, sizeof(struct GridSlot) * (size_t)(o->end - p));
+    }
+
+    memset(p, 0, sizeof(struct GridSlot) * len);
+    o->rows += count;
+    o->end = o->start + o->rows * o->columns;
+
+    return REDISMODULE_OK;
+}
+
+int ArrayGrid_deleteRows(struct ArrayGrid *o, size_t row, size_t count)
+{
+    if (ArrayGrid_own(o) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t len = count * o->columns;
+    struct GridSlot *p = o->start + row * o->columns;
+    ArrayGrid_clearRedisStrings(&o->arena, p, p + len);
+
+    if (row < o->rows - row - count)
+    {
+        memmove(o->start + len, o->start, sizeof(struct GridSlot) * row * o->columns);
+        o->start += len;
+    }
+    else
+        memmove(p, p + len, sizeof(struct GridSlot) * (size_t)(o->end - p - len));
+
+    o->rows -= count;
+    o->end = o->start + o->rows * o->columns;
+
+    if (Arena_shouldCompact(&o->arena))
+        ArrayGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int ArrayGrid_insertColumns(struct ArrayGrid *o, size_t column, size_t count)
+{
+    size_t columns = o->columns + count;
+    size_t len = o->rows * columns;
+    struct GridSlot *start = ArrayGrid_allocSlots(len);
+    if (!start)
+        return REDISMODULE_ERR;
+
+    // The rows are counted rather than walked, as a grid without columns has no slots to walk.
+    struct GridSlot *dest = start;
+    const struct GridSlot *source = o->start;
+    for (size_t row = 0; row < o->rows; ++row, source += o->columns, dest += columns)
+    {
+        memcpy(dest, source, sizeof(struct GridSlot) * column);
+        memset(dest + column, 0, sizeof(struct GridSlot) * count);
+        memcpy(dest + column + count, source + column, sizeof(struct GridSlot) * (o->columns - column));
+    }
+
+    ArrayGrid_freeSlots(o->base);
+    o->columns = columns;
+    o->capacity = o->rows;
+    o->base = start;
+    o->start = start;
+    o->end = start + len;
+
+    return REDISMODULE_OK;
+}
+
+// The rows get narrower, so they are packed down from the base in place.
+int ArrayGrid_deleteColumns(struct ArrayGrid *o, size_t column, size_t count)
+{
+    if (ArrayGrid_own(o) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t columns = o->columns - count;
+    struct GridSlot *dest = o->base;
+    for (struct GridSlot *source = o->start; source < o->end; source += o->columns, dest += columns)
+    {
+        ArrayGrid_clearRedisStrings(&o->arena, source + column, source + column + count);
+        memmove(dest, source, sizeof(struct GridSlot) * column);
+        memmove(dest + column, source + column + count, sizeof(struct GridSlot) * (columns - column));
+    }
+
+    // The vector keeps its size, so it has room for more of the narrower rows.
+    o->capacity = o->capacity * o->columns / columns;
+    o->columns = columns;
+    o->start = o->base;
+    o->end = o->start + o->rows * columns;
+
+    if (Arena_shouldCompact(&o->arena))
+        ArrayGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+// The slots are moved a row at a time into a new vector, which holds no spare rows.
+int ArrayGrid_permuteRows(struct ArrayGrid *o, const size_t *order)
+{
+    size_t len = o->rows * o->columns;
+    struct GridSlot *start = ArrayGrid_allocSlots(len);
+    if (!start)
+        return REDISMODULE_ERR;
+
+    for (size_t r = 0; r < o->rows; ++r)
+        memcpy(start + r * o->columns, o->start + order[r] * o->columns, sizeof(struct GridSlot) * o->columns);
+
+    ArrayGrid_freeSlots(o->base);
+    o->capacity = o->rows;
+    o->base = start;
+    o->start = start;
+    o->end = start + len;
+
     return REDISMODULE_OK;
 }
 
@@ -121,56 +454,69 @@ int ArrayGrid_resizeAndCopyObject(struct ArrayGrid *o, size_t rows, size_t colum
     if (rows == o->rows && columns == o->columns)
         return REDISMODULE_OK;
 
+    // The slots which are cut off are cleared, so they can not be shared.
+    if (ArrayGrid_own(o) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    // Adding rows of the same width only needs the new rows nulled in the spare capacity.
+    if (columns == o->columns && rows > o->rows)
+        return ArrayGrid_appendRows(o, rows - o->rows, NULL);
+
     size_t len = rows * columns;
-    char **start = (char**)RedisModule_Alloc(sizeof(char*) * len);
+    struct GridSlot *start = ArrayGrid_allocSlots(len);
     if (!start)
         return REDISMODULE_ERR;
-    char **end = start + len;
+    struct GridSlot *end = start + len;
     
     // Copy from the old to the new
     size_t min_rows = min(rows, o->rows);
     size_t min_columns = min(columns, o->columns);
-    char** dest_end = start + min_rows * columns;
-    size_t trim_count = min_columns * sizeof(char*);
-    for (char **dest = start, **source = o->start; dest < dest_end; dest += columns, source += o->columns)
+    struct GridSlot *dest_end = start + min_rows * columns;
+    size_t trim_count = min_columns * sizeof(struct GridSlot);
+    for (struct GridSlot *dest = start, *source = o->start; dest < dest_end; dest += columns, source += o->columns)
     {
         memcpy(dest, source, trim_count);
     }
 
     if (rows < o->rows)
-        ArrayGrid_clearRedisStrings(o->start + rows * o->columns, o-> end);
+        ArrayGrid_clearRedisStrings(&o->arena, o->start + rows * o->columns, o-> end);
 
     if (columns < o->columns)
     {
-        char **trim_end = o->start + min_rows * o->columns;
-        for (char **p1 = o->start + columns, **p2 = o->start + o->columns; p1 < trim_end; p1 += o->columns, p2 += columns)
+        struct GridSlot *trim_end = o->start + min_rows * o->columns;
+        for (struct GridSlot *p1 = o->start + columns, *p2 = o->start + o->columns; p1 < trim_end; p1 += o->columns, p2 += o->columns)
         {
-            ArrayGrid_clearRedisStrings(p1, p2);
+            ArrayGrid_clearRedisStrings(&o->arena, p1, p2);
         }
     }
 
     // Null out any new rows
     if (rows > o->rows)
     {
-        memset(start + o->rows * columns, 0, (rows - o->rows) * columns * sizeof(char*));
+        memset(start + o->rows * columns, 0, (rows - o->rows) * columns * sizeof(struct GridSlot));
     }
 
     // Null out the end of columns
     if (columns > o->columns)
     {
-        size_t count = (columns - o->columns) * sizeof(char*);
-        for (char **p = start + o->columns; p < end; p += columns)
+        size_t count = (columns - o->columns) * sizeof(struct GridSlot);
+        for (struct GridSlot *p = start + o->columns; p < end; p += columns)
         {
             memset(p, 0, count);
         }
     }
 
-    RedisModule_Free(o->start);
+    ArrayGrid_freeSlots(o->base);
     o->rows = rows;
     o->columns = columns;
+    o->capacity = rows;
+    o->base = start;
     o->start = start;
     o->end = end;
 
+    if (Arena_shouldCompact(&o->arena))
+        ArrayGrid_compact(o);
+
     return REDISMODULE_OK;
 }
 
@@ -181,47 +527,150 @@ int ArrayGrid_resizeAndReplaceObject(struct ArrayGrid *o, size_t rows, size_t co
 
     size_t len = rows * columns;
 
-    char **values = (char**)RedisModule_Alloc(sizeof(char*) * len);
-    if (!values)
-        return REDISMODULE_ERR;
+    // Every value is replaced, so build the new values in a fresh arena and drop the old one whole.
+    struct Arena arena;
+    Arena_init(&arena);
 
-    if (ArrayGrid_copyRedisStrings(source, values, values + len) != REDISMODULE_OK)
+    struct GridSlot *values = ArrayGrid_copyAndAllocRedisStrings(&arena, source, len);
+    if (!values)
     {
-        RedisModule_Free(values);
+        Arena_free(&arena);
         return REDISMODULE_ERR;
     }
 
-    ArrayGrid_clearRedisStrings(o->start, o->end);
-    RedisModule_Free(o->start);
+    Arena_free(&o->arena);
+    ArrayGrid_freeSlots(o->base);
 
     o->rows = rows;
     o->columns = columns;
+    o->capacity = rows;
+    o->base = values;
     o->start = values;
     o->end = values + len;
+    o->arena = arena;
 
     return REDISMODULE_OK;
 }
-
-void ArrayGrid_rangeObject(RedisModuleCtx *ctx, struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end)
+void ArrayGrid_rangeObject(RedisModuleCtx *ctx, struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
 {
-    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
-    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end)) / row_step;
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end)) / column_step;
     RedisModule_ReplyWithArray(ctx, (long)(rows * columns));
 
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+    {
+        const struct GridSlot *p = o->start + r * o->columns + column_start;
+
+        for (long long c = column_start; c != column_end + column_stride; c += column_stride, p += column_stride)
+        {
+            GridSlot_reply(ctx, p);
+        }
+    }
+}
+
+// Replies the cells of the range a column at a time, without an array header. Each column is a
+// strided walk of the slots.
+void ArrayGrid_replyColumns(RedisModuleCtx *ctx, struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+    {
+        for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+            GridSlot_reply(ctx, o->start + r * o->columns + c);
+    }
+}
+
+void ArrayGrid_aggregateObject(struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results)
+{
     long long row_sign = row_start < row_end ? 1 : -1;
     long long column_sign = column_start < column_end ? 1 : -1;
 
+    struct Aggregate *a = results;
     for (long long r = row_start; r != row_end + row_sign; r += row_sign)
     {
-        char **p = o->start + r * o->columns + column_start;
+        if (axis == AGGREGATE_AXIS_ROWS)
+            a = results + (r - row_start) * row_sign;
 
-        for (long long c = column_start; c != column_end + column_sign; c += column_sign, p += column_sign)
+        for (long long c = column_start; c != column_end + column_sign; c += column_sign)
         {
-            RedisModule_ReplyWithSimpleString(ctx, *p ? *p : "");
+            if (axis == AGGREGATE_AXIS_COLUMNS)
+                a = results + (c - column_start) * column_sign;
+
+            double value;
+            if (GridSlot_toDouble(o->start + r * o->columns + c, &value) == REDISMODULE_OK)
+                Aggregate_add(a, value);
         }
     }
 }
 
+void ArrayGrid_filterObject(const struct ArrayGrid *o, const struct Filter *filter, uint64_t *bits)
+{
+    const struct GridSlot *slot = o->start + filter->column;
+    for (size_t r = 0; r < o->rows; ++r, slot += o->columns)
+    {
+        size_t len;
+        const char *data = GridSlot_data(slot, &len);
+        if (data && Filter_matchText(filter, data, len))
+            Filter_setBit(bits, r);
+    }
+}
+
+// Values held inline are given cells in the scratch arena so the blob can be written from cells.
+void ArrayGrid_gatherColumn(struct ArrayGrid *o, struct Arena *scratch, char **cells, long long column, long long row_start, long long row_end)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+        *cells++ = GridSlot_toCell(scratch, o->start + r * o->columns + column);
+}
+
+char *ArrayGrid_rangeBlobObject(struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len)
+{
+    size_t rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    size_t columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    char **cells = (char**)RedisModule_Alloc(sizeof(char*) * rows);
+    struct Arena scratch;
+    Arena_init(&scratch);
+
+    size_t size = Blob_headerSize(columns);
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        ArrayGrid_gatherColumn(o, &scratch, cells, c, row_start, row_end);
+        size_t column_size = Blob_stringColumnSize(cells, rows);
+        Arena_free(&scratch);
+        Arena_init(&scratch);
+        if (column_size == BLOB_TOO_LARGE)
+        {
+            RedisModule_Free(cells);
+            return NULL;
+        }
+        size += column_size;
+    }
+
+    char *blob = (char*)RedisModule_Alloc(size);
+    char *p = Blob_writeHeader(blob, rows, columns);
+    size_t i = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        ArrayGrid_gatherColumn(o, &scratch, cells, c, row_start, row_end);
+        p = Blob_writeStringColumn(blob, p, i++, cells, rows);
+        Arena_free(&scratch);
+        Arena_init(&scratch);
+    }
+
+    RedisModule_Free(cells);
+
+    *len = size;
+    return blob;
+}
+
 int ArrayGrid_getRangeValues(RedisModuleCtx *ctx, struct ArrayGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end)
 {
     int are_ranges_ok  =
@@ -247,46 +696,37 @@ int ArrayGrid_dump(RedisModuleCtx *ctx, struct ArrayGrid *o)
     RedisModule_ReplyWithLongLong(ctx, (long long)o->rows);
     RedisModule_ReplyWithLongLong(ctx, (long long)o->columns);
 
-    for (char **p = o->start; p < o->end; ++p)
-    {
-        if (*p)
-            RedisModule_ReplyWithSimpleString(ctx, *p);
-        else
-            RedisModule_ReplyWithNull(ctx);
-    }
+    for (const struct GridSlot *p = o->start; p < o->end; ++p)
+        GridSlot_reply(ctx, p);
     
     return REDISMODULE_OK;
 }
 
-void ArrayGrid_rdbSave(RedisModuleIO *rdb, struct ArrayGrid *o)
-{
-    RedisModule_SaveUnsigned(rdb, (uint64_t)o->rows);
-    RedisModule_SaveUnsigned(rdb, (uint64_t)o->columns);
-    for (char **p = o->start; p < o->end; ++p)
-    {
-        if (*p)
-            RedisModule_SaveStringBuffer(rdb, *p, strlen(*p) + 1);
-        else
-            RedisModule_SaveStringBuffer(rdb, "", 1);
-    }
-}
-
 struct ArrayGrid *ArrayGrid_rdbLoad(RedisModuleIO *rdb)
 {
     size_t rows = (size_t) RedisModule_LoadUnsigned(rdb);
     size_t columns = (size_t) RedisModule_LoadUnsigned(rdb);
     size_t len = rows * columns;
-    char **start = (char**) RedisModule_Alloc(sizeof(char*) * len);
-    char **end = start + len;
-    for (char **p = start; p < end; ++p)
+    struct GridSlot *start = ArrayGrid_allocSlots(len);
+    struct GridSlot *end = start + len;
+    memset(start, 0, sizeof(struct GridSlot) * len);
+
+    struct ArrayGrid *o = (struct ArrayGrid*) RedisModule_Alloc(sizeof(struct ArrayGrid));
+    Arena_init(&o->arena);
+
+    for (struct GridSlot *p = start; p < end; ++p)
     {
         size_t l;
-        *p = RedisModule_LoadStringBuffer(rdb, &l);
+        char *s = RedisModule_LoadStringBuffer(rdb, &l);
+        if (l > 1)
+            GridSlot_set(&o->arena, s, l - 1, p);
+        RedisModule_Free(s);
     }
 
-    struct ArrayGrid *o = (struct ArrayGrid*) RedisModule_Alloc(sizeof(struct ArrayGrid));
     o->rows = rows;
     o->columns = columns;
+    o->capacity = rows;
+    o->base = start;
     o->start = start;
     o->end = end;
     return o;
@@ -294,40 +734,38 @@ struct ArrayGrid *ArrayGrid_rdbLoad(RedisModuleIO *rdb)
 
 void ArrayGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct ArrayGrid *o) 
 {
-    RedisModuleCtx *ctx = RedisModule_GetContextFromIO(aof);
-
-    size_t len = o->columns * o->rows;
-    RedisModuleString **start = (RedisModuleString**)RedisModule_Alloc(sizeof(RedisModuleString*) * len);
-    RedisModuleString **p = start, **end = start + len;
+    struct AofWriter writer;
+    Aof_open(&writer, aof, key, o->rows, o->columns);
 
-    for (char **s = o->start; s < o->end; ++s, ++p)
+    for (const struct GridSlot *p = o->start; p < o->end; ++p)
     {
-        if (*s)
-            *p = RedisModule_CreateString(ctx, *s, strlen(*s));
-        else
-            *p = RedisModule_CreateString(ctx, "", 0);
+        size_t len;
+        const char *data = GridSlot_data(p, &len);
+        Aof_writeCell(&writer, data, data ? len : 0);
     }
 
-    RedisModule_EmitAOF(aof, "GRID.DIM","sllv", key, (long long)o->rows, (long long)o->columns, start, len);
-
-    for (p = start; p < end; ++p)
-        RedisModule_FreeString(ctx, *p);
-    RedisModule_Free(start);
+    Aof_close(&writer);
 }
 
 size_t ArrayGrid_memUsage(const struct ArrayGrid *o) 
 {
-    size_t usage = sizeof(*o) + sizeof(char**) * o->rows * o->columns;
-    for (char **p = o->start; p < o->end; ++p)
-        usage += *p ? strlen(*p) + 1 : 0;
-    return usage;
+    // Shared slots are counted in equal parts by the grids sharing them.
+    size_t slots = sizeof(struct ArrayGridSlots) + sizeof(struct GridSlot) * o->capacity * o->columns;
+    return sizeof(*o) + slots / ArrayGrid_header(o->base)->refcount + Arena_memUsage(&o->arena);
 }
 
 void ArrayGrid_digest(RedisModuleDigest *md, struct ArrayGrid *o)
 {
     RedisModule_DigestAddLongLong(md, o->rows);
     RedisModule_DigestAddLongLong(md, o->columns);
-    for (char **p = o->start; p < o->end; ++p)
-        RedisModule_DigestAddStringBuffer(md, (unsigned char*)*p, strlen((const char*)*p));
+    for (const struct GridSlot *p = o->start; p < o->end; ++p)
+    {
+        size_t len;
+        const char *data = GridSlot_data(p, &len);
+        if (data)
+            RedisModule_DigestAddStringBuffer(md, (unsigned char*)data, len + 1);
+        else
+            RedisModule_DigestAddStringBuffer(md, (unsigned char*)"", 1);
+    }
     RedisModule_DigestEndSequence(md);
 }
@@ -27,24 +27,54 @@
 #define  __ARRAY_GRID_H
 
 #include "redismodule.h"
+#include "arena.h"
+#include "aggregate.h"
+#include "filter.h"
+#include "blob.h"
 
+// The slots of a grid, which a copy of the grid shares until one of them
+// writes to it. The refcount counts the grids which hold the slots.
+struct ArrayGridSlots {
+    size_t refcount;
+    struct GridSlot slots[];
+};
+
+// The cells are held in a single vector of slots in row major order. The
+// vector has room for capacity rows from its base, so rows can be appended
+// and dropped from the front without copying the grid.
 struct ArrayGrid {
     size_t rows;
     size_t columns;
-    char** start;
-    char** end;
+    size_t capacity;
+    struct GridSlot* base;
+    struct GridSlot* start;
+    struct GridSlot* end;
+    struct Arena arena;
 };
 
 struct ArrayGrid *ArrayGrid_createObject(size_t rows, size_t columns, RedisModuleString** source);
+struct ArrayGrid *ArrayGrid_copyObject(const struct ArrayGrid *o);
 void ArrayGrid_releaseObject(struct ArrayGrid *o);
+void ArrayGrid_compact(struct ArrayGrid *o);
 int ArrayGrid_setObject(struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source);
+int ArrayGrid_setBlobObject(struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob);
 int ArrayGrid_resizeAndCopyObject(struct ArrayGrid *o, size_t rows, size_t columns);
+int ArrayGrid_appendRows(struct ArrayGrid *o, size_t rows, RedisModuleString **source);
+void ArrayGrid_dropRows(struct ArrayGrid *o, size_t rows);
+int ArrayGrid_insertRows(struct ArrayGrid *o, size_t row, size_t count);
+int ArrayGrid_deleteRows(struct ArrayGrid *o, size_t row, size_t count);
+int ArrayGrid_insertColumns(struct ArrayGrid *o, size_t column, size_t count);
+int ArrayGrid_deleteColumns(struct ArrayGrid *o, size_t column, size_t count);
+int ArrayGrid_permuteRows(struct ArrayGrid *o, const size_t *order);
 int ArrayGrid_resizeAndReplaceObject(struct ArrayGrid *o, size_t rows, size_t columns, RedisModuleString **source);
-void ArrayGrid_rangeObject(RedisModuleCtx *ctx, struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end);
+void ArrayGrid_rangeObject(RedisModuleCtx *ctx, struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void ArrayGrid_replyColumns(RedisModuleCtx *ctx, struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void ArrayGrid_aggregateObject(struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results);
+void ArrayGrid_filterObject(const struct ArrayGrid *o, const struct Filter *filter, uint64_t *bits);
+char *ArrayGrid_rangeBlobObject(struct ArrayGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len);
 int ArrayGrid_getRangeValues(RedisModuleCtx *ctx, struct ArrayGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end);
 int ArrayGrid_getShape(RedisModuleCtx *ctx, struct ArrayGrid* o);
 int ArrayGrid_dump(RedisModuleCtx *ctx, struct ArrayGrid* o);
-void ArrayGrid_rdbSave(RedisModuleIO *rdb, struct ArrayGrid *o);
 struct ArrayGrid* ArrayGrid_rdbLoad(RedisModuleIO *rdb);
 void ArrayGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct ArrayGrid *o);
 size_t ArrayGrid_memUsage(const struct ArrayGrid *o);
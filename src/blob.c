@@ -0,0 +1,274 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "redismodule.h"
+
+#include "utils.h"
+#include "blob.h"
+
+#define BLOB_FIXED_HEADER_SIZE 16
+
+size_t Blob_headerSize(size_t columns)
+{
+    return BLOB_FIXED_HEADER_SIZE + Blob_align(columns) + sizeof(uint64_t) * columns;
+}
+
+size_t Blob_bitmapSize(size_t rows)
+{
+    return Blob_align((rows + 7) / 8);
+}
+
+size_t Blob_numberColumnSize(size_t rows)
+{
+    return Blob_bitmapSize(rows) + sizeof(uint64_t) * rows;
+}
+
+// Returns BLOB_TOO_LARGE when the values will not fit the 32 bit offsets.
+size_t Blob_stringColumnSize(char **cells, size_t rows)
+{
+    size_t data = 0;
+    for (size_t r = 0; r < rows; ++r)
+    {
+        if (cells[r])
+            data += GridCell_length(cells[r]);
+    }
+
+    if (data > UINT32_MAX)
+        return BLOB_TOO_LARGE;
+
+    return Blob_bitmapSize(rows) + Blob_align(sizeof(uint32_t) * (rows + 1)) + Blob_align(data);
+}
+
+char *Blob_writeHeader(char *blob, size_t rows, size_t columns)
+{
+    uint32_t header[3] = { (uint32_t)rows, (uint32_t)columns, 0 };
+
+    memcpy(blob, BLOB_MAGIC, BLOB_MAGIC_SIZE);
+    memcpy(blob + BLOB_MAGIC_SIZE, header, sizeof(header));
+    memset(blob + BLOB_FIXED_HEADER_SIZE, 0, Blob_headerSize(columns) - BLOB_FIXED_HEADER_SIZE);
+
+    return blob + Blob_headerSize(columns);
+}
+
+static char *Blob_beginColumn(char *blob, char *p, size_t column, unsigned char type, size_t rows)
+{
+    size_t columns = ((uint32_t*)blob)[2];
+    uint64_t *offsets = (uint64_t*)(blob + BLOB_FIXED_HEADER_SIZE + Blob_align(columns));
+
+    blob[BLOB_FIXED_HEADER_SIZE + column] = (char)type;
+    offsets[column] = (uint64_t)(p - blob);
+
+    memset(p, 0, Blob_bitmapSize(rows));
+    return p;
+}
+
+// The values are the eight byte slots of a numeric column, and the nulls a
+// bitmap with a bit set for each empty row. Rows are written in range order.
+char *Blob_writeNumberColumn(char *blob, char *p, size_t column, unsigned char type, const uint64_t *values, const uint64_t *nulls, long long row_start, long long row_end)
+{
+    size_t rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    long long row_sign = row_start < row_end ? 1 : -1;
+
+    uint8_t *bitmap = (uint8_t*)Blob_beginColumn(blob, p, column, type, rows);
+    uint64_t *dest = (uint64_t*)(p + Blob_bitmapSize(rows));
+
+    if (row_sign > 0)
+        memcpy(dest, values + row_start, sizeof(uint64_t) * rows);
+
+    size_t i = 0;
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign, ++i)
+    {
+        if ((nulls[r / 64] >> (r % 64)) & 1)
+            dest[i] = 0;
+        else
+        {
+            bitmap[i / 8] |= (uint8_t)(1 << (i % 8));
+            if (row_sign < 0)
+                dest[i] = values[r];
+        }
+    }
+
+    return (char*)(dest + rows);
+}
+
+char *Blob_writeStringColumn(char *blob, char *p, size_t column, char **cells, size_t rows)
+{
+    uint8_t *bitmap = (uint8_t*)Blob_beginColumn(blob, p, column, BLOB_TYPE_STRING, rows);
+    uint32_t *offsets = (uint32_t*)(p + Blob_bitmapSize(rows));
+    char *data = (char*)offsets + Blob_align(sizeof(uint32_t) * (rows + 1));
+
+    uint32_t offset = 0;
+    for (size_t r = 0; r < rows; ++r)
+    {
+        offsets[r] = offset;
+        if (cells[r])
+        {
+            size_t len = GridCell_length(cells[r]);
+            memcpy(data + offset, GridCell_data(cells[r]), len);
+            offset += (uint32_t)len;
+            bitmap[r / 8] |= (uint8_t)(1 << (r % 8));
+        }
+    }
+    offsets[rows] = offset;
+
+    // Keep the padding deterministic.
+    memset(offsets + rows + 1, 0, data - (char*)(offsets + rows + 1));
+    memset(data + offset, 0, Blob_align(offset) - offset);
+
+    return data + Blob_align(offset);
+}
+
+static inline uint32_t Blob_readUInt32(const char *p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Blob_readUInt64(const char *p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline const char *Blob_column(const struct BlobReader *reader, size_t column)
+{
+    return reader->data + Blob_readUInt64(reader->data + BLOB_FIXED_HEADER_SIZE + Blob_align(reader->columns) + sizeof(uint64_t) * column);
+}
+
+static inline const char *Blob_stringOffsets(const struct BlobReader *reader, size_t column)
+{
+    return Blob_column(reader, column) + Blob_bitmapSize(reader->rows);
+}
+
+static inline const char *Blob_stringData(const struct BlobReader *reader, size_t column)
+{
+    return Blob_stringOffsets(reader, column) + Blob_align(sizeof(uint32_t) * (reader->rows + 1));
+}
+
+// Checks every size and offset up front so the accessors can trust the blob.
+int Blob_open(struct BlobReader *reader, const char *data, size_t len)
+{
+    if (len < BLOB_FIXED_HEADER_SIZE || memcmp(data, BLOB_MAGIC, BLOB_MAGIC_SIZE) != 0)
+        return REDISMODULE_ERR;
+
+    reader->data = data;
+    reader->len = len;
+    reader->rows = Blob_readUInt32(data + BLOB_MAGIC_SIZE);
+    reader->columns = Blob_readUInt32(data + BLOB_MAGIC_SIZE + sizeof(uint32_t));
+
+    // Without any columns the rows could not be backed by any data.
+    if (Blob_headerSize(reader->columns) > len || (reader->columns == 0 && reader->rows != 0))
+        return REDISMODULE_ERR;
+
+    for (size_t c = 0; c < reader->columns; ++c)
+    {
+        uint64_t offset = Blob_readUInt64(data + BLOB_FIXED_HEADER_SIZE + Blob_align(reader->columns) + sizeof(uint64_t) * c);
+        if (offset > len)
+            return REDISMODULE_ERR;
+
+        size_t available = len - (size_t)offset;
+        switch (Blob_columnType(reader, c))
+        {
+        case BLOB_TYPE_INT64:
+        case BLOB_TYPE_DOUBLE:
+            if (Blob_numberColumnSize(reader->rows) > available)
+                return REDISMODULE_ERR;
+            break;
+        case BLOB_TYPE_STRING:
+        {
+            size_t header = Blob_bitmapSize(reader->rows) + Blob_align(sizeof(uint32_t) * (reader->rows + 1));
+            if (header > available)
+                return REDISMODULE_ERR;
+
+            const char *offsets = Blob_stringOffsets(reader, c);
+            uint32_t previous = Blob_readUInt32(offsets);
+            for (size_t r = 1; r <= reader->rows; ++r)
+            {
+                uint32_t next = Blob_readUInt32(offsets + sizeof(uint32_t) * r);
+                if (next < previous)
+                    return REDISMODULE_ERR;
+                previous = next;
+            }
+            if (previous > available - header)
+                return REDISMODULE_ERR;
+            break;
+        }
+        default:
+            return REDISMODULE_ERR;
+        }
+    }
+
+    return REDISMODULE_OK;
+}
+
+unsigned char Blob_columnType(const struct BlobReader *reader, size_t column)
+{
+    return (unsigned char)reader->data[BLOB_FIXED_HEADER_SIZE + column];
+}
+
+int Blob_isValid(const struct BlobReader *reader, size_t column, size_t row)
+{
+    return ((unsigned char)Blob_column(reader, column)[row / 8] >> (row % 8)) & 1;
+}
+
+long long Blob_getInt(const struct BlobReader *reader, size_t column, size_t row)
+{
+    return (long long)Blob_readUInt64(Blob_column(reader, column) + Blob_bitmapSize(reader->rows) + sizeof(uint64_t) * row);
+}
+
+double Blob_getDouble(const struct BlobReader *reader, size_t column, size_t row)
+{
+    double value;
+    memcpy(&value, Blob_column(reader, column) + Blob_bitmapSize(reader->rows) + sizeof(uint64_t) * row, sizeof(value));
+    return value;
+}
+
+// Returns the text of a cell as the grid would store it, or NULL when it is empty.
+const char *Blob_formatCell(const struct BlobReader *reader, size_t column, size_t row, char *buf, size_t *len)
+{
+    if (!Blob_isValid(reader, column, row))
+        return NULL;
+
+    switch (Blob_columnType(reader, column))
+    {
+    case BLOB_TYPE_INT64:
+        *len = GridType_formatLongLong(Blob_getInt(reader, column, row), buf);
+        return buf;
+    case BLOB_TYPE_DOUBLE:
+        *len = GridType_formatDouble(Blob_getDouble(reader, column, row), buf);
+        return buf;
+    default:
+    {
+        const char *offsets = Blob_stringOffsets(reader, column);
+        uint32_t start = Blob_readUInt32(offsets + sizeof(uint32_t) * row);
+        *len = Blob_readUInt32(offsets + sizeof(uint32_t) * (row + 1)) - start;
+        return *len == 0 ? NULL : Blob_stringData(reader, column) + start;
+    }
+    }
+}
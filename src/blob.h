@@ -0,0 +1,85 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __BLOB_H
+#define __BLOB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A packed, column oriented image of a rectangle of cells. All integers are
+// little endian and every section starts on an eight byte boundary.
+//
+//   char     magic[4]          "GRB1"
+//   uint32   rows
+//   uint32   columns
+//   uint32   reserved          zero
+//   uint8    types[columns]    padded to eight bytes
+//   uint64   offsets[columns]  the start of each column from the start of the blob
+//
+// Each column starts with a validity bitmap of (rows + 7) / 8 bytes, padded to
+// eight bytes, where bit (r % 8) of byte (r / 8) is set when row r has a value.
+// INT64 and DOUBLE columns follow this with rows eight byte values, with zero
+// in the empty slots. STRING columns follow it with uint32 offsets[rows + 1],
+// padded to eight bytes, and then the bytes of the values, again padded. The
+// value of row r is the bytes from offsets[r] up to offsets[r + 1].
+
+#define BLOB_MAGIC "GRB1"
+#define BLOB_MAGIC_SIZE 4
+
+#define BLOB_TYPE_INT64 0x01
+#define BLOB_TYPE_DOUBLE 0x02
+#define BLOB_TYPE_STRING 0x03
+
+#define BLOB_TOO_LARGE ((size_t)-1)
+
+static inline size_t Blob_align(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+// A validated view of a blob supplied by a client. The data need not be aligned.
+struct BlobReader {
+    const char *data;
+    size_t len;
+    size_t rows;
+    size_t columns;
+};
+
+size_t Blob_headerSize(size_t columns);
+size_t Blob_bitmapSize(size_t rows);
+size_t Blob_numberColumnSize(size_t rows);
+size_t Blob_stringColumnSize(char **cells, size_t rows);
+char *Blob_writeHeader(char *blob, size_t rows, size_t columns);
+char *Blob_writeNumberColumn(char *blob, char *p, size_t column, unsigned char type, const uint64_t *values, const uint64_t *nulls, long long row_start, long long row_end);
+char *Blob_writeStringColumn(char *blob, char *p, size_t column, char **cells, size_t rows);
+int Blob_open(struct BlobReader *reader, const char *data, size_t len);
+unsigned char Blob_columnType(const struct BlobReader *reader, size_t column);
+int Blob_isValid(const struct BlobReader *reader, size_t column, size_t row);
+long long Blob_getInt(const struct BlobReader *reader, size_t column, size_t row);
+double Blob_getDouble(const struct BlobReader *reader, size_t column, size_t row);
+const char *Blob_formatCell(const struct BlobReader *reader, size_t column, size_t row, char *buf, size_t *len);
+
+#endif // __BLOB_H
@@ -0,0 +1,323 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <string.h>
+#include <sys/time.h>
+
+#include "utils.h"
+#include "changes.h"
+
+// Versions follow the clock in microseconds, and only count past it when there are several
+// changes in a microsecond, so the versions of a grid keep increasing after it is loaded again.
+static uint64_t GridChanges_lastVersion = 0;
+
+uint64_t GridChanges_nextVersion(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t now = (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+    GridChanges_lastVersion = now > GridChanges_lastVersion ? now : GridChanges_lastVersion + 1;
+    return GridChanges_lastVersion;
+}
+
+static void GridVersions_stamp(struct GridVersions *versions, size_t first, size_t last, uint64_t version)
+{
+    for (uint64_t *v = versions->base + versions->start + first, *end = versions->base + versions->start + last; v <= end; ++v)
+        *v = version;
+}
+
+// Makes room for count entries from the start, moving the entries back to the base or
+// growing the vector by doubling it. The new entries take the version.
+static int GridVersions_resize(struct GridVersions *versions, size_t count, uint64_t version)
+{
+    if (versions->start + count > versions->capacity)
+    {
+        if (count <= versions->capacity / 2)
+            memmove(versions->base, versions->base + versions->start, sizeof(uint64_t) * versions->count);
+        else
+        {
+            size_t capacity = max(count, versions->capacity * 2);
+            uint64_t *base = (uint64_t*)RedisModule_Alloc(sizeof(uint64_t) * capacity);
+            if (!base)
+                return REDISMODULE_ERR;
+            memcpy(base, versions->base + versions->start, sizeof(uint64_t) * versions->count);
+            RedisModule_Free(versions->base);
+            versions->base = base;
+            versions->capacity = capacity;
+        }
+        versions->start = 0;
+    }
+
+    if (count > versions->count)
+    {
+        size_t first = versions->count;
+        versions->count = count;
+        GridVersions_stamp(versions, first, count - 1, version);
+    }
+    else
+        versions->count = count;
+
+    return REDISMODULE_OK;
+}
+
+// Entries are inserted and deleted by moving the entries after them, which take the version.
+static int GridVersions_insert(struct GridVersions *versions, size_t at, size_t count, uint64_t version)
+{
+    size_t moved = versions->count - at;
+    if (GridVersions_resize(versions, versions->count + count, version) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    uint64_t *p = versions->base + versions->start + at;
+    memmove(p + count, p, sizeof(uint64_t) * moved);
+    GridVersions_stamp(versions, at, versions->count - 1, version);
+
+    return REDISMODULE_OK;
+}
+
+static void GridVersions_delete(struct GridVersions *versions, size_t at, size_t count, uint64_t version)
+{
+    uint64_t *p = versions->base + versions->start + at;
+    memmove(p, p + count, sizeof(uint64_t) * (versions->count - at - count));
+    versions->count -= count;
+    if (at < versions->count)
+        GridVersions_stamp(versions, at, versions->count - 1, version);
+}
+
+static void GridVersions_stampAll(struct GridVersions *versions, uint64_t version)
+{
+    if (versions->count > 0)
+        GridVersions_stamp(versions, 0, versions->count - 1, version);
+}
+
+struct GridChanges *GridChanges_create(size_t rows, size_t columns)
+{
+    struct GridChanges *changes = (struct GridChanges*)RedisModule_Calloc(1, sizeof(struct GridChanges));
+    if (!changes)
+        return NULL;
+
+    if (GridChanges_reset(changes, rows, columns) != REDISMODULE_OK)
+    {
+        GridChanges_release(changes);
+        return NULL;
+    }
+
+    return changes;
+}
+
+void GridChanges_release(struct GridChanges *changes)
+{
+    if (!changes)
+        return;
+
+    if (changes->rows.base)
+        RedisModule_Free(changes->rows.base);
+    if (changes->columns.base)
+        RedisModule_Free(changes->columns.base);
+    RedisModule_Free(changes);
+}
+
+// Forgets the changes so far, which every cell is taken to have changed since.
+int GridChanges_reset(struct GridChanges *changes, size_t rows, size_t columns)
+{
+    if (!changes)
+        return REDISMODULE_OK;
+
+    changes->version = changes->reset_version = GridChanges_nextVersion();
+    changes->rows.count = changes->columns.count = 0;
+    changes->is_lost = GridVersions_resize(&changes->rows, rows, changes->version) != REDISMODULE_OK ||
+        GridVersions_resize(&changes->columns, columns, changes->version) != REDISMODULE_OK;
+
+    return changes->is_lost ? REDISMODULE_ERR : REDISMODULE_OK;
+}
+
+void GridChanges_touch(struct GridChanges *changes, size_t row_start, size_t row_end, size_t column_start, size_t column_end)
+{
+    if (!changes || changes->is_lost)
+        return;
+
+    changes->version = GridChanges_nextVersion();
+    GridVersions_stamp(&changes->rows, min(row_start, row_end), max(row_start, row_end), changes->version);
+    GridVersions_stamp(&changes->columns, min(column_start, column_end), max(column_start, column_end), changes->version);
+}
+
+void GridChanges_touchAll(struct GridChanges *changes)
+{
+    if (!changes || changes->is_lost)
+        return;
+
+    changes->version = GridChanges_nextVersion();
+    GridVersions_stampAll(&changes->rows, changes->version);
+    GridVersions_stampAll(&changes->columns, changes->version);
+}
+
+// The rows and columns a resize adds are changed, and so are the columns of added rows and
+// the rows of added columns, while the cells it keeps are unchanged.
+int GridChanges_resize(struct GridChanges *changes, size_t rows, size_t columns)
+{
+    if (!changes || changes->is_lost || (rows == changes->rows.count && columns == changes->columns.count))
+        return REDISMODULE_OK;
+
+    changes->version = GridChanges_nextVersion();
+    int is_rows_added = rows > changes->rows.count, is_columns_added = columns > changes->columns.count;
+    if (GridVersions_resize(&changes->rows, rows, changes->version) != REDISMODULE_OK ||
+        GridVersions_resize(&changes->columns, columns, changes->version) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    if (is_rows_added)
+        GridVersions_stampAll(&changes->columns, changes->version);
+    if (is_columns_added)
+        GridVersions_stampAll(&changes->rows, changes->version);
+
+    return REDISMODULE_OK;
+}
+
+// Inserting or deleting rows moves the rows after them, which change in every column.
+int GridChanges_insertRows(struct GridChanges *changes, size_t row, size_t count)
+{
+    if (!changes || changes->is_lost)
+        return REDISMODULE_OK;
+
+    changes->version = GridChanges_nextVersion();
+    if (GridVersions_insert(&changes->rows, row, count, changes->version) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+    GridVersions_stampAll(&changes->columns, changes->version);
+
+    return REDISMODULE_OK;
+}
+
+void GridChanges_deleteRows(struct GridChanges *changes, size_t row, size_t count)
+{
+    if (!changes || changes->is_lost)
+        return;
+
+    changes->version = GridChanges_nextVersion();
+    GridVersions_delete(&changes->rows, row, count, changes->version);
+    GridVersions_stampAll(&changes->columns, changes->version);
+}
+
+int GridChanges_insertColumns(struct GridChanges *changes, size_t column, size_t count)
+{
+    if (!changes || changes->is_lost)
+        return REDISMODULE_OK;
+
+    changes->version = GridChanges_nextVersion();
+    if (GridVersions_insert(&changes->columns, column, count, changes->version) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+    GridVersions_stampAll(&changes->rows, changes->version);
+
+    return REDISMODULE_OK;
+}
+
+void GridChanges_deleteColumns(struct GridChanges *changes, size_t column, size_t count)
+{
+    if (!changes || changes->is_lost)
+        return;
+
+    changes->version = GridChanges_nextVersion();
+    GridVersions_delete(&changes->columns, column, count, changes->version);
+    GridVersions_stampAll(&changes->rows, changes->version);
+}
+
+// The rows dropped from the front of a capped grid are counted rather than stamped, so the
+// rows kept are not taken to have changed.
+void GridChanges_dropRows(struct GridChanges *changes, size_t count)
+{
+    if (!changes || changes->is_lost)
+        return;
+
+    changes->version = GridChanges_nextVersion();
+    changes->dropped += count;
+    changes->rows.start += count;
+    changes->rows.count -= count;
+}
+
+static int GridChanges_pushBounds(size_t **bounds, size_t *count, size_t *capacity, size_t row_start, size_t row_end, size_t column_start, size_t column_end)
+{
+    if (*count == *capacity)
+    {
+        size_t new_capacity = *capacity ? *capacity * 2 : 4;
+        size_t *new_bounds = (size_t*)RedisModule_Realloc(*bounds, sizeof(size_t) * 4 * new_capacity);
+        if (!new_bounds)
+            return REDISMODULE_ERR;
+        *bounds = new_bounds;
+        *capacity = new_capacity;
+    }
+
+    size_t *p = *bounds + 4 * (*count)++;
+    p[0] = row_start;
+    p[1] = row_end;
+    p[2] = column_start;
+    p[3] = column_end;
+
+    return REDISMODULE_OK;
+}
+
+// Finds the rectangles holding the cells changed since a version: each run of rows stamped
+// after it, across the columns from the first to the last column stamped after it. A version
+// before the reset version, or one the grid has not reached, gives the whole grid, as does any
+// version once the changes are lost. Returns the number of rectangles, with their row and column
+// bounds four at a time. The caller frees the bounds.
+size_t GridChanges_since(const struct GridChanges *changes, uint64_t version, size_t rows, size_t columns, size_t **bounds)
+{
+    size_t count = 0, capacity = 0;
+    *bounds = NULL;
+
+    if (rows == 0 || columns == 0 || (version == changes->version && !changes->is_lost))
+        return 0;
+
+    if (version < changes->reset_version || version > changes->version || changes->is_lost)
+    {
+        GridChanges_pushBounds(bounds, &count, &capacity, 0, rows - 1, 0, columns - 1);
+        return count;
+    }
+
+    const uint64_t *c = changes->columns.base + changes->columns.start;
+    size_t column_start = 0, column_end = columns;
+    while (column_start < columns && c[column_start] <= version)
+        ++column_start;
+    while (column_end > column_start && c[column_end - 1] <= version)
+        --column_end;
+    if (column_start == column_end)
+        return 0;
+
+    const uint64_t *r = changes->rows.base + changes->rows.start;
+    for (size_t row = 0; row < rows; ++row)
+    {
+        if (r[row] <= version)
+            continue;
+
+        size_t row_start = row;
+        while (row + 1 < rows && r[row + 1] > version)
+            ++row;
+        if (GridChanges_pushBounds(bounds, &count, &capacity, row_start, row, column_start, column_end - 1) != REDISMODULE_OK)
+            break;
+    }
+
+    return count;
+}
+
+size_t GridChanges_memUsage(const struct GridChanges *changes)
+{
+    return changes ? sizeof(struct GridChanges) + sizeof(uint64_t) * (changes->rows.capacity + changes->columns.capacity) : 0;
+}
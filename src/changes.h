@@ -0,0 +1,70 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __CHANGES_H
+#define __CHANGES_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// The versions at which each row or column last changed. Entries can be dropped from the
+// front without moving the others, as the oldest rows of a capped grid are.
+struct GridVersions {
+    uint64_t *base;
+    size_t start;
+    size_t count;
+    size_t capacity;
+};
+
+// The changes made to a grid. Each change takes a new version and stamps the rows and columns
+// it changed with it, so every cell changed since a version is in a row and a column stamped
+// after it. Nothing is known of the changes before the reset version, so every cell is taken
+// to have changed since them. Dropped counts the rows dropped from the front of a capped grid,
+// which move the rows after them up without changing them. Changes which could not be stamped
+// are lost, and every cell is taken to have changed since any version until they are reset.
+struct GridChanges {
+    uint64_t version;
+    uint64_t reset_version;
+    uint64_t dropped;
+    int is_lost;
+    struct GridVersions rows;
+    struct GridVersions columns;
+};
+
+uint64_t GridChanges_nextVersion(void);
+struct GridChanges *GridChanges_create(size_t rows, size_t columns);
+void GridChanges_release(struct GridChanges *changes);
+int GridChanges_reset(struct GridChanges *changes, size_t rows, size_t columns);
+void GridChanges_touch(struct GridChanges *changes, size_t row_start, size_t row_end, size_t column_start, size_t column_end);
+void GridChanges_touchAll(struct GridChanges *changes);
+int GridChanges_resize(struct GridChanges *changes, size_t rows, size_t columns);
+int GridChanges_insertRows(struct GridChanges *changes, size_t row, size_t count);
+void GridChanges_deleteRows(struct GridChanges *changes, size_t row, size_t count);
+int GridChanges_insertColumns(struct GridChanges *changes, size_t column, size_t count);
+void GridChanges_deleteColumns(struct GridChanges *changes, size_t column, size_t count);
+void GridChanges_dropRows(struct GridChanges *changes, size_t count);
+size_t GridChanges_since(const struct GridChanges *changes, uint64_t version, size_t rows, size_t columns, size_t **bounds);
+size_t GridChanges_memUsage(const struct GridChanges *changes);
+
+#endif // __CHANGES_H
@@ -0,0 +1,1626 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "aof.h"
+#include "column_grid.h"
+
+// Doubles hold every integer up to 2^53 exactly.
+#define COLUMN_MAX_EXACT_INT (1LL << 53)
+
+// A dictionary is dropped once it holds more than one distinct value for every few rows.
+#define COLUMN_DICT_MIN_ENTRIES 256
+#define COLUMN_DICT_ROWS_PER_ENTRY 4
+
+static int dictionary_encoding = 1;
+
+static inline size_t ColumnGrid_nullWords(size_t rows)
+{
+    return (rows + 63) / 64;
+}
+
+// Dictionary codes are four bytes; every other column type uses an eight byte slot.
+static inline size_t ColumnGrid_slotSize(const struct Column *column)
+{
+    return column->type == COLUMN_TYPE_DICT ? sizeof(uint32_t) : sizeof(long long);
+}
+
+static inline size_t ColumnGrid_dictLimit(size_t rows)
+{
+    return max((size_t)COLUMN_DICT_MIN_ENTRIES, rows / COLUMN_DICT_ROWS_PER_ENTRY);
+}
+
+static inline const char *ColumnGrid_dictCell(const struct Column *column, size_t row)
+{
+    uint32_t code = column->codes[row];
+    return code ? column->dict->entries[code - 1].cell : NULL;
+}
+
+void ColumnGrid_setDictionaryEncoding(int is_enabled)
+{
+    dictionary_encoding = is_enabled;
+}
+
+int ColumnGrid_isNull(const struct Column *column, size_t row)
+{
+    switch (column->type)
+    {
+    case COLUMN_TYPE_STRING:
+        return column->strings[row] == NULL;
+    case COLUMN_TYPE_DICT:
+        return column->codes[row] == 0;
+    default:
+        return (column->nulls[row / 64] >> (row % 64)) & 1;
+    }
+}
+
+void ColumnGrid_setNullBits(struct Column *column, size_t row_start, size_t row_end)
+{
+    for (size_t r = row_start; r < row_end; ++r)
+        column->nulls[r / 64] |= (uint64_t)1 << (r % 64);
+}
+
+int ColumnGrid_initColumn(struct Column *column, size_t rows)
+{
+    column->type = COLUMN_TYPE_INT64;
+    column->shares = NULL;
+    column->text = NULL;
+    column->text_count = 0;
+    column->text_capacity = 0;
+    column->dict = NULL;
+    column->ints = (long long*)RedisModule_Calloc(rows, sizeof(long long));
+    column->nulls = (uint64_t*)RedisModule_Alloc(sizeof(uint64_t) * ColumnGrid_nullWords(rows));
+    if (!column->ints || !column->nulls)
+        return REDISMODULE_ERR;
+    memset(column->nulls, 0xff, sizeof(uint64_t) * ColumnGrid_nullWords(rows));
+    return REDISMODULE_OK;
+}
+
+// Returns the position of the first override at or after the row.
+size_t ColumnGrid_findText(const struct Column *column, size_t row)
+{
+    size_t lo = 0, hi = column->text_count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (column->text[mid].row < row)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+const char *ColumnGrid_getText(const struct Column *column, size_t row)
+{
+    if (column->text_count == 0)
+        return NULL;
+
+    size_t i = ColumnGrid_findText(column, row);
+    return i < column->text_count && column->text[i].row == row ? column->text[i].cell : NULL;
+}
+
+int ColumnGrid_setText(struct Arena *arena, struct Column *column, size_t row, const char *s, size_t len)
+{
+    size_t i = ColumnGrid_findText(column, row);
+    int exists = i < column->text_count && column->text[i].row == row;
+
+    if (exists)
+        Arena_release(arena, GridCell_size(column->text[i].cell));
+
+    if (!s)
+    {
+        if (exists)
+        {
+            memmove(column->text + i, column->text + i + 1, sizeof(struct ColumnText) * (column->text_count - i - 1));
+            --column->text_count;
+        }
+        return REDISMODULE_OK;
+    }
+
+    char *cell = GridCell_create(arena, s, len);
+    if (!cell)
+        return REDISMODULE_ERR;
+
+    if (!exists)
+    {
+        if (column->text_count == column->text_capacity)
+        {
+            size_t capacity = column->text_capacity ? column->text_capacity * 2 : 4;
+            struct ColumnText *text = (struct ColumnText*)RedisModule_Realloc(column->text, sizeof(struct ColumnText) * capacity);
+            if (!text)
+                return REDISMODULE_ERR;
+            column->text = text;
+            column->text_capacity = capacity;
+        }
+
+        memmove(column->text + i + 1, column->text + i, sizeof(struct ColumnText) * (column->text_count - i));
+        ++column->text_count;
+        column->text[i].row = row;
+    }
+
+    column->text[i].cell = cell;
+    return REDISMODULE_OK;
+}
+
+// Drops the overrides for every row from the given row on.
+void ColumnGrid_truncateText(struct Arena *arena, struct Column *column, size_t row)
+{
+    for (size_t i = ColumnGrid_findText(column, row); i < column->text_count; ++i)
+        Arena_release(arena, GridCell_size(column->text[i].cell));
+    column->text_count = ColumnGrid_findText(column, row);
+}
+
+void ColumnGrid_releaseCells(struct Arena *arena, char **start, char **end)
+{
+    for (char **s = start; s < end; ++s)
+    {
+        if (*s)
+        {
+            Arena_release(arena, GridCell_size(*s));
+            *s = NULL;
+        }
+    }
+}
+
+static inline uint32_t ColumnGrid_hash(const char *s, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    for (const unsigned char *p = (const unsigned char*)s, *end = p + len; p < end; ++p)
+        hash = (hash ^ *p) * 16777619u;
+    return hash;
+}
+
+void ColumnGrid_freeDict(struct Arena *arena, struct ColumnDict *dict)
+{
+    // The cells are left alone when no arena is given, as they are still owned by a string column.
+    if (arena)
+    {
+        for (struct ColumnDictEntry *e = dict->entries, *end = dict->entries + dict->count; e < end; ++e)
+            Arena_release(arena, GridCell_size(e->cell));
+    }
+
+    if (dict->entries)
+        RedisModule_Free(dict->entries);
+    if (dict->slots)
+        RedisModule_Free(dict->slots);
+    RedisModule_Free(dict);
+}
+
+struct ColumnDict *ColumnGrid_copyDict(const struct ColumnDict *source)
+{
+    struct ColumnDict *dict = (struct ColumnDict*)RedisModule_Calloc(1, sizeof(struct ColumnDict));
+    if (!dict)
+        return NULL;
+
+    *dict = *source;
+    dict->entries = source->capacity ? (struct ColumnDictEntry*)RedisModule_Alloc(sizeof(struct ColumnDictEntry) * source->capacity) : NULL;
+    dict->slots = source->slots ? (uint32_t*)RedisModule_Alloc(sizeof(uint32_t) * (source->slot_mask + 1)) : NULL;
+    if ((source->capacity && !dict->entries) || (source->slots && !dict->slots))
+    {
+        ColumnGrid_freeDict(NULL, dict);
+        return NULL;
+    }
+
+    if (source->count)
+        memcpy(dict->entries, source->entries, sizeof(struct ColumnDictEntry) * source->count);
+    if (source->slots)
+        memcpy(dict->slots, source->slots, sizeof(uint32_t) * (source->slot_mask + 1));
+
+    return dict;
+}
+
+int ColumnGrid_rehashDict(struct ColumnDict *dict, size_t slot_count)
+{
+    uint32_t *slots = (uint32_t*)RedisModule_Calloc(slot_count, sizeof(uint32_t));
+    if (!slots)
+        return REDISMODULE_ERR;
+
+    size_t mask = slot_count - 1;
+    for (size_t i = 0; i < dict->count; ++i)
+    {
+        size_t j = dict->entries[i].hash & mask;
+        while (slots[j])
+            j = (j + 1) & mask;
+        slots[j] = (uint32_t)(i + 1);
+    }
+
+    if (dict->slots)
+        RedisModule_Free(dict->slots);
+    dict->slots = slots;
+    dict->slot_mask = mask;
+
+    return REDISMODULE_OK;
+}
+
+// Returns the code of the value, or 0 when it is not in the dictionary.
+uint32_t ColumnGrid_findDict(const struct ColumnDict *dict, const char *s, size_t len, uint32_t hash)
+{
+    if (!dict->slots)
+        return 0;
+
+    for (size_t j = hash & dict->slot_mask; dict->slots[j]; j = (j + 1) & dict->slot_mask)
+    {
+        const struct ColumnDictEntry *e = dict->entries + dict->slots[j] - 1;
+        if (e->hash == hash && GridCell_length(e->cell) == len && memcmp(GridCell_data(e->cell), s, len) == 0)
+            return dict->slots[j];
+    }
+
+    return 0;
+}
+
+// Adds a cell which is not yet in the dictionary and returns its code, or 0 on failure.
+uint32_t ColumnGrid_addDict(struct ColumnDict *dict, char *cell, uint32_t hash)
+{
+    if (!cell)
+        return 0;
+
+    if (dict->count == dict->capacity)
+    {
+        size_t capacity = dict->capacity ? dict->capacity * 2 : 16;
+        struct ColumnDictEntry *entries = (struct ColumnDictEntry*)RedisModule_Realloc(dict->entries, sizeof(struct ColumnDictEntry) * capacity);
+        if (!entries)
+            return 0;
+        dict->entries = entries;
+        dict->capacity = capacity;
+    }
+
+    // Keep the table at most half full.
+    size_t slot_count = dict->slots ? dict->slot_mask + 1 : 0;
+    if (2 * (dict->count + 1) > slot_count && ColumnGrid_rehashDict(dict, max(slot_count * 2, (size_t)32)) != REDISMODULE_OK)
+        return 0;
+
+    struct ColumnDictEntry *e = dict->entries + dict->count++;
+    e->cell = cell;
+    e->refs = 0;
+    e->hash = hash;
+
+    size_t j = hash & dict->slot_mask;
+    while (dict->slots[j])
+        j = (j + 1) & dict->slot_mask;
+    dict->slots[j] = (uint32_t)dict->count;
+
+    return (uint32_t)dict->count;
+}
+
+void ColumnGrid_setCode(struct Column *column, size_t row, uint32_t code)
+{
+    struct ColumnDict *dict = column->dict;
+
+    if (code && dict->entries[code - 1].refs++ == 0)
+        ++dict->live;
+
+    uint32_t old_code = column->codes[row];
+    if (old_code && --dict->entries[old_code - 1].refs == 0)
+        --dict->live;
+
+    column->codes[row] = code;
+}
+
+// Drops the values which no row uses any more, and renumbers the codes.
+int ColumnGrid_packDict(struct Arena *arena, struct Column *column, size_t rows)
+{
+    struct ColumnDict *dict = column->dict;
+    if (dict->live == dict->count)
+        return REDISMODULE_OK;
+
+    uint32_t *renumber = (uint32_t*)RedisModule_Alloc(sizeof(uint32_t) * (dict->count + 1));
+    if (!renumber)
+        return REDISMODULE_ERR;
+
+    renumber[0] = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < dict->count; ++i)
+    {
+        if (dict->entries[i].refs)
+        {
+            dict->entries[count] = dict->entries[i];
+            renumber[i + 1] = (uint32_t)++count;
+        }
+        else
+        {
+            Arena_release(arena, GridCell_size(dict->entries[i].cell));
+            renumber[i + 1] = 0;
+        }
+    }
+    dict->count = count;
+
+    for (uint32_t *p = column->codes, *end = column->codes + rows; p < end; ++p)
+        *p = renumber[*p];
+    RedisModule_Free(renumber);
+
+    return ColumnGrid_rehashDict(dict, dict->slot_mask + 1);
+}
+
+// Makes room for a new value, unless the column has too many distinct values for a dictionary to pay.
+int ColumnGrid_hasDictRoom(struct Arena *arena, struct Column *column, size_t rows)
+{
+    size_t limit = ColumnGrid_dictLimit(rows);
+    if (column->dict->count < limit)
+        return 1;
+
+    return ColumnGrid_packDict(arena, column, rows) == REDISMODULE_OK && column->dict->count <= limit / 2;
+}
+
+// Swaps a string column for a dictionary column, sharing the cells which are
+// kept. The column is left alone when it has too many distinct values.
+int ColumnGrid_encodeDict(struct Arena *arena, struct Column *column, size_t rows)
+{
+    struct ColumnDict *dict = (struct ColumnDict*)RedisModule_Calloc(1, sizeof(struct ColumnDict));
+    uint32_t *codes = (uint32_t*)RedisModule_Alloc(sizeof(uint32_t) * max(rows, (size_t)1));
+    if (!dict || !codes)
+    {
+        if (dict)
+            RedisModule_Free(dict);
+        if (codes)
+            RedisModule_Free(codes);
+        return REDISMODULE_ERR;
+    }
+
+    size_t limit = ColumnGrid_dictLimit(rows);
+    for (size_t r = 0; r < rows; ++r)
+    {
+        char *cell = column->strings[r];
+        uint32_t code = 0;
+        if (cell)
+        {
+            uint32_t hash = ColumnGrid_hash(GridCell_data(cell), GridCell_length(cell));
+            code = ColumnGrid_findDict(dict, GridCell_data(cell), GridCell_length(cell), hash);
+            if (!code && (dict->count >= limit || !(code = ColumnGrid_addDict(dict, cell, hash))))
+            {
+                ColumnGrid_freeDict(NULL, dict);
+                RedisModule_Free(codes);
+                return REDISMODULE_ERR;
+            }
+            ++dict->entries[code - 1].refs;
+        }
+        codes[r] = code;
+    }
+
+    // Release the duplicates of the values which were kept.
+    for (size_t r = 0; r < rows; ++r)
+    {
+        if (column->strings[r] && column->strings[r] != dict->entries[codes[r] - 1].cell)
+            Arena_release(arena, GridCell_size(column->strings[r]));
+    }
+
+    dict->live = dict->count;
+    RedisModule_Free(column->strings);
+    column->codes = codes;
+    column->dict = dict;
+    column->type = COLUMN_TYPE_DICT;
+
+    return REDISMODULE_OK;
+}
+
+// Gives every row of a dictionary column its own cell again.
+int ColumnGrid_decodeDict(struct Arena *arena, struct Column *column, size_t rows)
+{
+    char **strings = (char**)RedisModule_Calloc(max(rows, (size_t)1), sizeof(char*));
+    if (!strings)
+        return REDISMODULE_ERR;
+
+    for (size_t r = 0; r < rows; ++r)
+    {
+        const char *cell = ColumnGrid_dictCell(column, r);
+        if (cell && !(strings[r] = GridCell_copy(arena, cell)))
+        {
+            ColumnGrid_releaseCells(arena, strings, strings + r);
+            RedisModule_Free(strings);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    ColumnGrid_freeDict(arena, column->dict);
+    RedisModule_Free(column->codes);
+    column->dict = NULL;
+    column->strings = strings;
+    column->type = COLUMN_TYPE_STRING;
+
+    return REDISMODULE_OK;
+}
+
+void ColumnGrid_releaseColumn(struct Arena *arena, struct Column *column, size_t rows)
+{
+    // The vectors of a shared column are still in use by another grid.
+    if (column->shares && --*column->shares > 0)
+        return;
+    if (column->shares)
+        RedisModule_Free(column->shares);
+
+    if (column->type == COLUMN_TYPE_STRING)
+        ColumnGrid_releaseCells(arena, column->strings, column->strings + rows);
+    else if (column->type == COLUMN_TYPE_DICT)
+        ColumnGrid_freeDict(arena, column->dict);
+
+    ColumnGrid_truncateText(arena, column, 0);
+    if (column->text)
+        RedisModule_Free(column->text);
+
+    RedisModule_Free(column->ints);
+    if (column->nulls)
+        RedisModule_Free(column->nulls);
+}
+
+int ColumnGrid_resizeColumn(struct Arena *arena, struct Column *column, size_t old_rows, size_t rows)
+{
+    if (column->type == COLUMN_TYPE_STRING)
+        ColumnGrid_releaseCells(arena, column->strings + rows, column->strings + old_rows);
+    else if (column->type == COLUMN_TYPE_DICT)
+    {
+        for (size_t r = rows; r < old_rows; ++r)
+            ColumnGrid_setCode(column, r, 0);
+    }
+
+    ColumnGrid_truncateText(arena, column, rows);
+
+    // The vector can be resized through any member as only the size of the slot differs.
+    column->ints = (long long*)RedisModule_Realloc(column->ints, ColumnGrid_slotSize(column) * rows);
+    if (!column->ints)
+        return REDISMODULE_ERR;
+
+    if (column->type == COLUMN_TYPE_STRING)
+    {
+        if (rows > old_rows)
+            memset(column->strings + old_rows, 0, sizeof(char*) * (rows - old_rows));
+    }
+    else if (column->type == COLUMN_TYPE_DICT)
+    {
+        if (rows > old_rows)
+            memset(column->codes + old_rows, 0, sizeof(uint32_t) * (rows - old_rows));
+    }
+    else
+    {
+        column->nulls = (uint64_t*)RedisModule_Realloc(column->nulls, sizeof(uint64_t) * ColumnGrid_nullWords(rows));
+        if (!column->nulls)
+            return REDISMODULE_ERR;
+        if (rows > old_rows)
+            ColumnGrid_setNullBits(column, old_rows, rows);
+    }
+
+    return REDISMODULE_OK;
+}
+
+const char *ColumnGrid_formatCell(const struct Column *column, size_t row, char *buf, size_t *len)
+{
+    switch (column->type)
+    {
+    case COLUMN_TYPE_STRING:
+    {
+        const char *cell = column->strings[row];
+        if (!cell)
+            return NULL;
+        *len = GridCell_length(cell);
+        return GridCell_data(cell);
+    }
+    case COLUMN_TYPE_DICT:
+    {
+        const char *cell = ColumnGrid_dictCell(column, row);
+        if (!cell)
+            return NULL;
+        *len = GridCell_length(cell);
+        return GridCell_data(cell);
+    }
+    case COLUMN_TYPE_INT64:
+        if (ColumnGrid_isNull(column, row))
+            return NULL;
+        *len = GridType_formatLongLong(column->ints[row], buf);
+        return buf;
+    default:
+        if (ColumnGrid_isNull(column, row))
+            return NULL;
+        const char *text = ColumnGrid_getText(column, row);
+        if (text)
+        {
+            *len = GridCell_length(text);
+            return GridCell_data(text);
+        }
+        *len = GridType_formatDouble(column->doubles[row], buf);
+        return buf;
+    }
+}
+
+int ColumnGrid_promoteToDouble(struct Arena *arena, struct Column *column, size_t rows)
+{
+    // Only promote when every integer can be held exactly.
+    for (size_t r = 0; r < rows; ++r)
+    {
+        long long value = column->ints[r];
+        if (!ColumnGrid_isNull(column, r) && (value > COLUMN_MAX_EXACT_INT || value < -COLUMN_MAX_EXACT_INT))
+            return REDISMODULE_ERR;
+    }
+
+    // Keep the integer text where the double would format differently, for example 1e+15.
+    char int_text[GRID_NUMBER_BUFSIZE], double_text[GRID_NUMBER_BUFSIZE];
+    for (size_t r = 0; r < rows; ++r)
+    {
+        if (ColumnGrid_isNull(column, r))
+            continue;
+
+        long long value = column->ints[r];
+        size_t len = GridType_formatLongLong(value, int_text);
+        if (GridType_formatDouble((double)value, double_text) != len || memcmp(int_text, double_text, len) != 0)
+        {
+            if (ColumnGrid_setText(arena, column, r, int_text, len) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+        column->doubles[r] = (double)value;
+    }
+
+    column->type = COLUMN_TYPE_DOUBLE;
+
+    return REDISMODULE_OK;
+}
+
+int ColumnGrid_promoteToString(struct Arena *arena, struct Column *column, size_t rows)
+{
+    // The text replaces each number in its own slot.
+    char buf[GRID_NUMBER_BUFSIZE];
+    struct ColumnText *text = column->text, *text_end = column->text + column->text_count;
+    for (size_t r = 0; r < rows; ++r)
+    {
+        if (text < text_end && text->row == r)
+        {
+            column->strings[r] = (text++)->cell;
+            continue;
+        }
+
+        size_t len;
+        const char *text = ColumnGrid_formatCell(column, r, buf, &len);
+        if (!text)
+        {
+            column->strings[r] = NULL;
+        }
+        else
+        {
+            column->strings[r] = GridCell_create(arena, text, len);
+            if (!column->strings[r])
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (column->text)
+    {
+        RedisModule_Free(column->text);
+        column->text = NULL;
+        column->text_count = 0;
+        column->text_capacity = 0;
+    }
+
+    RedisModule_Free(column->nulls);
+    column->nulls = NULL;
+    column->type = COLUMN_TYPE_STRING;
+
+    return REDISMODULE_OK;
+}
+
+// Numbers are replaced by text, which is dictionary encoded when that is enabled and pays.
+int ColumnGrid_promoteToText(struct Arena *arena, struct Column *column, size_t rows)
+{
+    if (ColumnGrid_promoteToString(arena, column, rows) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    if (dictionary_encoding)
+        ColumnGrid_encodeDict(arena, column, rows);
+
+    return REDISMODULE_OK;
+}
+
+int ColumnGrid_setValue(struct Arena *arena, struct Column *column, size_t rows, size_t row, const char *s, size_t len)
+{
+    if (len == 0)
+    {
+        if (column->type == COLUMN_TYPE_DICT)
+            ColumnGrid_setCode(column, row, 0);
+        else if (column->type != COLUMN_TYPE_STRING)
+        {
+            ColumnGrid_setNullBits(column, row, row + 1);
+            return ColumnGrid_setText(arena, column, row, NULL, 0);
+        }
+        else if (column->strings[row])
+        {
+            Arena_release(arena, GridCell_size(column->strings[row]));
+            column->strings[row] = NULL;
+        }
+        return REDISMODULE_OK;
+    }
+
+    if (column->type == COLUMN_TYPE_INT64)
+    {
+        long long value;
+        if (GridType_parseLongLong(s, len, &value) == REDISMODULE_OK)
+        {
+            column->ints[row] = value;
+            column->nulls[row / 64] &= ~((uint64_t)1 << (row % 64));
+            return REDISMODULE_OK;
+        }
+
+        double d;
+        if (GridType_parseDouble(s, len, &d) != REDISMODULE_OK || ColumnGrid_promoteToDouble(arena, column, rows) != REDISMODULE_OK)
+        {
+            if (ColumnGrid_promoteToText(arena, column, rows) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (column->type == COLUMN_TYPE_DOUBLE)
+    {
+        double value;
+        if (GridType_parseDouble(s, len, &value) == REDISMODULE_OK)
+        {
+            column->doubles[row] = value;
+            column->nulls[row / 64] &= ~((uint64_t)1 << (row % 64));
+
+            // Keep the text when the number would not be returned as it was written.
+            char text[GRID_NUMBER_BUFSIZE];
+            int is_canonical = GridType_formatDouble(value, text) == len && memcmp(text, s, len) == 0;
+            return ColumnGrid_setText(arena, column, row, is_canonical ? NULL : s, len);
+        }
+
+        if (ColumnGrid_promoteToText(arena, column, rows) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+    }
+
+    if (column->type == COLUMN_TYPE_DICT)
+    {
+        uint32_t hash = ColumnGrid_hash(s, len);
+        uint32_t code = ColumnGrid_findDict(column->dict, s, len, hash);
+        if (!code && ColumnGrid_hasDictRoom(arena, column, rows))
+        {
+            // A cell the dictionary could not take is released back to the arena.
+            char *cell = GridCell_create(arena, s, len);
+            code = ColumnGrid_addDict(column->dict, cell, hash);
+            if (!code && cell)
+                Arena_release(arena, GridCell_size(cell));
+        }
+
+        if (code)
+        {
+            ColumnGrid_setCode(column, row, code);
+            return REDISMODULE_OK;
+        }
+
+        // There are too many distinct values, so fall back to a cell for each row.
+        if (ColumnGrid_decodeDict(arena, column, rows) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+    }
+
+    if (column->strings[row])
+        Arena_release(arena, GridCell_size(column->strings[row]));
+    column->strings[row] = GridCell_create(arena, s, len);
+
+    return column->strings[row] ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+int ColumnGrid_setRedisString(struct Arena *arena, struct Column *column, size_t rows, size_t row, RedisModuleString *source)
+{
+    size_t len;
+    const char *s = RedisModule_StringPtrLen(source, &len);
+    return ColumnGrid_setValue(arena, column, rows, row, s, len);
+}
+
+void ColumnGrid_releaseColumns(struct ColumnGrid *o)
+{
+    for (struct Column *c = o->cstart; c < o->cend; ++c)
+        ColumnGrid_releaseColumn(&o->arena, c, o->rows);
+    RedisModule_Free(o->cstart);
+}
+
+int ColumnGrid_allocColumns(struct ColumnGrid *o, size_t rows, size_t columns)
+{
+    o->cstart = (struct Column*)RedisModule_Alloc(sizeof(struct Column) * columns);
+    if (!o->cstart)
+        return REDISMODULE_ERR;
+
+    o->rows = rows;
+    o->columns = columns;
+    o->cend = o->cstart + columns;
+
+    for (struct Column *c = o->cstart; c < o->cend; ++c)
+    {
+        if (ColumnGrid_initColumn(c, rows) != REDISMODULE_OK)
+        {
+            o->cend = c + 1;
+            ColumnGrid_releaseColumns(o);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    return REDISMODULE_OK;
+}
+
+int ColumnGrid_copyRedisStrings(struct ColumnGrid *o, RedisModuleString **source)
+{
+    if (!source)
+        return REDISMODULE_OK;
+
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        for (struct Column *c = o->cstart; c < o->cend; ++c, ++source)
+        {
+            if (ColumnGrid_setRedisString(&o->arena, c, o->rows, r, *source) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    return REDISMODULE_OK;
+}
+
+struct ColumnGrid *ColumnGrid_createObject(size_t rows, size_t columns, RedisModuleString **source)
+{
+    struct ColumnGrid *o = (struct ColumnGrid *)RedisModule_Alloc(sizeof(struct ColumnGrid));
+    if (!o)
+        return NULL;
+
+    Arena_init(&o->arena);
+
+    if (ColumnGrid_allocColumns(o, rows, columns) != REDISMODULE_OK)
+    {
+        RedisModule_Free(o);
+        return NULL;
+    }
+
+    if (ColumnGrid_copyRedisStrings(o, source) != REDISMODULE_OK)
+    {
+        ColumnGrid_releaseObject(o);
+        return NULL;
+    }
+
+    return o;
+}
+
+int ColumnGrid_copyColumn(struct Column *column, const struct Column *source, size_t rows)
+{
+    *column = *source;
+    column->shares = NULL;
+    column->nulls = NULL;
+    column->text = NULL;
+    column->dict = NULL;
+
+    column->ints = (long long*)RedisModule_Alloc(ColumnGrid_slotSize(source) * rows);
+    if (source->nulls)
+        column->nulls = (uint64_t*)RedisModule_Alloc(sizeof(uint64_t) * ColumnGrid_nullWords(rows));
+    if (source->text_capacity)
+        column->text = (struct ColumnText*)RedisModule_Alloc(sizeof(struct ColumnText) * source->text_capacity);
+    if (source->dict)
+        column->dict = ColumnGrid_copyDict(source->dict);
+
+    if ((!column->ints && rows > 0) || (source->nulls && !column->nulls) || (source->text_capacity && !column->text) || (source->dict && !column->dict))
+    {
+        RedisModule_Free(column->ints);
+        if (column->nulls)
+            RedisModule_Free(column->nulls);
+        if (column->text)
+            RedisModule_Free(column->text);
+        if (column->dict)
+            ColumnGrid_freeDict(NULL, column->dict);
+        return REDISMODULE_ERR;
+    }
+
+    memcpy(column->ints, source->ints, ColumnGrid_slotSize(source) * rows);
+    if (source->nulls)
+        memcpy(column->nulls, source->nulls, sizeof(uint64_t) * ColumnGrid_nullWords(rows));
+    if (source->text_count)
+        memcpy(column->text, source->text, sizeof(struct ColumnText) * source->text_count);
+
+    return REDISMODULE_OK;
+}
+
+// Copies the vectors of a shared column before it is written, so the other grids holding
+// them are unchanged.
+int ColumnGrid_ownColumn(struct Column *column, size_t rows)
+{
+    if (!column->shares)
+        return REDISMODULE_OK;
+
+    if (*column->shares == 1)
+    {
+        RedisModule_Free(column->shares);
+        column->shares = NULL;
+        return REDISMODULE_OK;
+    }
+
+    struct Column copy;
+    if (ColumnGrid_copyColumn(&copy, column, rows) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    --*column->shares;
+    *column = copy;
+    return REDISMODULE_OK;
+}
+
+int ColumnGrid_ownColumns(struct ColumnGrid *o, size_t column_start, size_t column_end)
+{
+    for (struct Column *c = o->cstart + column_start, *cend = o->cstart + column_end; c <= cend; ++c)
+    {
+        if (ColumnGrid_ownColumn(c, o->rows) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+    }
+    return REDISMODULE_OK;
+}
+
+struct ColumnGrid *ColumnGrid_copyObject(const struct ColumnGrid *o)
+{
+    struct ColumnGrid *copy = (struct ColumnGrid *)RedisModule_Alloc(sizeof(struct ColumnGrid));
+    if (!copy)
+        return NULL;
+
+    copy->cstart = (struct Column*)RedisModule_Alloc(sizeof(struct Column) * o->columns);
+    if (!copy->cstart && o->columns > 0)
+    {
+        RedisModule_Free(copy);
+        return NULL;
+    }
+
+    copy->rows = o->rows;
+    copy->columns = o->columns;
+    copy->cend = copy->cstart + o->columns;
+    Arena_share(&copy->arena, &o->arena);
+
+    // The vectors of the columns are shared until one of the grids writes to them, and the
+    // cells are shared with the original through the arena. The shares of the original are
+    // counted through its columns, which are otherwise left as they are.
+    for (struct Column *c = (struct Column*)o->cstart, *d = copy->cstart; c < o->cend; ++c, ++d)
+    {
+        if (!c->shares)
+        {
+            c->shares = (size_t*)RedisModule_Alloc(sizeof(size_t));
+            if (!c->shares)
+            {
+                copy->cend = d;
+                ColumnGrid_releaseObject(copy);
+                return NULL;
+            }
+            *c->shares = 1;
+        }
+        ++*c->shares;
+        *d = *c;
+    }
+
+    return copy;
+}
+
+void ColumnGrid_releaseObject(struct ColumnGrid *o)
+{
+    ColumnGrid_releaseColumns(o);
+    Arena_free(&o->arena);
+    RedisModule_Free(o);
+}
+
+void ColumnGrid_compact(struct ColumnGrid *o)
+{
+    // The cells of every column move to the new arena, so no column can be shared.
+    if (o->columns == 0 || ColumnGrid_ownColumns(o, 0, o->columns - 1) != REDISMODULE_OK)
+        return;
+
+    struct Arena arena;
+    Arena_init(&arena);
+    if (Arena_reserve(&arena, Arena_liveBytes(&o->arena)) != REDISMODULE_OK)
+        return;
+
+    for (struct Column *c = o->cstart; c < o->cend; ++c)
+    {
+        if (c->type == COLUMN_TYPE_STRING)
+        {
+            for (char **s = c->strings, **send = c->strings + o->rows; s < send; ++s)
+            {
+                if (*s)
+                    *s = GridCell_copy(&arena, *s);
+            }
+        }
+        else if (c->type == COLUMN_TYPE_DICT)
+        {
+            for (struct ColumnDictEntry *e = c->dict->entries, *eend = c->dict->entries + c->dict->count; e < eend; ++e)
+                e->cell = GridCell_copy(&arena, e->cell);
+        }
+
+        for (struct ColumnText *t = c->text, *tend = c->text + c->text_count; t < tend; ++t)
+            t->cell = GridCell_copy(&arena, t->cell);
+    }
+
+    Arena_free(&o->arena);
+    o->arena = arena;
+}
+
+int ColumnGrid_setObject(struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    if (ColumnGrid_ownColumns(o, (size_t)min(column_start, column_end), (size_t)max(column_start, column_end)) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+    {
+        for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++source)
+        {
+            if (ColumnGrid_setRedisString(&o->arena, o->cstart + c, o->rows, (size_t)r, *source) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (Arena_shouldCompact(&o->arena))
+        ColumnGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int ColumnGrid_setBlobValue(struct Arena *arena, struct Column *column, size_t rows, size_t row, const struct BlobReader *blob, size_t blob_column, size_t blob_row)
+{
+    // Numbers which land in a column of their own type skip the text round trip.
+    if (Blob_isValid(blob, blob_column, blob_row))
+    {
+        unsigned char type = Blob_columnType(blob, blob_column);
+        if (type == BLOB_TYPE_INT64 && column->type == COLUMN_TYPE_INT64)
+        {
+            column->ints[row] = Blob_getInt(blob, blob_column, blob_row);
+            column->nulls[row / 64] &= ~((uint64_t)1 << (row % 64));
+            return REDISMODULE_OK;
+        }
+
+        double value;
+        if (type == BLOB_TYPE_DOUBLE && column->type == COLUMN_TYPE_DOUBLE && isfinite(value = Blob_getDouble(blob, blob_column, blob_row)))
+        {
+            column->doubles[row] = value;
+            column->nulls[row / 64] &= ~((uint64_t)1 << (row % 64));
+            return ColumnGrid_setText(arena, column, row, NULL, 0);
+        }
+    }
+
+    char buf[GRID_NUMBER_BUFSIZE];
+    size_t len;
+    const char *text = Blob_formatCell(blob, blob_column, blob_row, buf, &len);
+    return ColumnGrid_setValue(arena, column, rows, row, text ? text : "", text ? len : 0);
+}
+
+int ColumnGrid_setBlobObject(struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    if (ColumnGrid_ownColumns(o, (size_t)min(column_start, column_end), (size_t)max(column_start, column_end)) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t j = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++j)
+    {
+        size_t i = 0;
+        for (long long r = row_start; r != row_end + row_sign; r += row_sign, ++i)
+        {
+            if (ColumnGrid_setBlobValue(&o->arena, o->cstart + c, o->rows, (size_t)r, blob, j, i) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (Arena_shouldCompact(&o->arena))
+        ColumnGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int ColumnGrid_resizeAndCopyObject(struct ColumnGrid *o, size_t rows, size_t columns)
+{
+    if (rows == o->rows && columns == o->columns)
+        return REDISMODULE_OK;
+
+    // Drop any surplus columns.
+    for (struct Column *c = o->cstart + min(columns, o->columns); c < o->cend; ++c)
+        ColumnGrid_releaseColumn(&o->arena, c, o->rows);
+
+    // Resize the columns which are kept.
+    if (rows != o->rows)
+    {
+        for (struct Column *c = o->cstart, *cend = o->cstart + min(columns, o->columns); c < cend; ++c)
+        {
+            if (ColumnGrid_ownColumn(c, o->rows) != REDISMODULE_OK || ColumnGrid_resizeColumn(&o->arena, c, o->rows, rows) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (columns != o->columns)
+    {
+        o->cstart = (struct Column*)RedisModule_Realloc(o->cstart, sizeof(struct Column) * columns);
+        if (!o->cstart)
+            return REDISMODULE_ERR;
+
+        // Add empty columns.
+        for (struct Column *c = o->cstart + o->columns, *cend = o->cstart + columns; c < cend; ++c)
+        {
+            if (ColumnGrid_initColumn(c, rows) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    o->rows = rows;
+    o->columns = columns;
+    o->cend = o->cstart + columns;
+
+    if (Arena_shouldCompact(&o->arena))
+        ColumnGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+// Each column is held apart from the others, so columns are inserted and deleted by moving the columns after them.
+int ColumnGrid_insertColumns(struct ColumnGrid *o, size_t column, size_t count)
+{
+    struct Column *cstart = (struct Column*)RedisModule_Realloc(o->cstart, sizeof(struct Column) * (o->columns + count));
+    if (!cstart)
+        return REDISMODULE_ERR;
+
+    o->cstart = cstart;
+    o->cend = cstart + o->columns;
+
+    struct Column *c = cstart + column;
+    memmove(c + count, c, sizeof(struct Column) * (o->columns - column));
+    for (struct Column *p = c; p < c + count; ++p)
+    {
+        if (ColumnGrid_initColumn(p, o->rows) != REDISMODULE_OK)
+        {
+            for (struct Column *q = c; q < p; ++q)
+                ColumnGrid_releaseColumn(&o->arena, q, o->rows);
+            memmove(c, c + count, sizeof(struct Column) * (o->columns - column));
+            return REDISMODULE_ERR;
+        }
+    }
+
+    o->columns += count;
+    o->cend = o->cstart + o->columns;
+
+    return REDISMODULE_OK;
+}
+
+void ColumnGrid_deleteColumns(struct ColumnGrid *o, size_t column, size_t count)
+{
+    struct Column *c = o->cstart + column;
+    for (struct Column *p = c; p < c + count; ++p)
+        ColumnGrid_releaseColumn(&o->arena, p, o->rows);
+
+    memmove(c, c + count, sizeof(struct Column) * (o->columns - column - count));
+    o->columns -= count;
+    o->cend = o->cstart + o->columns;
+
+    if (Arena_shouldCompact(&o->arena))
+        ColumnGrid_compact(o);
+}
+
+static int ColumnGrid_compareTextRows(const void *a, const void *b)
+{
+    size_t x = ((const struct ColumnText*)a)->row, y = ((const struct ColumnText*)b)->row;
+    return x < y ? -1 : x > y;
+}
+
+// Each typed vector is gathered through the order into a buffer and copied back, so the
+// values of a column are moved without formatting or parsing them.
+int ColumnGrid_permuteRows(struct ColumnGrid *o, const size_t *order)
+{
+    size_t rows = o->rows, words = ColumnGrid_nullWords(rows);
+    uint64_t *buffer = (uint64_t*)RedisModule_Alloc(sizeof(uint64_t) * (rows > words ? rows : words));
+    size_t *inverse = NULL;
+    if (!buffer)
+        return REDISMODULE_ERR;
+
+    for (struct Column *c = o->cstart; c < o->cend; ++c)
+    {
+        if (ColumnGrid_ownColumn(c, rows) != REDISMODULE_OK)
+        {
+            if (inverse)
+                RedisModule_Free(inverse);
+            RedisModule_Free(buffer);
+            return REDISMODULE_ERR;
+        }
+
+        switch (c->type)
+        {
+        case COLUMN_TYPE_STRING:
+            for (size_t r = 0; r < rows; ++r)
+                ((char**)buffer)[r] = c->strings[order[r]];
+            memcpy(c->strings, buffer, sizeof(char*) * rows);
+            break;
+        case COLUMN_TYPE_DICT:
+            for (size_t r = 0; r < rows; ++r)
+                ((uint32_t*)buffer)[r] = c->codes[order[r]];
+            memcpy(c->codes, buffer, sizeof(uint32_t) * rows);
+            break;
+        default:
+            // The int and double vectors hold 8 byte values, so both are moved as their bits.
+            for (size_t r = 0; r < rows; ++r)
+                buffer[r] = ((uint64_t*)c->ints)[order[r]];
+            memcpy(c->ints, buffer, sizeof(uint64_t) * rows);
+
+            memset(buffer, 0xff, sizeof(uint64_t) * words);
+            for (size_t r = 0; r < rows; ++r)
+            {
+                if (!ColumnGrid_isNull(c, order[r]))
+                    buffer[r / 64] &= ~((uint64_t)1 << (r % 64));
+            }
+            memcpy(c->nulls, buffer, sizeof(uint64_t) * words);
+
+            // The text overrides move to the new rows of their numbers, and are kept sorted by row.
+            if (c->text_count)
+            {
+                if (!inverse)
+                {
+                    inverse = (size_t*)RedisModule_Alloc(sizeof(size_t) * rows);
+                    if (!inverse)
+                    {
+                        RedisModule_Free(buffer);
+                        return REDISMODULE_ERR;
+                    }
+                    for (size_t r = 0; r < rows; ++r)
+                        inverse[order[r]] = r;
+                }
+
+                for (size_t i = 0; i < c->text_count; ++i)
+                    c->text[i].row = inverse[c->text[i].row];
+                qsort(c->text, c->text_count, sizeof(struct ColumnText), ColumnGrid_compareTextRows);
+            }
+            break;
+        }
+    }
+
+    if (inverse)
+        RedisModule_Free(inverse);
+    RedisModule_Free(buffer);
+
+    return REDISMODULE_OK;
+}
+
+int ColumnGrid_resizeAndReplaceObject(struct ColumnGrid *o, size_t rows, size_t columns, RedisModuleString **source)
+{
+    if (rows == o->rows && columns == o->columns)
+        return ColumnGrid_setObject(o, 0, rows - 1, 0, columns - 1, source);
+
+    // Every value is replaced, so start again with fresh columns which take their types from the new values.
+    ColumnGrid_releaseColumns(o);
+    Arena_free(&o->arena);
+
+    if (ColumnGrid_allocColumns(o, rows, columns) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    return ColumnGrid_copyRedisStrings(o, source);
+}
+
+void ColumnGrid_replyWithCell(RedisModuleCtx *ctx, const struct Column *column, size_t row)
+{
+    char buf[GRID_NUMBER_BUFSIZE];
+    size_t len;
+    const char *s = ColumnGrid_formatCell(column, row, buf, &len);
+    if (s)
+        RedisModule_ReplyWithStringBuffer(ctx, s, len);
+    else
+        RedisModule_ReplyWithNull(ctx);
+}
+
+void ColumnGrid_rangeObject(RedisModuleCtx *ctx, struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end)) / row_step;
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end)) / column_step;
+    RedisModule_ReplyWithArray(ctx, (long)(rows * columns));
+
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+    {
+        for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+            ColumnGrid_replyWithCell(ctx, o->cstart + c, (size_t)r);
+    }
+}
+
+// Replies the cells of the range a column at a time, without an array header. Each column is
+// read in order from its vector.
+void ColumnGrid_replyColumns(RedisModuleCtx *ctx, struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+    {
+        const struct Column *column = o->cstart + c;
+        for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+            ColumnGrid_replyWithCell(ctx, column, (size_t)r);
+    }
+}
+
+// A numeric column is exported as text when the snapshot must keep the text of every cell.
+int ColumnGrid_isBlobText(const struct Column *column, int keep_text)
+{
+    return column->type == COLUMN_TYPE_STRING || column->type == COLUMN_TYPE_DICT || (keep_text && column->text_count > 0);
+}
+
+void ColumnGrid_gatherCells(struct Arena *scratch, const struct Column *column, char **cells, long long row_start, long long row_end)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+    {
+        if (column->type == COLUMN_TYPE_STRING)
+        {
+            *cells++ = column->strings[r];
+            continue;
+        }
+
+        if (column->type == COLUMN_TYPE_DICT)
+        {
+            *cells++ = (char*)ColumnGrid_dictCell(column, (size_t)r);
+            continue;
+        }
+
+        const char *text = ColumnGrid_getText(column, (size_t)r);
+        if (text)
+        {
+            *cells++ = (char*)text;
+            continue;
+        }
+
+        char buf[GRID_NUMBER_BUFSIZE];
+        size_t len;
+        const char *value = ColumnGrid_formatCell(column, (size_t)r, buf, &len);
+        *cells++ = value ? GridCell_create(scratch, value, len) : NULL;
+    }
+}
+
+char *ColumnGrid_rangeBlobObject(struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int keep_text, size_t *len)
+{
+    size_t rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    size_t columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    // Text columns are gathered into range order; numeric columns are copied straight from their vectors.
+    char **cells = (char**)RedisModule_Alloc(sizeof(char*) * rows);
+    struct Arena scratch;
+    Arena_init(&scratch);
+
+    size_t size = Blob_headerSize(columns);
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        const struct Column *column = o->cstart + c;
+        if (!ColumnGrid_isBlobText(column, keep_text))
+        {
+            size += Blob_numberColumnSize(rows);
+            continue;
+        }
+
+        ColumnGrid_gatherCells(&scratch, column, cells, row_start, row_end);
+        size_t column_size = Blob_stringColumnSize(cells, rows);
+        if (column_size == BLOB_TOO_LARGE)
+        {
+            Arena_free(&scratch);
+            RedisModule_Free(cells);
+            return NULL;
+        }
+        size += column_size;
+    }
+
+    // Cells formatted while measuring are not needed again.
+    Arena_free(&scratch);
+    Arena_init(&scratch);
+
+    char *blob = (char*)RedisModule_Alloc(size);
+    char *p = Blob_writeHeader(blob, rows, columns);
+    size_t i = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++i)
+    {
+        const struct Column *column = o->cstart + c;
+        if (ColumnGrid_isBlobText(column, keep_text))
+        {
+            ColumnGrid_gatherCells(&scratch, column, cells, row_start, row_end);
+            p = Blob_writeStringColumn(blob, p, i, cells, rows);
+        }
+        else if (column->type == COLUMN_TYPE_INT64)
+            p = Blob_writeNumberColumn(blob, p, i, BLOB_TYPE_INT64, (const uint64_t*)column->ints, column->nulls, row_start, row_end);
+        else
+            p = Blob_writeNumberColumn(blob, p, i, BLOB_TYPE_DOUBLE, (const uint64_t*)column->doubles, column->nulls, row_start, row_end);
+    }
+
+    Arena_free(&scratch);
+    RedisModule_Free(cells);
+
+    *len = size;
+    return blob;
+}
+
+int ColumnGrid_getDouble(const struct Column *column, size_t row, double *value)
+{
+    switch (column->type)
+    {
+    case COLUMN_TYPE_STRING:
+        return GridCell_toDouble(column->strings[row], value);
+    case COLUMN_TYPE_DICT:
+        return GridCell_toDouble(ColumnGrid_dictCell(column, row), value);
+    case COLUMN_TYPE_INT64:
+        if (ColumnGrid_isNull(column, row))
+            return REDISMODULE_ERR;
+        *value = (double)column->ints[row];
+        return REDISMODULE_OK;
+    default:
+        if (ColumnGrid_isNull(column, row))
+            return REDISMODULE_ERR;
+        *value = column->doubles[row];
+        return REDISMODULE_OK;
+    }
+}
+
+// Each distinct value is parsed once, then the rows only look up their code.
+void ColumnGrid_aggregateDict(struct Aggregate *a, const struct Column *column, size_t row_start, size_t row_end)
+{
+    const struct ColumnDict *dict = column->dict;
+
+    // The dictionary is only parsed up front when the range is longer than it, as short ranges
+    // (such as the buckets of a downsample) would spend their time parsing unused entries.
+    int is_parsed = row_end - row_start > dict->count;
+    double *values = is_parsed ? (double*)RedisModule_Alloc(sizeof(double) * (dict->count + 1)) : NULL;
+    unsigned char *is_number = is_parsed ? (unsigned char*)RedisModule_Calloc(dict->count + 1, sizeof(unsigned char)) : NULL;
+
+    if (values && is_number)
+    {
+        for (size_t i = 0; i < dict->count; ++i)
+            is_number[i + 1] = GridCell_toDouble(dict->entries[i].cell, values + i + 1) == REDISMODULE_OK;
+
+        for (const uint32_t *p = column->codes + row_start, *end = column->codes + row_end; p < end; ++p)
+        {
+            if (is_number[*p])
+                Aggregate_add(a, values[*p]);
+        }
+    }
+    else
+    {
+        for (size_t r = row_start; r < row_end; ++r)
+        {
+            double value;
+            if (GridCell_toDouble(ColumnGrid_dictCell(column, r), &value) == REDISMODULE_OK)
+                Aggregate_add(a, value);
+        }
+    }
+
+    if (values)
+        RedisModule_Free(values);
+    if (is_number)
+        RedisModule_Free(is_number);
+}
+
+void ColumnGrid_aggregateObject(struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+    size_t row_first = (size_t)min(row_start, row_end), row_last = (size_t)max(row_start, row_end);
+
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        const struct Column *column = o->cstart + c;
+
+        if (axis == AGGREGATE_AXIS_ROWS)
+        {
+            for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+            {
+                double value;
+                if (ColumnGrid_getDouble(column, (size_t)r, &value) == REDISMODULE_OK)
+                    Aggregate_add(results + (r - row_start) * row_sign, value);
+            }
+            continue;
+        }
+
+        // Down a column the order of the rows does not matter, so numeric columns are scanned forwards in place.
+        struct Aggregate *a = axis == AGGREGATE_AXIS_COLUMNS ? results + (c - column_start) * column_sign : results;
+        switch (column->type)
+        {
+        case COLUMN_TYPE_INT64:
+            Aggregate_addInts(a, column->ints, column->nulls, row_first, row_last + 1);
+            break;
+        case COLUMN_TYPE_DOUBLE:
+            Aggregate_addDoubles(a, column->doubles, column->nulls, row_first, row_last + 1);
+            break;
+        case COLUMN_TYPE_DICT:
+            ColumnGrid_aggregateDict(a, column, row_first, row_last + 1);
+            break;
+        default:
+            for (size_t r = row_first; r <= row_last; ++r)
+            {
+                double value;
+                if (GridCell_toDouble(column->strings[r], &value) == REDISMODULE_OK)
+                    Aggregate_add(a, value);
+            }
+            break;
+        }
+    }
+}
+
+// Each distinct value is matched once, then the rows only look up their code.
+void ColumnGrid_filterDict(const struct Column *column, const struct Filter *filter, size_t rows, uint64_t *bits)
+{
+    const struct ColumnDict *dict = column->dict;
+
+    unsigned char *is_match = (unsigned char*)RedisModule_Calloc(dict->count + 1, sizeof(unsigned char));
+    for (size_t i = 0; i < dict->count; ++i)
+        is_match[i + 1] = Filter_matchCell(filter, dict->entries[i].cell);
+
+    for (size_t r = 0; r < rows; ++r)
+    {
+        if (is_match[column->codes[r]])
+            Filter_setBit(bits, r);
+    }
+
+    RedisModule_Free(is_match);
+}
+
+void ColumnGrid_filterObject(const struct ColumnGrid *o, const struct Filter *filter, uint64_t *bits)
+{
+    const struct Column *column = o->cstart + filter->column;
+
+    switch (column->type)
+    {
+    case COLUMN_TYPE_STRING:
+        for (size_t r = 0; r < o->rows; ++r)
+        {
+            if (Filter_matchCell(filter, column->strings[r]))
+                Filter_setBit(bits, r);
+        }
+        return;
+    case COLUMN_TYPE_DICT:
+        ColumnGrid_filterDict(column, filter, o->rows, bits);
+        return;
+    }
+
+    if (Filter_isNumeric(filter))
+    {
+        if (column->type == COLUMN_TYPE_INT64)
+            Filter_matchInts(filter, column->ints, column->nulls, o->rows, bits);
+        else
+            Filter_matchDoubles(filter, column->doubles, column->nulls, o->rows, bits);
+        return;
+    }
+
+    // Text filters compare the text of the numbers.
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        char buf[GRID_NUMBER_BUFSIZE];
+        size_t len;
+        const char *data = ColumnGrid_formatCell(column, r, buf, &len);
+        if (data && Filter_matchText(filter, data, len))
+            Filter_setBit(bits, r);
+    }
+}
+
+int ColumnGrid_getRangeValues(RedisModuleCtx *ctx, struct ColumnGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end)
+{
+    int are_ranges_ok  =
+        GridType_getRangeValue(ctx, argv, 0, (long long)o->rows, row_start, "Start row must be an integer", "Start row outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 1, (long long)o->rows, row_end, "End row must be an integer", "End row outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 2, (long long)o->columns, column_start, "Start column must be an integer", "Start column outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 3, (long long)o->columns, column_end, "End column must be an integer", "End column outside the bounds of the grid") == REDISMODULE_OK;
+    return are_ranges_ok ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+int ColumnGrid_getShape(RedisModuleCtx *ctx, struct ColumnGrid *o)
+{
+    RedisModule_ReplyWithArray(ctx, (long)2);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->rows);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->columns);
+    return REDISMODULE_OK;
+}
+
+int ColumnGrid_dump(RedisModuleCtx *ctx, struct ColumnGrid *o)
+{
+    RedisModule_ReplyWithArray(ctx, (long) (2 + o->rows * o->columns));
+
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->rows);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->columns);
+
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        for (struct Column *c = o->cstart; c < o->cend; ++c)
+            ColumnGrid_replyWithCell(ctx, c, r);
+    }
+
+    return REDISMODULE_OK;
+}
+
+struct ColumnGrid *ColumnGrid_rdbLoad(RedisModuleIO *rdb)
+{
+    size_t rows = (size_t) RedisModule_LoadUnsigned(rdb);
+    size_t columns = (size_t) RedisModule_LoadUnsigned(rdb);
+
+    struct ColumnGrid *o = ColumnGrid_createObject(rows, columns, NULL);
+    if (!o)
+        return NULL;
+
+    for (size_t r = 0; r < rows; ++r)
+    {
+        for (struct Column *c = o->cstart; c < o->cend; ++c)
+        {
+            size_t l;
+            char *s = RedisModule_LoadStringBuffer(rdb, &l);
+            if (l > 1)
+                ColumnGrid_setValue(&o->arena, c, rows, r, s, l - 1);
+            RedisModule_Free(s);
+        }
+    }
+
+    return o;
+}
+
+void ColumnGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct ColumnGrid *o)
+{
+    struct AofWriter writer;
+    Aof_open(&writer, aof, key, o->rows, o->columns);
+
+    char buf[GRID_NUMBER_BUFSIZE];
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        for (struct Column *c = o->cstart; c < o->cend; ++c)
+        {
+            size_t l;
+            const char *s = ColumnGrid_formatCell(c, r, buf, &l);
+            Aof_writeCell(&writer, s, s ? l : 0);
+        }
+    }
+
+    Aof_close(&writer);
+}
+
+size_t ColumnGrid_memUsage(const struct ColumnGrid *o)
+{
+    size_t usage = sizeof(*o) + sizeof(struct Column) * o->columns + Arena_memUsage(&o->arena);
+    for (const struct Column *c = o->cstart; c < o->cend; ++c)
+    {
+        size_t column_usage = ColumnGrid_slotSize(c) * o->rows;
+        if (c->nulls)
+            column_usage += sizeof(uint64_t) * ColumnGrid_nullWords(o->rows);
+        column_usage += sizeof(struct ColumnText) * c->text_capacity;
+        if (c->dict)
+            column_usage += sizeof(struct ColumnDict) + sizeof(struct ColumnDictEntry) * c->dict->capacity + (c->dict->slots ? sizeof(uint32_t) * (c->dict->slot_mask + 1) : 0);
+
+        // The vectors of a shared column are counted in equal parts by the grids sharing them.
+        usage += c->shares ? column_usage / *c->shares : column_usage;
+    }
+    return usage;
+}
+
+void ColumnGrid_digest(RedisModuleDigest *md, struct ColumnGrid *o)
+{
+    RedisModule_DigestAddLongLong(md, o->rows);
+    RedisModule_DigestAddLongLong(md, o->columns);
+
+    char buf[GRID_NUMBER_BUFSIZE];
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        for (struct Column *c = o->cstart; c < o->cend; ++c)
+        {
+            size_t len;
+            const char *s = ColumnGrid_formatCell(c, r, buf, &len);
+            if (s)
+                RedisModule_DigestAddStringBuffer(md, (unsigned char*)s, len + 1);
+            else
+                RedisModule_DigestAddStringBuffer(md, (unsigned char*)"", 1);
+        }
+    }
+
+    RedisModule_DigestEndSequence(md);
+}
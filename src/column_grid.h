@@ -0,0 +1,122 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __COLUMN_GRID_H
+#define  __COLUMN_GRID_H
+
+#include "redismodule.h"
+#include "arena.h"
+#include "aggregate.h"
+#include "filter.h"
+#include "blob.h"
+
+#define COLUMN_TYPE_INT64 0x01
+#define COLUMN_TYPE_DOUBLE 0x02
+#define COLUMN_TYPE_STRING 0x03
+#define COLUMN_TYPE_DICT 0x04
+
+// The original text of a number which would not format back the same way.
+struct ColumnText {
+    size_t row;
+    char *cell;
+};
+
+// A distinct value of a dictionary column, and the number of rows which use it.
+struct ColumnDictEntry {
+    char *cell;
+    size_t refs;
+    uint32_t hash;
+};
+
+// The distinct values of a column, found through an open addressed table of codes.
+struct ColumnDict {
+    struct ColumnDictEntry *entries;
+    size_t count;
+    size_t capacity;
+    size_t live;
+    uint32_t *slots;
+    size_t slot_mask;
+};
+
+// A column holds its values in a single typed vector. Numeric columns track
+// empty cells in a bitmap, and keep a sparse list of text overrides sorted by
+// row. String columns hold arena cells or NULL. Dictionary columns hold a code
+// for each row, where 0 is empty and any other code is one more than the
+// position of the value in the dictionary. The vectors of a copied column are
+// shared with the copies until one of them is written, and shares counts the
+// columns which hold them, or is NULL when they are not shared.
+struct Column {
+    unsigned char type;
+    size_t *shares;
+    uint64_t *nulls;
+    struct ColumnText *text;
+    size_t text_count;
+    size_t text_capacity;
+    struct ColumnDict *dict;
+    union {
+        long long *ints;
+        double *doubles;
+        char **strings;
+        uint32_t *codes;
+    };
+};
+
+struct ColumnGrid {
+    size_t rows;
+    size_t columns;
+    struct Column *cstart;
+    struct Column *cend;
+    struct Arena arena;
+};
+
+void ColumnGrid_setDictionaryEncoding(int is_enabled);
+struct ColumnGrid *ColumnGrid_createObject(size_t rows, size_t columns, RedisModuleString** source);
+struct ColumnGrid *ColumnGrid_copyObject(const struct ColumnGrid *o);
+void ColumnGrid_releaseObject(struct ColumnGrid *o);
+void ColumnGrid_compact(struct ColumnGrid *o);
+int ColumnGrid_isNull(const struct Column *column, size_t row);
+const char *ColumnGrid_formatCell(const struct Column *column, size_t row, char *buf, size_t *len);
+int ColumnGrid_setObject(struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source);
+int ColumnGrid_setBlobObject(struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob);
+int ColumnGrid_resizeAndCopyObject(struct ColumnGrid *o, size_t rows, size_t columns);
+int ColumnGrid_insertColumns(struct ColumnGrid *o, size_t column, size_t count);
+void ColumnGrid_deleteColumns(struct ColumnGrid *o, size_t column, size_t count);
+int ColumnGrid_permuteRows(struct ColumnGrid *o, const size_t *order);
+int ColumnGrid_resizeAndReplaceObject(struct ColumnGrid *o, size_t rows, size_t columns, RedisModuleString **source);
+void ColumnGrid_rangeObject(RedisModuleCtx *ctx, struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void ColumnGrid_replyColumns(RedisModuleCtx *ctx, struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+char *ColumnGrid_rangeBlobObject(struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int keep_text, size_t *len);
+int ColumnGrid_getDouble(const struct Column *column, size_t row, double *value);
+void ColumnGrid_aggregateObject(struct ColumnGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results);
+void ColumnGrid_filterObject(const struct ColumnGrid *o, const struct Filter *filter, uint64_t *bits);
+int ColumnGrid_getRangeValues(RedisModuleCtx *ctx, struct ColumnGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end);
+int ColumnGrid_getShape(RedisModuleCtx *ctx, struct ColumnGrid* o);
+int ColumnGrid_dump(RedisModuleCtx *ctx, struct ColumnGrid* o);
+struct ColumnGrid* ColumnGrid_rdbLoad(RedisModuleIO *rdb);
+void ColumnGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct ColumnGrid *o);
+size_t ColumnGrid_memUsage(const struct ColumnGrid *o);
+void ColumnGrid_digest(RedisModuleDigest *md, struct ColumnGrid *o);
+
+#endif //  __COLUMN_GRID_H
@@ -0,0 +1,157 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "utils.h"
+#include "compress.h"
+
+static inline size_t Compress_hash(const unsigned char *p)
+{
+    uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+    return (v * 2654435761u) >> (32 - COMPRESS_HASH_BITS);
+}
+
+// Returns the compressed length, or 0 if the output would not fit in out_len bytes.
+size_t Compress_compress(const char *in, size_t in_len, char *out, size_t out_len)
+{
+    const unsigned char **table = (const unsigned char**)RedisModule_Calloc(1 << COMPRESS_HASH_BITS, sizeof(unsigned char*));
+    if (!table)
+        return 0;
+
+    const unsigned char *ip = (const unsigned char*)in, *in_end = ip + in_len;
+    unsigned char *op = (unsigned char*)out, *out_end = op + out_len;
+
+    // The control byte of the current literal run is written when the run ends.
+    unsigned char *run = op++;
+    size_t literals = 0;
+
+    while (ip < in_end && op < out_end)
+    {
+        if (ip + 2 < in_end)
+        {
+            size_t h = Compress_hash(ip);
+            const unsigned char *ref = table[h];
+            table[h] = ip;
+
+            if (ref && (size_t)(ip - ref) <= COMPRESS_MAX_OFFSET && ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2])
+            {
+                size_t len = 3, max_len = min((size_t)(in_end - ip), (size_t)COMPRESS_MAX_MATCH);
+                while (len < max_len && ref[len] == ip[len])
+                    ++len;
+
+                if (literals)
+                    *run = (unsigned char)(literals - 1);
+                else
+                    --op;
+
+                if (out_end - op < 4)
+                    break;
+
+                size_t offset = ip - ref - 1;
+                if (len - 2 < 7)
+                    *op++ = (unsigned char)((offset >> 8) + ((len - 2) << 5));
+                else
+                {
+                    *op++ = (unsigned char)((offset >> 8) + (7 << 5));
+                    *op++ = (unsigned char)(len - 2 - 7);
+                }
+                *op++ = (unsigned char)offset;
+
+                ip += len;
+                run = op++;
+                literals = 0;
+                continue;
+            }
+        }
+
+        *op++ = *ip++;
+        if (++literals == COMPRESS_MAX_LITERAL)
+        {
+            *run = COMPRESS_MAX_LITERAL - 1;
+            run = op++;
+            literals = 0;
+        }
+    }
+
+    RedisModule_Free(table);
+
+    if (ip < in_end || op > out_end)
+        return 0;
+
+    if (literals)
+        *run = (unsigned char)(literals - 1);
+    else
+        --op;
+
+    return op - (unsigned char*)out;
+}
+
+// Expands the input, which must produce exactly out_len bytes.
+int Compress_decompress(const char *in, size_t in_len, char *out, size_t out_len)
+{
+    const unsigned char *ip = (const unsigned char*)in, *in_end = ip + in_len;
+    unsigned char *op = (unsigned char*)out, *out_end = op + out_len;
+
+    while (ip < in_end)
+    {
+        size_t ctrl = *ip++;
+
+        if (ctrl < COMPRESS_MAX_LITERAL)
+        {
+            size_t len = ctrl + 1;
+            if ((size_t)(in_end - ip) < len || (size_t)(out_end - op) < len)
+                return REDISMODULE_ERR;
+
+            memcpy(op, ip, len);
+            op += len;
+            ip += len;
+            continue;
+        }
+
+        size_t len = ctrl >> 5;
+        if (len == 7)
+        {
+            if (ip == in_end)
+                return REDISMODULE_ERR;
+            len += *ip++;
+        }
+        len += 2;
+
+        if (ip == in_end)
+            return REDISMODULE_ERR;
+        size_t offset = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+
+        if ((size_t)(op - (unsigned char*)out) < offset || (size_t)(out_end - op) < len)
+            return REDISMODULE_ERR;
+
+        // The reference may overlap the bytes being written, so copy forwards a byte at a time.
+        for (const unsigned char *ref = op - offset, *end = op + len; op < end; )
+            *op++ = *ref++;
+    }
+
+    return op == out_end ? REDISMODULE_OK : REDISMODULE_ERR;
+}
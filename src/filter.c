@@ -0,0 +1,194 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include <strings.h>
+
+#include "utils.h"
+#include "filter.h"
+
+int Filter_parseOp(const char *name)
+{
+    if (strcmp(name, "=") == 0)
+        return FILTER_EQ;
+    if (strcmp(name, "!=") == 0)
+        return FILTER_NE;
+    if (strcmp(name, "<") == 0)
+        return FILTER_LT;
+    if (strcmp(name, "<=") == 0)
+        return FILTER_LE;
+    if (strcmp(name, ">") == 0)
+        return FILTER_GT;
+    if (strcmp(name, ">=") == 0)
+        return FILTER_GE;
+    if (strcasecmp(name, "IN") == 0)
+        return FILTER_IN;
+    if (strcasecmp(name, "PREFIX") == 0)
+        return FILTER_PREFIX;
+    return 0;
+}
+
+void Filter_initValue(struct FilterValue *v, const char *data, size_t len)
+{
+    v->data = data;
+    v->len = len;
+    v->is_number = GridType_parseDouble(data, len, &v->number) == REDISMODULE_OK;
+}
+
+// Numeric filters can be checked against the numbers of a column without formatting them.
+int Filter_isNumeric(const struct Filter *f)
+{
+    if (f->op == FILTER_PREFIX)
+        return 0;
+    for (size_t i = 0; i < f->count; ++i)
+    {
+        if (!f->values[i].is_number)
+            return 0;
+    }
+    return 1;
+}
+
+static inline int Filter_compare(int op, int cmp)
+{
+    switch (op)
+    {
+    case FILTER_EQ:
+        return cmp == 0;
+    case FILTER_NE:
+        return cmp != 0;
+    case FILTER_LT:
+        return cmp < 0;
+    case FILTER_LE:
+        return cmp <= 0;
+    case FILTER_GT:
+        return cmp > 0;
+    default:
+        return cmp >= 0;
+    }
+}
+
+// Only valid for numeric filters.
+int Filter_matchNumber(const struct Filter *f, double value)
+{
+    if (f->op == FILTER_IN)
+    {
+        for (size_t i = 0; i < f->count; ++i)
+        {
+            if (f->values[i].number == value)
+                return 1;
+        }
+        return 0;
+    }
+
+    double number = f->values[0].number;
+    return Filter_compare(f->op, value < number ? -1 : value > number);
+}
+
+static int Filter_matchValue(int op, const struct FilterValue *v, const char *data, size_t len)
+{
+    if (v->is_number)
+    {
+        double value;
+        if (GridType_parseDouble(data, len, &value) != REDISMODULE_OK)
+            return 0;
+        return Filter_compare(op, value < v->number ? -1 : value > v->number);
+    }
+
+    // Equality is settled by the lengths before any bytes are compared.
+    if (op == FILTER_EQ || op == FILTER_NE)
+        return (len == v->len && memcmp(data, v->data, len) == 0) == (op == FILTER_EQ);
+
+    int cmp = memcmp(data, v->data, min(len, v->len));
+    if (cmp == 0)
+        cmp = len < v->len ? -1 : len > v->len;
+    return Filter_compare(op, cmp);
+}
+
+int Filter_matchText(const struct Filter *f, const char *data, size_t len)
+{
+    switch (f->op)
+    {
+    case FILTER_PREFIX:
+        return len >= f->values[0].len && memcmp(data, f->values[0].data, f->values[0].len) == 0;
+    case FILTER_IN:
+        for (size_t i = 0; i < f->count; ++i)
+        {
+            if (Filter_matchValue(FILTER_EQ, f->values + i, data, len))
+                return 1;
+        }
+        return 0;
+    default:
+        return Filter_matchValue(f->op, f->values, data, len);
+    }
+}
+
+int Filter_matchCell(const struct Filter *f, const char *cell)
+{
+    return cell && Filter_matchText(f, GridCell_data(cell), GridCell_length(cell));
+}
+
+// The kernels build the bits for a block of 64 rows without branching on the values, so
+// the compares can be vectorised, then clear the empty rows with the null bitmap.
+#define FILTER_MATCH_BLOCK(v, n, expr) \
+    for (size_t i = 0; i < (n); ++i) \
+        word |= (uint64_t)(expr) << i
+
+#define FILTER_MATCH_VALUES(type) \
+    for (size_t w = 0; w < Filter_words(rows); ++w) \
+    { \
+        const type *v = values + w * 64; \
+        size_t n = min(rows - w * 64, (size_t)64); \
+        uint64_t word = 0; \
+        double x = f->values[0].number; \
+        switch (f->op) \
+        { \
+        case FILTER_EQ: FILTER_MATCH_BLOCK(v, n, (double)v[i] == x); break; \
+        case FILTER_NE: FILTER_MATCH_BLOCK(v, n, (double)v[i] != x); break; \
+        case FILTER_LT: FILTER_MATCH_BLOCK(v, n, (double)v[i] < x); break; \
+        case FILTER_LE: FILTER_MATCH_BLOCK(v, n, (double)v[i] <= x); break; \
+        case FILTER_GT: FILTER_MATCH_BLOCK(v, n, (double)v[i] > x); break; \
+        case FILTER_GE: FILTER_MATCH_BLOCK(v, n, (double)v[i] >= x); break; \
+        default: \
+            for (size_t k = 0; k < f->count; ++k) \
+            { \
+                x = f->values[k].number; \
+                FILTER_MATCH_BLOCK(v, n, (double)v[i] == x); \
+            } \
+            break; \
+        } \
+        bits[w] = word & ~nulls[w]; \
+    }
+
+// Only valid for numeric filters.
+void Filter_matchDoubles(const struct Filter *f, const double *values, const uint64_t *nulls, size_t rows, uint64_t *bits)
+{
+    FILTER_MATCH_VALUES(double)
+}
+
+// Only valid for numeric filters.
+void Filter_matchInts(const struct Filter *f, const long long *values, const uint64_t *nulls, size_t rows, uint64_t *bits)
+{
+    FILTER_MATCH_VALUES(long long)
+}
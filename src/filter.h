@@ -0,0 +1,79 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __FILTER_H
+#define __FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FILTER_EQ 1
+#define FILTER_NE 2
+#define FILTER_LT 3
+#define FILTER_LE 4
+#define FILTER_GT 5
+#define FILTER_GE 6
+#define FILTER_IN 7
+#define FILTER_PREFIX 8
+
+// A value which is a number is compared with the cells holding numbers, and
+// any other value with the text of the cells. Empty cells never match.
+struct FilterValue {
+    const char *data;
+    size_t len;
+    int is_number;
+    double number;
+};
+
+// A comparison of the cells in a column. A filter joined with OR starts a new
+// group of filters joined with AND, so AND binds tighter than OR.
+struct Filter {
+    size_t column;
+    int op;
+    int is_or;
+    size_t count;
+    const struct FilterValue *values;
+};
+
+static inline size_t Filter_words(size_t rows)
+{
+    return (rows + 63) / 64;
+}
+
+static inline void Filter_setBit(uint64_t *bits, size_t row)
+{
+    bits[row / 64] |= (uint64_t)1 << (row % 64);
+}
+
+int Filter_parseOp(const char *name);
+void Filter_initValue(struct FilterValue *v, const char *data, size_t len);
+int Filter_isNumeric(const struct Filter *f);
+int Filter_matchNumber(const struct Filter *f, double value);
+int Filter_matchText(const struct Filter *f, const char *data, size_t len);
+int Filter_matchCell(const struct Filter *f, const char *cell);
+void Filter_matchDoubles(const struct Filter *f, const double *values, const uint64_t *nulls, size_t rows, uint64_t *bits);
+void Filter_matchInts(const struct Filter *f, const long long *values, const uint64_t *nulls, size_t rows, uint64_t *bits);
+
+#endif // __FILTER_H
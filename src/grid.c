@@ -27,80 +27,459 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <strings.h>
 #include "utils.h"
+#include "filter.h"
+#include "index.h"
+#include "sort.h"
+#include "changes.h"
 #include "array_grid.h"
 #include "row_grid.h"
+#include "column_grid.h"
+#include "sparse_grid.h"
+#include "tile_grid.h"
+#include "worker.h"
+#include "compress.h"
 
 #define GRIDMODULE_ERRORMSG__ROWNOTINT "WRONGTYPE Row should be an int"
 #define GRIDMODULE_ERRORMSG__COLNOTINT "WRONGTYPE Column should be an int"
 
 #define STORAGE_TYPE_ARRAY 0x01
 #define STORAGE_TYPE_ROW 0x02
+#define STORAGE_TYPE_COLUMN 0x04
+#define STORAGE_TYPE_SPARSE 0x08
+#define STORAGE_TYPE_TILE 0x10
+
+#define GRID_ORDER_ROWS 0
+#define GRID_ORDER_COLUMNS 1
+
+// Version 1 records the storage type and saves the cells as bands of rows in the blob format,
+// version 2 adds the capped rows and version 3 the indexes.
+#define GRID_ENCODING_VERSION 3
+#define GRID_RDB_BAND_CELLS 65536
+#define GRID_RDB_BAND_RAW 0
+#define GRID_RDB_BAND_COMPRESSED 1
 
 static RedisModuleType *GridType;
 
 static int current_storage_type = STORAGE_TYPE_ROW;
+static long long worker_threshold = WORKER_DEFAULT_THRESHOLD;
+static int rdb_compression = 1;
 
 struct GridTypeObject 
 {
     unsigned char storage_type;
 
+    // Rows appended past the cap push out the oldest rows, 0 when the grid is not capped.
+    size_t capped_rows;
+
+    // The indexes on the columns of the grid, in the order they were created.
+    struct GridIndex *indexes;
+
+    // The versions at which the rows and columns of the grid last changed.
+    struct GridChanges *changes;
+
     union {
         struct ArrayGrid *array_grid;
         struct RowGrid *row_grid;
+        struct ColumnGrid *column_grid;
+        struct SparseGrid *sparse_grid;
+        struct TileGrid *tile_grid;
     };
 };
 
+void GridType_getDimensions(struct GridTypeObject *o, long long *rows, long long *columns)
+{
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        *rows = (long long)o->array_grid->rows;
+        *columns = (long long)o->array_grid->columns;
+        break;
+    case STORAGE_TYPE_COLUMN:
+        *rows = (long long)o->column_grid->rows;
+        *columns = (long long)o->column_grid->columns;
+        break;
+    case STORAGE_TYPE_SPARSE:
+        *rows = (long long)o->sparse_grid->rows;
+        *columns = (long long)o->sparse_grid->columns;
+        break;
+    case STORAGE_TYPE_TILE:
+        *rows = (long long)o->tile_grid->rows;
+        *columns = (long long)o->tile_grid->columns;
+        break;
+    default:
+        *rows = (long long)o->row_grid->rows;
+        *columns = (long long)o->row_grid->columns;
+        break;
+    }
+}
+
 struct GridTypeObject *GridType_createObject(unsigned char storage_type, size_t rows, size_t columns, RedisModuleString** source) 
 {
     struct GridTypeObject *o;
     o = RedisModule_Alloc(sizeof(struct GridTypeObject));
+    if (!o)
+        return NULL;
     o->storage_type = storage_type;
-    if (storage_type & STORAGE_TYPE_ARRAY)
-        o->array_grid = ArrayGrid_createObject(rows, columns, source);
-    else
-        o->row_grid = RowGrid_createObject(rows, columns, source);
+    o->capped_rows = 0;
+    o->indexes = NULL;
+
+    // The changes are tracked for as long as the grid lives, so reading them never writes to it.
+    o->changes = GridChanges_create(rows, columns);
+    if (!o->changes)
+    {
+        RedisModule_Free(o);
+        return NULL;
+    }
+
+    void *grid;
+    switch (storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        grid = o->array_grid = ArrayGrid_createObject(rows, columns, source);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        grid = o->column_grid = ColumnGrid_createObject(rows, columns, source);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        grid = o->sparse_grid = SparseGrid_createObject(rows, columns, source);
+        break;
+    case STORAGE_TYPE_TILE:
+        grid = o->tile_grid = TileGrid_createObject(rows, columns, source);
+        break;
+    default:
+        grid = o->row_grid = RowGrid_createObject(rows, columns, source);
+        break;
+    }
+
+    if (!grid)
+    {
+        GridChanges_release(o->changes);
+        RedisModule_Free(o);
+        return NULL;
+    }
+
     return o;
 }
 
 void GridType_releaseObject(struct GridTypeObject *o) 
 {
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
         ArrayGrid_releaseObject(o->array_grid);
-    else
+        break;
+    case STORAGE_TYPE_COLUMN:
+        ColumnGrid_releaseObject(o->column_grid);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        SparseGrid_releaseObject(o->sparse_grid);
+        break;
+    case STORAGE_TYPE_TILE:
+        TileGrid_releaseObject(o->tile_grid);
+        break;
+    default:
         RowGrid_releaseObject(o->row_grid);
+        break;
+    }
+    for (struct GridIndex *index = o->indexes, *next; index; index = next)
+    {
+        next = index->next;
+        GridIndex_release(index);
+    }
+    GridChanges_release(o->changes);
     RedisModule_Free(o);
 }
 
+struct GridTypeObject *GridType_copyObject(const struct GridTypeObject *o)
+{
+    struct GridTypeObject *copy;
+    copy = RedisModule_Alloc(sizeof(struct GridTypeObject));
+    copy->storage_type = o->storage_type;
+    copy->capped_rows = o->capped_rows;
+
+    void *grid;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        grid = copy->array_grid = ArrayGrid_copyObject(o->array_grid);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        grid = copy->column_grid = ColumnGrid_copyObject(o->column_grid);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        grid = copy->sparse_grid = SparseGrid_copyObject(o->sparse_grid);
+        break;
+    case STORAGE_TYPE_TILE:
+        grid = copy->tile_grid = TileGrid_copyObject(o->tile_grid);
+        break;
+    default:
+        grid = copy->row_grid = RowGrid_copyObject(o->row_grid);
+        break;
+    }
+
+    if (!grid)
+    {
+        RedisModule_Free(copy);
+        return NULL;
+    }
+
+    // The copy is a new grid, so every cell of it has changed since any version before it.
+    long long rows, columns;
+    GridType_getDimensions(copy, &rows, &columns);
+    copy->changes = GridChanges_create(rows, columns);
+    if (!copy->changes)
+    {
+        copy->indexes = NULL;
+        GridType_releaseObject(copy);
+        return NULL;
+    }
+
+    // The indexes of the copy are rebuilt when they are first used.
+    copy->indexes = NULL;
+    for (struct GridIndex *index = o->indexes, **tail = &copy->indexes; index; index = index->next)
+    {
+        if ((*tail = GridIndex_create(index->column, index->type)) != NULL)
+        {
+            (*tail)->is_stale = 1;
+            tail = &(*tail)->next;
+        }
+    }
+
+    return copy;
+}
+
+// Returns the text of a cell, or NULL when it is empty. Numbers in columnar storage are formatted into the buffer.
+const char *GridType_getCellText(struct GridTypeObject *o, size_t row, size_t column, char *buf, size_t *len)
+{
+    const char *cell;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        return GridSlot_data(o->array_grid->start + row * o->array_grid->columns + column, len);
+    case STORAGE_TYPE_COLUMN:
+        return ColumnGrid_formatCell(o->column_grid->cstart + column, row, buf, len);
+    case STORAGE_TYPE_SPARSE:
+        cell = SparseGrid_getCell(o->sparse_grid, row, column);
+        break;
+    case STORAGE_TYPE_TILE:
+        cell = TileGrid_getCell(o->tile_grid, row, column);
+        break;
+    default:
+        cell = o->row_grid->rstart[row][column];
+        break;
+    }
+
+    if (!cell)
+        return NULL;
+    *len = GridCell_length(cell);
+    return GridCell_data(cell);
+}
+
+struct GridIndex *GridType_findIndex(struct GridTypeObject *o, size_t column)
+{
+    struct GridIndex *index = o->indexes;
+    while (index && index->column != column)
+        index = index->next;
+    return index;
+}
+
+int GridType_buildIndex(struct GridTypeObject *o, struct GridIndex *index)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    GridIndex_clear(index);
+    index->is_stale = 0;
+    for (size_t r = 0; r < (size_t)rows; ++r)
+    {
+        char buf[GRID_NUMBER_BUFSIZE];
+        size_t len;
+        const char *data = GridType_getCellText(o, r, index->column, buf, &len);
+        if (data && GridIndex_add(index, data, len, r) != REDISMODULE_OK)
+        {
+            GridIndex_clear(index);
+            index->is_stale = 1;
+            return REDISMODULE_ERR;
+        }
+    }
+
+    return REDISMODULE_OK;
+}
+
+// Adds or removes the cells of a range from the indexes on its columns. A cell which cannot be
+// added leaves its index stale, and stale indexes are left to be rebuilt.
+void GridType_indexCells(struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, int is_added)
+{
+    size_t row_first = (size_t)min(row_start, row_end), row_last = (size_t)max(row_start, row_end);
+    size_t column_first = (size_t)min(column_start, column_end), column_last = (size_t)max(column_start, column_end);
+
+    for (struct GridIndex *index = o->indexes; index; index = index->next)
+    {
+        if (index->is_stale || index->column < column_first || index->column > column_last)
+            continue;
+
+        for (size_t r = row_first; r <= row_last; ++r)
+        {
+            char buf[GRID_NUMBER_BUFSIZE];
+            size_t len;
+            const char *data = GridType_getCellText(o, r, index->column, buf, &len);
+            if (!data)
+                continue;
+            if (!is_added)
+                GridIndex_remove(index, data, len, r);
+            else if (GridIndex_add(index, data, len, r) != REDISMODULE_OK)
+            {
+                GridIndex_clear(index);
+                index->is_stale = 1;
+                break;
+            }
+        }
+    }
+}
+
+// Empties the indexes, to be rebuilt from their columns when they are next used.
+void GridType_staleIndexes(struct GridTypeObject *o)
+{
+    for (struct GridIndex *index = o->indexes; index; index = index->next)
+    {
+        if (!index->is_stale)
+        {
+            GridIndex_clear(index);
+            index->is_stale = 1;
+        }
+    }
+}
+
+// Drops the indexes on the columns from the first deleted column, and moves the indexes on
+// the columns after them to their new columns.
+void GridType_deleteIndexColumns(struct GridTypeObject *o, size_t column, size_t count)
+{
+    for (struct GridIndex **p = &o->indexes; *p; )
+    {
+        struct GridIndex *index = *p;
+        if (index->column >= column && index->column - column < count)
+        {
+            *p = index->next;
+            GridIndex_release(index);
+            continue;
+        }
+        if (index->column >= column)
+            index->column -= count;
+        p = &index->next;
+    }
+}
+
 int GridType_setObject(struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source)
 {
-    if (o->storage_type == STORAGE_TYPE_ARRAY)
-        return ArrayGrid_setObject(o->array_grid, row_start, row_end, column_start, column_end, source);
-    else
-        return RowGrid_setObject(o->row_grid, row_start, row_end, column_start, column_end, source);
+    // The cells being overwritten are taken out of the indexes, and their new values put back in.
+    GridType_indexCells(o, row_start, row_end, column_start, column_end, 0);
+
+    int is_set;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        is_set = ArrayGrid_setObject(o->array_grid, row_start, row_end, column_start, column_end, source);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        is_set = ColumnGrid_setObject(o->column_grid, row_start, row_end, column_start, column_end, source);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        is_set = SparseGrid_setObject(o->sparse_grid, row_start, row_end, column_start, column_end, source);
+        break;
+    case STORAGE_TYPE_TILE:
+        is_set = TileGrid_setObject(o->tile_grid, row_start, row_end, column_start, column_end, source);
+        break;
+    default:
+        is_set = RowGrid_setObject(o->row_grid, row_start, row_end, column_start, column_end, source);
+        break;
+    }
+
+    GridType_indexCells(o, row_start, row_end, column_start, column_end, 1);
+    GridChanges_touch(o->changes, (size_t)row_start, (size_t)row_end, (size_t)column_start, (size_t)column_end);
+    return is_set;
+}
+
+int GridType_setBlobObject(struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob)
+{
+    GridType_indexCells(o, row_start, row_end, column_start, column_end, 0);
+
+    int is_set;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        is_set = ArrayGrid_setBlobObject(o->array_grid, row_start, row_end, column_start, column_end, blob);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        is_set = ColumnGrid_setBlobObject(o->column_grid, row_start, row_end, column_start, column_end, blob);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        is_set = SparseGrid_setBlobObject(o->sparse_grid, row_start, row_end, column_start, column_end, blob);
+        break;
+    case STORAGE_TYPE_TILE:
+        is_set = TileGrid_setBlobObject(o->tile_grid, row_start, row_end, column_start, column_end, blob);
+        break;
+    default:
+        is_set = RowGrid_setBlobObject(o->row_grid, row_start, row_end, column_start, column_end, blob);
+        break;
+    }
+
+    GridType_indexCells(o, row_start, row_end, column_start, column_end, 1);
+    GridChanges_touch(o->changes, (size_t)row_start, (size_t)row_end, (size_t)column_start, (size_t)column_end);
+    return is_set;
+}
+
+// Every cell is taken to have changed when the changes to the grid could not be followed, and
+// the changes are lost, until they are next reset, when even that fails.
+void GridType_resetChanges(struct GridTypeObject *o)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+    GridChanges_reset(o->changes, (size_t)rows, (size_t)columns);
 }
 
 int GridType_dimObject(RedisModuleKey *key, unsigned char storage_type, size_t rows, size_t columns, RedisModuleString **source)
 {
     struct GridTypeObject *o = GridType_createObject(storage_type, (size_t)rows, (size_t)columns, source);
+    if (!o)
+        return REDISMODULE_ERR;
     RedisModule_ModuleTypeSetValue(key, GridType, o);
     return REDISMODULE_OK;
 }
 
 int GridType_resizeAndCopyObject(struct GridTypeObject *o, size_t rows, size_t columns)
 {
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
         return ArrayGrid_resizeAndCopyObject(o->array_grid, rows, columns);
-    else
+    case STORAGE_TYPE_COLUMN:
+        return ColumnGrid_resizeAndCopyObject(o->column_grid, rows, columns);
+    case STORAGE_TYPE_SPARSE:
+        return SparseGrid_resizeAndCopyObject(o->sparse_grid, rows, columns);
+    case STORAGE_TYPE_TILE:
+        return TileGrid_resizeAndCopyObject(o->tile_grid, rows, columns);
+    default:
         return RowGrid_resizeAndCopyObject(o->row_grid, rows, columns);
+    }
 }
 
 int GridType_resizeAndReplaceObject(struct GridTypeObject *o, size_t rows, size_t columns, RedisModuleString **source)
 {
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
         return ArrayGrid_resizeAndReplaceObject(o->array_grid, rows, columns, source);
-    else
+    case STORAGE_TYPE_COLUMN:
+        return ColumnGrid_resizeAndReplaceObject(o->column_grid, rows, columns, source);
+    case STORAGE_TYPE_SPARSE:
+        return SparseGrid_resizeAndReplaceObject(o->sparse_grid, rows, columns, source);
+    case STORAGE_TYPE_TILE:
+        return TileGrid_resizeAndReplaceObject(o->tile_grid, rows, columns, source);
+    default:
         return RowGrid_resizeAndReplaceObject(o->row_grid, rows, columns, source);
+    }
 }
 
 int GridType_redimObject(RedisModuleKey *key, size_t rows, size_t columns, RedisModuleString **source)
@@ -109,10 +488,28 @@ int GridType_redimObject(RedisModuleKey *key, size_t rows, size_t columns, Redis
 
     if (rows == 0 || columns == 0)
         return RedisModule_DeleteKey(key);
-    else if (source)
-        return GridType_resizeAndReplaceObject(o, rows, columns, source);
-    else 
-        return GridType_resizeAndCopyObject(o, rows, columns);
+
+    // Replacing every cell leaves the indexes to be rebuilt, while a resize takes the rows and
+    // columns it cuts off out of the indexes.
+    if (source)
+    {
+        GridType_staleIndexes(o);
+        int is_replaced = GridType_resizeAndReplaceObject(o, rows, columns, source);
+        GridType_resetChanges(o);
+        return is_replaced;
+    }
+
+    long long current_rows, current_columns;
+    GridType_getDimensions(o, &current_rows, &current_columns);
+    if ((long long)columns < current_columns)
+        GridType_deleteIndexColumns(o, columns, (size_t)current_columns - columns);
+    if ((long long)rows < current_rows)
+        GridType_indexCells(o, (long long)rows, current_rows - 1, 0, min((long long)columns, current_columns) - 1, 0);
+
+    int is_resized = GridType_resizeAndCopyObject(o, rows, columns);
+    if (is_resized != REDISMODULE_OK || GridChanges_resize(o->changes, rows, columns) != REDISMODULE_OK)
+        GridType_resetChanges(o);
+    return is_resized;
 }
 
 int GridType_reshapeObject(RedisModuleCtx *ctx, RedisModuleKey *key, int type, unsigned char storage_type, size_t rows, size_t columns, RedisModuleString **source)
@@ -125,92 +522,2284 @@ int GridType_reshapeObject(RedisModuleCtx *ctx, RedisModuleKey *key, int type, u
         return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
 }
 
-void GridType_rangeObject(RedisModuleCtx *ctx, struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end)
+void GridType_replyColumns(RedisModuleCtx *ctx, struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        ArrayGrid_replyColumns(ctx, o->array_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        ColumnGrid_replyColumns(ctx, o->column_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        SparseGrid_replyColumns(ctx, o->sparse_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    case STORAGE_TYPE_TILE:
+        TileGrid_replyColumns(ctx, o->tile_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    default:
+        RowGrid_replyColumns(ctx, o->row_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    }
+}
+
+void GridType_rangeObject(RedisModuleCtx *ctx, struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step, int order)
+{
+    // The backends walk from the start to the end in steps, so the end is moved onto the last step.
+    row_end = row_start < row_end ? row_end - (row_end - row_start) % row_step : row_end + (row_start - row_end) % row_step;
+    column_end = column_start < column_end ? column_end - (column_end - column_start) % column_step : column_end + (column_start - column_end) % column_step;
+
+    if (order == GRID_ORDER_COLUMNS)
+    {
+        long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end)) / row_step;
+        long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end)) / column_step;
+        RedisModule_ReplyWithArray(ctx, (long)(rows * columns));
+        GridType_replyColumns(ctx, o, row_start, row_end, column_start, column_end, row_step, column_step);
+        return;
+    }
+
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        ArrayGrid_rangeObject(ctx, o->array_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        ColumnGrid_rangeObject(ctx, o->column_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        SparseGrid_rangeObject(ctx, o->sparse_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    case STORAGE_TYPE_TILE:
+        TileGrid_rangeObject(ctx, o->tile_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    default:
+        RowGrid_rangeObject(ctx, o->row_grid, row_start, row_end, column_start, column_end, row_step, column_step);
+        break;
+    }
+}
+
+int GridType_dump(RedisModuleCtx *ctx, struct GridTypeObject* o, int order)
+{
+    if (order == GRID_ORDER_COLUMNS)
+    {
+        long long rows, columns;
+        GridType_getDimensions(o, &rows, &columns);
+        RedisModule_ReplyWithArray(ctx, (long)(2 + rows * columns));
+        RedisModule_ReplyWithLongLong(ctx, rows);
+        RedisModule_ReplyWithLongLong(ctx, columns);
+        if (rows > 0 && columns > 0)
+            GridType_replyColumns(ctx, o, 0, rows - 1, 0, columns - 1, 1, 1);
+        return REDISMODULE_OK;
+    }
+
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        return ArrayGrid_dump(ctx, o->array_grid);
+    case STORAGE_TYPE_COLUMN:
+        return ColumnGrid_dump(ctx, o->column_grid);
+    case STORAGE_TYPE_SPARSE:
+        return SparseGrid_dump(ctx, o->sparse_grid);
+    case STORAGE_TYPE_TILE:
+        return TileGrid_dump(ctx, o->tile_grid);
+    default:
+        return RowGrid_dump(ctx, o->row_grid);
+    }
+}
+
+char *GridType_rangeBlobObject(struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len)
+{
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        return ArrayGrid_rangeBlobObject(o->array_grid, row_start, row_end, column_start, column_end, len);
+    case STORAGE_TYPE_COLUMN:
+        return ColumnGrid_rangeBlobObject(o->column_grid, row_start, row_end, column_start, column_end, 0, len);
+    case STORAGE_TYPE_SPARSE:
+        return SparseGrid_rangeBlobObject(o->sparse_grid, row_start, row_end, column_start, column_end, len);
+    case STORAGE_TYPE_TILE:
+        return TileGrid_rangeBlobObject(o->tile_grid, row_start, row_end, column_start, column_end, len);
+    default:
+        return RowGrid_rangeBlobObject(o->row_grid, row_start, row_end, column_start, column_end, len);
+    }
+}
+
+// A copy of a range which keeps the text of every cell, so it can be replied from another thread.
+char *GridType_snapshotObject(struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len)
+{
+    if (o->storage_type == STORAGE_TYPE_COLUMN)
+        return ColumnGrid_rangeBlobObject(o->column_grid, row_start, row_end, column_start, column_end, 1, len);
+    else
+        return GridType_rangeBlobObject(o, row_start, row_end, column_start, column_end, len);
+}
+
+void GridType_aggregateObject(struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results)
+{
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        ArrayGrid_aggregateObject(o->array_grid, row_start, row_end, column_start, column_end, axis, results);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        ColumnGrid_aggregateObject(o->column_grid, row_start, row_end, column_start, column_end, axis, results);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        SparseGrid_aggregateObject(o->sparse_grid, row_start, row_end, column_start, column_end, axis, results);
+        break;
+    case STORAGE_TYPE_TILE:
+        TileGrid_aggregateObject(o->tile_grid, row_start, row_end, column_start, column_end, axis, results);
+        break;
+    default:
+        RowGrid_aggregateObject(o->row_grid, row_start, row_end, column_start, column_end, axis, results);
+        break;
+    }
+}
+
+void GridType_filterObject(struct GridTypeObject *o, const struct Filter *filter, uint64_t *bits)
+{
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        ArrayGrid_filterObject(o->array_grid, filter, bits);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        ColumnGrid_filterObject(o->column_grid, filter, bits);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        SparseGrid_filterObject(o->sparse_grid, filter, bits);
+        break;
+    case STORAGE_TYPE_TILE:
+        TileGrid_filterObject(o->tile_grid, filter, bits);
+        break;
+    default:
+        RowGrid_filterObject(o->row_grid, filter, bits);
+        break;
+    }
+}
+
+// Sets the bits of the rows which match the filters, returning the number of matching rows.
+size_t GridType_whereObject(struct GridTypeObject *o, const struct Filter *filters, size_t count, size_t rows, uint64_t *matches)
+{
+    size_t words = Filter_words(rows);
+    uint64_t *group = (uint64_t*)RedisModule_Alloc(sizeof(uint64_t) * max(words, (size_t)1));
+    uint64_t *bits = (uint64_t*)RedisModule_Alloc(sizeof(uint64_t) * max(words, (size_t)1));
+
+    memset(matches, 0, sizeof(uint64_t) * words);
+    for (size_t i = 0; i < count; )
+    {
+        memset(group, 0, sizeof(uint64_t) * words);
+        GridType_filterObject(o, filters + i, group);
+
+        // The rest of a group is skipped once no rows are left in it.
+        int is_empty = 0;
+        for (++i; i < count && !filters[i].is_or; ++i)
+        {
+            if (is_empty)
+                continue;
+
+            memset(bits, 0, sizeof(uint64_t) * words);
+            GridType_filterObject(o, filters + i, bits);
+
+            uint64_t any = 0;
+            for (size_t w = 0; w < words; ++w)
+                any |= group[w] &= bits[w];
+            is_empty = any == 0;
+        }
+
+        for (size_t w = 0; w < words; ++w)
+            matches[w] |= group[w];
+    }
+
+    RedisModule_Free(group);
+    RedisModule_Free(bits);
+
+    size_t total = 0;
+    for (size_t w = 0; w < words; ++w)
+        total += (size_t)__builtin_popcountll(matches[w]);
+    return total;
+}
+
+/* Commands */
+
+// Sets the range at the row and column from a snapshot of another range, and frees the snapshot.
+int GridType_setSnapshotObject(struct GridTypeObject *o, char *blob, size_t len, long long row, long long column)
+{
+    struct BlobReader reader;
+    int is_set = blob &&
+        Blob_open(&reader, blob, len) == REDISMODULE_OK &&
+        GridType_setBlobObject(o, row, row + (long long)reader.rows - 1, column, column + (long long)reader.columns - 1, &reader) == REDISMODULE_OK;
+
+    if (blob)
+        RedisModule_Free(blob);
+
+    return is_set ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+// Moves the cells of the grid into another storage type, keeping the text of every cell.
+int GridType_convertObject(struct GridTypeObject *o, unsigned char storage_type)
+{
+    if (o->storage_type == storage_type)
+        return REDISMODULE_OK;
+
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    // The original is left as it is when there is no memory for the converted grid.
+    struct GridTypeObject *converted = GridType_createObject(storage_type, (size_t)rows, (size_t)columns, NULL);
+    if (!converted)
+        return REDISMODULE_ERR;
+    if (rows > 0 && columns > 0)
+    {
+        size_t len;
+        char *blob = GridType_snapshotObject(o, 0, rows - 1, 0, columns - 1, &len);
+        if (GridType_setSnapshotObject(converted, blob, len, 0, 0) != REDISMODULE_OK)
+        {
+            GridType_releaseObject(converted);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    // The converted grid takes the place of the original, which is released in its shell.
+    // The text of the cells is unchanged, so the indexes and the changes are kept.
+    struct GridTypeObject original = *o;
+    converted->capped_rows = o->capped_rows;
+    converted->indexes = o->indexes;
+    original.indexes = NULL;
+    original.changes = converted->changes;
+    converted->changes = o->changes;
+    *o = *converted;
+    *converted = original;
+    GridType_releaseObject(converted);
+
+    return REDISMODULE_OK;
+}
+
+// These grids grow through a resize. They can not be capped, as dropping their oldest rows
+// would move every row they keep.
+int GridType_appendRowsByCopy(struct GridTypeObject *o, size_t rows, RedisModuleString **source)
+{
+    long long current_rows, columns;
+    GridType_getDimensions(o, &current_rows, &columns);
+
+    long long total = current_rows + (long long)rows;
+    if (GridType_resizeAndCopyObject(o, (size_t)total, (size_t)columns) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    return GridType_setObject(o, current_rows, total - 1, 0, columns - 1, source);
+}
+
+int GridType_appendRowsObject(struct GridTypeObject *o, size_t rows, RedisModuleString **source)
 {
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
-        ArrayGrid_rangeObject(ctx, o->array_grid, row_start, row_end, column_start, column_end);
+    long long current_rows, columns;
+    GridType_getDimensions(o, &current_rows, &columns);
+
+    // A capped grid keeps the newest rows, dropping its oldest rows to make room for them.
+    size_t dropped = 0;
+    if (o->capped_rows > 0 && (size_t)current_rows + rows > o->capped_rows)
+    {
+        if (rows > o->capped_rows)
+        {
+            source += (rows - o->capped_rows) * (size_t)columns;
+            rows = o->capped_rows;
+        }
+        dropped = (size_t)current_rows + rows - o->capped_rows;
+    }
+
+    // The dropped rows are taken out of the indexes, which then number the rows from the first
+    // row kept. The indexes are taken off the grid while the rows are moved, and the appended
+    // rows are added to them after.
+    if (dropped > 0)
+    {
+        GridType_indexCells(o, 0, (long long)dropped - 1, 0, columns - 1, 0);
+        for (struct GridIndex *index = o->indexes; index; index = index->next)
+            GridIndex_dropRows(index, dropped);
+    }
+    struct GridIndex *indexes = o->indexes;
+    struct GridChanges *changes = o->changes;
+    o->indexes = NULL;
+    o->changes = NULL;
+
+    int is_appended;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        if (dropped > 0)
+            ArrayGrid_dropRows(o->array_grid, dropped);
+        is_appended = ArrayGrid_appendRows(o->array_grid, rows, source);
+        break;
+    case STORAGE_TYPE_COLUMN:
+    case STORAGE_TYPE_SPARSE:
+    case STORAGE_TYPE_TILE:
+        is_appended = GridType_appendRowsByCopy(o, rows, source);
+        break;
+    default:
+        if (dropped > 0)
+            RowGrid_dropRows(o->row_grid, dropped);
+        is_appended = RowGrid_appendRows(o->row_grid, rows, source);
+        break;
+    }
+
+    o->indexes = indexes;
+    if (is_appended != REDISMODULE_OK)
+        GridType_staleIndexes(o);
+    else if (rows > 0)
+        GridType_indexCells(o, current_rows - (long long)dropped, current_rows - (long long)dropped + (long long)rows - 1, 0, columns - 1, 1);
+
+    // The rows kept are not changed by the rows dropped before them.
+    o->changes = changes;
+    if (is_appended == REDISMODULE_OK)
+    {
+        if (dropped > 0)
+            GridChanges_dropRows(o->changes, dropped);
+        if (GridChanges_resize(o->changes, (size_t)current_rows - dropped + rows, (size_t)columns) != REDISMODULE_OK)
+            GridType_resetChanges(o);
+    }
     else
-        RowGrid_rangeObject(ctx, o->row_grid, row_start, row_end, column_start, column_end);
+        GridType_resetChanges(o);
+
+    return is_appended;
+}
+
+// These grids insert and delete rows and columns by moving the cells after them through a
+// blob, so an edit costs a copy of those cells. Inserted cells are cleared from a snapshot of
+// the empty cells a resize adds.
+int GridType_insertRowsByCopy(struct GridTypeObject *o, size_t row, size_t count)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    if (GridType_resizeAndCopyObject(o, (size_t)rows + count, (size_t)columns) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+    if ((long long)row == rows || columns == 0)
+        return REDISMODULE_OK;
+
+    size_t empty_len, moved_len;
+    char *empty = GridType_snapshotObject(o, rows, rows + (long long)count - 1, 0, columns - 1, &empty_len);
+    char *moved = GridType_snapshotObject(o, (long long)row, rows - 1, 0, columns - 1, &moved_len);
+    if (GridType_setSnapshotObject(o, moved, moved_len, (long long)(row + count), 0) != REDISMODULE_OK)
+    {
+        if (empty)
+            RedisModule_Free(empty);
+        return REDISMODULE_ERR;
+    }
+
+    return GridType_setSnapshotObject(o, empty, empty_len, (long long)row, 0);
+}
+
+int GridType_deleteRowsByCopy(struct GridTypeObject *o, size_t row, size_t count)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    if ((long long)(row + count) < rows && columns > 0)
+    {
+        size_t len;
+        char *moved = GridType_snapshotObject(o, (long long)(row + count), rows - 1, 0, columns - 1, &len);
+        if (GridType_setSnapshotObject(o, moved, len, (long long)row, 0) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+    }
+
+    return GridType_resizeAndCopyObject(o, (size_t)rows - count, (size_t)columns);
+}
+
+int GridType_insertColumnsByCopy(struct GridTypeObject *o, size_t column, size_t count)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    if (GridType_resizeAndCopyObject(o, (size_t)rows, (size_t)columns + count) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+    if ((long long)column == columns || rows == 0)
+        return REDISMODULE_OK;
+
+    size_t empty_len, moved_len;
+    char *empty = GridType_snapshotObject(o, 0, rows - 1, columns, columns + (long long)count - 1, &empty_len);
+    char *moved = GridType_snapshotObject(o, 0, rows - 1, (long long)column, columns - 1, &moved_len);
+    if (GridType_setSnapshotObject(o, moved, moved_len, 0, (long long)(column + count)) != REDISMODULE_OK)
+    {
+        if (empty)
+            RedisModule_Free(empty);
+        return REDISMODULE_ERR;
+    }
+
+    return GridType_setSnapshotObject(o, empty, empty_len, 0, (long long)column);
+}
+
+int GridType_deleteColumnsByCopy(struct GridTypeObject *o, size_t column, size_t count)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    if ((long long)(column + count) < columns && rows > 0)
+    {
+        size_t len;
+        char *moved = GridType_snapshotObject(o, 0, rows - 1, (long long)(column + count), columns - 1, &len);
+        if (GridType_setSnapshotObject(o, moved, len, 0, (long long)column) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+    }
+
+    return GridType_resizeAndCopyObject(o, (size_t)rows, (size_t)columns - count);
 }
 
-int GridType_dump(RedisModuleCtx *ctx, struct GridTypeObject* o)
-{
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
-        return ArrayGrid_dump(ctx, o->array_grid);
-    else
-        return RowGrid_dump(ctx, o->row_grid);
-}
+// Each row is moved through a blob of its cells into a new grid, so every cell of the grid is
+// copied once. The original is left as it is when a row can not be moved.
+int GridType_permuteRowsByCopy(struct GridTypeObject *o, const size_t *order)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    struct GridTypeObject *permuted = GridType_createObject(o->storage_type, (size_t)rows, (size_t)columns, NULL);
+    if (!permuted)
+        return REDISMODULE_ERR;
+
+    for (long long r = 0; r < rows; ++r)
+    {
+        size_t len;
+        char *blob = GridType_snapshotObject(o, (long long)order[r], (long long)order[r], 0, columns - 1, &len);
+        if (GridType_setSnapshotObject(permuted, blob, len, r, 0) != REDISMODULE_OK)
+        {
+            GridType_releaseObject(permuted);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    // As with converting, the permuted grid takes the place of the original, which is
+    // released in its shell with the indexes and the changes kept.
+    struct GridTypeObject original = *o;
+    permuted->capped_rows = o->capped_rows;
+    permuted->indexes = o->indexes;
+    original.indexes = NULL;
+    original.changes = permuted->changes;
+    permuted->changes = o->changes;
+    *o = *permuted;
+    *permuted = original;
+    GridType_releaseObject(permuted);
+
+    return REDISMODULE_OK;
+}
+
+int GridType_insertRowsObject(struct GridTypeObject *o, size_t row, size_t count)
+{
+    // Inserting or deleting rows moves the rows after them, so the indexes are rebuilt. The
+    // changes are taken off the grid while the rows are moved, then moved with them.
+    GridType_staleIndexes(o);
+    struct GridChanges *changes = o->changes;
+    o->changes = NULL;
+
+    int is_inserted;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        is_inserted = ArrayGrid_insertRows(o->array_grid, row, count);
+        break;
+    case STORAGE_TYPE_COLUMN:
+    case STORAGE_TYPE_SPARSE:
+    case STORAGE_TYPE_TILE:
+        is_inserted = GridType_insertRowsByCopy(o, row, count);
+        break;
+    default:
+        is_inserted = RowGrid_insertRows(o->row_grid, row, count);
+        break;
+    }
+
+    o->changes = changes;
+    if (is_inserted != REDISMODULE_OK || GridChanges_insertRows(o->changes, row, count) != REDISMODULE_OK)
+        GridType_resetChanges(o);
+
+    return is_inserted;
+}
+
+int GridType_deleteRowsObject(struct GridTypeObject *o, size_t row, size_t count)
+{
+    GridType_staleIndexes(o);
+    struct GridChanges *changes = o->changes;
+    o->changes = NULL;
+
+    int is_deleted = REDISMODULE_OK;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        is_deleted = ArrayGrid_deleteRows(o->array_grid, row, count);
+        break;
+    case STORAGE_TYPE_COLUMN:
+    case STORAGE_TYPE_SPARSE:
+    case STORAGE_TYPE_TILE:
+        is_deleted = GridType_deleteRowsByCopy(o, row, count);
+        break;
+    default:
+        RowGrid_deleteRows(o->row_grid, row, count);
+        break;
+    }
+
+    o->changes = changes;
+    if (is_deleted == REDISMODULE_OK)
+        GridChanges_deleteRows(o->changes, row, count);
+    else
+        GridType_resetChanges(o);
+
+    return is_deleted;
+}
+
+int GridType_insertColumnsObject(struct GridTypeObject *o, size_t column, size_t count)
+{
+    // The cells keep their values as their columns move, so the indexes are taken off the grid
+    // while the cells are moved, then moved to their new columns.
+    struct GridIndex *indexes = o->indexes;
+    struct GridChanges *changes = o->changes;
+    o->indexes = NULL;
+    o->changes = NULL;
+
+    int is_inserted;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        is_inserted = ArrayGrid_insertColumns(o->array_grid, column, count);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        is_inserted = ColumnGrid_insertColumns(o->column_grid, column, count);
+        break;
+    case STORAGE_TYPE_SPARSE:
+    case STORAGE_TYPE_TILE:
+        is_inserted = GridType_insertColumnsByCopy(o, column, count);
+        break;
+    default:
+        is_inserted = RowGrid_insertColumns(o->row_grid, column, count);
+        break;
+    }
+
+    o->indexes = indexes;
+    if (is_inserted == REDISMODULE_OK)
+    {
+        for (struct GridIndex *index = o->indexes; index; index = index->next)
+        {
+            if (index->column >= column)
+                index->column += count;
+        }
+    }
+    else
+        GridType_staleIndexes(o);
+
+    o->changes = changes;
+    if (is_inserted != REDISMODULE_OK || GridChanges_insertColumns(o->changes, column, count) != REDISMODULE_OK)
+        GridType_resetChanges(o);
+
+    return is_inserted;
+}
+
+int GridType_deleteColumnsObject(struct GridTypeObject *o, size_t column, size_t count)
+{
+    // As with inserting, the indexes are taken off the grid while the cells are moved, and
+    // only moved to their new columns once the cells have been.
+    struct GridIndex *indexes = o->indexes;
+    struct GridChanges *changes = o->changes;
+    o->indexes = NULL;
+    o->changes = NULL;
+
+    int is_deleted = REDISMODULE_OK;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        is_deleted = ArrayGrid_deleteColumns(o->array_grid, column, count);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        ColumnGrid_deleteColumns(o->column_grid, column, count);
+        break;
+    case STORAGE_TYPE_SPARSE:
+    case STORAGE_TYPE_TILE:
+        is_deleted = GridType_deleteColumnsByCopy(o, column, count);
+        break;
+    default:
+        is_deleted = RowGrid_deleteColumns(o->row_grid, column, count);
+        break;
+    }
+
+    o->indexes = indexes;
+    if (is_deleted == REDISMODULE_OK)
+        GridType_deleteIndexColumns(o, column, count);
+    else
+        GridType_staleIndexes(o);
+
+    o->changes = changes;
+    if (is_deleted == REDISMODULE_OK)
+        GridChanges_deleteColumns(o->changes, column, count);
+    else
+        GridType_resetChanges(o);
+
+    return is_deleted;
+}
+
+// Moves the rows so row r of the grid is the row order[r] was.
+int GridType_permuteRowsObject(struct GridTypeObject *o, const size_t *order)
+{
+    GridType_staleIndexes(o);
+    struct GridChanges *changes = o->changes;
+    o->changes = NULL;
+
+    int is_permuted;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        is_permuted = ArrayGrid_permuteRows(o->array_grid, order);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        is_permuted = ColumnGrid_permuteRows(o->column_grid, order);
+        break;
+    case STORAGE_TYPE_SPARSE:
+    case STORAGE_TYPE_TILE:
+        is_permuted = GridType_permuteRowsByCopy(o, order);
+        break;
+    default:
+        is_permuted = RowGrid_permuteRows(o->row_grid, order);
+        break;
+    }
+
+    o->changes = changes;
+    if (is_permuted == REDISMODULE_OK)
+        GridChanges_touchAll(o->changes);
+    else
+        GridType_resetChanges(o);
+
+    return is_permuted;
+}
+
+// The number in a cell. Columnar storage reads numeric columns without formatting them.
+int GridType_getCellNumber(struct GridTypeObject *o, size_t row, size_t column, double *value)
+{
+    if (o->storage_type == STORAGE_TYPE_COLUMN)
+        return ColumnGrid_getDouble(o->column_grid->cstart + column, row, value);
+
+    char buf[GRID_NUMBER_BUFSIZE];
+    size_t len;
+    const char *data = GridType_getCellText(o, row, column, buf, &len);
+    return data ? GridType_parseDouble(data, len, value) : REDISMODULE_ERR;
+}
+
+// Finds the order of the rows sorted by a column. Numbers are radix sorted by value and text
+// is merge sorted by its bytes. Empty cells, and the text of a numeric sort, follow the sorted
+// cells in the order of their rows. The sorts are stable, so rows with equal values keep
+// their order. The caller frees the order.
+int GridType_sortOrder(struct GridTypeObject *o, size_t column, int mode, int is_descending, size_t **order)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    // The formatted numbers of columnar storage are kept apart, as the texts point at them until they are sorted.
+    char *formatted = mode == GRID_SORT_ALPHA && o->storage_type == STORAGE_TYPE_COLUMN ?
+        (char*)RedisModule_Alloc((size_t)rows * GRID_NUMBER_BUFSIZE) : NULL;
+    struct SortNumber *numbers = mode != GRID_SORT_ALPHA ? (struct SortNumber*)RedisModule_Alloc(sizeof(struct SortNumber) * (size_t)rows) : NULL;
+    struct SortText *texts = mode != GRID_SORT_NUMERIC ? (struct SortText*)RedisModule_Alloc(sizeof(struct SortText) * (size_t)rows) : NULL;
+    *order = (size_t*)RedisModule_Alloc(sizeof(size_t) * (size_t)rows);
+
+    int is_sorted = *order && (numbers || mode == GRID_SORT_ALPHA) && (texts || mode == GRID_SORT_NUMERIC) &&
+        (formatted || mode != GRID_SORT_ALPHA || o->storage_type != STORAGE_TYPE_COLUMN);
+
+    size_t number_count = 0, text_count = 0, other_count = 0;
+    for (size_t r = 0; is_sorted && r < (size_t)rows; ++r)
+    {
+        double value;
+        if (mode != GRID_SORT_ALPHA && GridType_getCellNumber(o, r, column, &value) == REDISMODULE_OK)
+        {
+            Sort_initNumber(&numbers[number_count++], value, r);
+            continue;
+        }
+
+        char buf[GRID_NUMBER_BUFSIZE];
+        size_t len;
+        const char *data = mode == GRID_SORT_NUMERIC ? NULL : GridType_getCellText(o, r, column, formatted ? formatted + r * GRID_NUMBER_BUFSIZE : buf, &len);
+        if (data)
+            Sort_initText(&texts[text_count++], data, len, r);
+        else
+            (*order)[rows - 1 - other_count++] = r;
+    }
+
+    is_sorted = is_sorted &&
+        Sort_numbers(numbers, number_count, is_descending) == REDISMODULE_OK &&
+        Sort_texts(texts, text_count, is_descending) == REDISMODULE_OK;
+
+    if (is_sorted)
+    {
+        // Numbers sort before text, so a descending sort puts the text first.
+        size_t *p = *order;
+        if (is_descending)
+        {
+            for (size_t i = 0; i < text_count; ++i)
+                *p++ = texts[i].row;
+        }
+        for (size_t i = 0; i < number_count; ++i)
+            *p++ = numbers[i].row;
+        if (!is_descending)
+        {
+            for (size_t i = 0; i < text_count; ++i)
+                *p++ = texts[i].row;
+        }
+
+        // The other rows were gathered backwards from the end.
+        for (size_t *q = *order + rows - 1; p < q; ++p, --q)
+        {
+            size_t row = *p;
+            *p = *q;
+            *q = row;
+        }
+    }
+    else if (*order)
+    {
+        RedisModule_Free(*order);
+        *order = NULL;
+    }
+
+    if (formatted)
+        RedisModule_Free(formatted);
+    if (numbers)
+        RedisModule_Free(numbers);
+    if (texts)
+        RedisModule_Free(texts);
+
+    return is_sorted ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+// Sorts the rows of the grid by a column. A grid already in order is left as it is.
+int GridType_sortObject(struct GridTypeObject *o, size_t column, int mode, int is_descending)
+{
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+    if (rows < 2)
+        return REDISMODULE_OK;
+
+    size_t *order;
+    if (GridType_sortOrder(o, column, mode, is_descending, &order) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t r = 0;
+    while (r < (size_t)rows && order[r] == r)
+        ++r;
+
+    int is_sorted = r == (size_t)rows ? REDISMODULE_OK : GridType_permuteRowsObject(o, order);
+
+    RedisModule_Free(order);
+
+    return is_sorted;
+}
+
+/* Background reads */
+
+struct GridTypeRead {
+    RedisModuleBlockedClient *bc;
+    char *blob;
+    size_t len;
+    int with_shape;
+    int order;
+};
+
+void GridType_replyWithSnapshotCell(RedisModuleCtx *ctx, const struct BlobReader *blob, size_t column, size_t row)
+{
+    char buf[GRID_NUMBER_BUFSIZE];
+    size_t len;
+    const char *text = Blob_formatCell(blob, column, row, buf, &len);
+    if (text)
+        RedisModule_ReplyWithStringBuffer(ctx, text, len);
+    else
+        RedisModule_ReplyWithNull(ctx);
+}
+
+void GridType_replyWithSnapshot(RedisModuleCtx *ctx, const struct BlobReader *blob, int with_shape, int order)
+{
+    RedisModule_ReplyWithArray(ctx, (long)(blob->rows * blob->columns + (with_shape ? 2 : 0)));
+
+    if (with_shape)
+    {
+        RedisModule_ReplyWithLongLong(ctx, (long long)blob->rows);
+        RedisModule_ReplyWithLongLong(ctx, (long long)blob->columns);
+    }
+
+    // The snapshot holds the cells by column.
+    if (order == GRID_ORDER_COLUMNS)
+    {
+        for (size_t c = 0; c < blob->columns; ++c)
+        {
+            for (size_t r = 0; r < blob->rows; ++r)
+                GridType_replyWithSnapshotCell(ctx, blob, c, r);
+        }
+        return;
+    }
+
+    for (size_t r = 0; r < blob->rows; ++r)
+    {
+        for (size_t c = 0; c < blob->columns; ++c)
+            GridType_replyWithSnapshotCell(ctx, blob, c, r);
+    }
+}
+
+// Runs on a worker thread. The replies accumulate in the thread safe context
+// and are sent when the client is unblocked.
+void GridType_readWorker(void *arg)
+{
+    struct GridTypeRead *read = arg;
+
+    RedisModuleCtx *ctx = RedisModule_GetThreadSafeContext(read->bc);
+    struct BlobReader blob;
+    if (Blob_open(&blob, read->blob, read->len) == REDISMODULE_OK)
+        GridType_replyWithSnapshot(ctx, &blob, read->with_shape, read->order);
+    else
+        RedisModule_ReplyWithError(ctx, "Failed to read the grid");
+    RedisModule_FreeThreadSafeContext(ctx);
+
+    RedisModule_UnblockClient(read->bc, read);
+}
+
+int GridType_ReadReply(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // The reply was built by the worker.
+    return REDISMODULE_OK;
+}
+
+void GridType_freeRead(void *privdata)
+{
+    struct GridTypeRead *read = privdata;
+    RedisModule_Free(read->blob);
+    RedisModule_Free(read);
+}
+
+// Hands a large read to the worker pool. Returns REDISMODULE_ERR when the read
+// should be replied to inline instead.
+int GridType_replyInBackground(RedisModuleCtx *ctx, struct GridTypeObject *o, long long row_start, long long row_end, long long column_start, long long column_end, int with_shape, int order)
+{
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    if (!Worker_isRunning() || rows * columns < worker_threshold)
+        return REDISMODULE_ERR;
+
+    // Clients inside MULTI or a script cannot be blocked.
+    if (RedisModule_GetContextFlags && (RedisModule_GetContextFlags(ctx) & (REDISMODULE_CTX_FLAGS_MULTI | REDISMODULE_CTX_FLAGS_LUA)))
+        return REDISMODULE_ERR;
+
+    size_t len;
+    char *blob = GridType_snapshotObject(o, row_start, row_end, column_start, column_end, &len);
+    if (!blob)
+        return REDISMODULE_ERR;
+
+    struct GridTypeRead *read = (struct GridTypeRead*)RedisModule_Alloc(sizeof(struct GridTypeRead));
+    read->blob = blob;
+    read->len = len;
+    read->with_shape = with_shape;
+    read->order = order;
+    read->bc = RedisModule_BlockClient(ctx, GridType_ReadReply, NULL, GridType_freeRead, 0);
+
+    if (Worker_submit(GridType_readWorker, read) != REDISMODULE_OK)
+        GridType_readWorker(read);
+
+    return REDISMODULE_OK;
+}
+
+int GridType_getRangeValues(RedisModuleCtx *ctx, struct GridTypeObject *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end)
+{
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        return ArrayGrid_getRangeValues(ctx, o->array_grid, argv, row_start, row_end, column_start, column_end);
+    case STORAGE_TYPE_COLUMN:
+        return ColumnGrid_getRangeValues(ctx, o->column_grid, argv, row_start, row_end, column_start, column_end);
+    case STORAGE_TYPE_SPARSE:
+        return SparseGrid_getRangeValues(ctx, o->sparse_grid, argv, row_start, row_end, column_start, column_end);
+    case STORAGE_TYPE_TILE:
+        return TileGrid_getRangeValues(ctx, o->tile_grid, argv, row_start, row_end, column_start, column_end);
+    default:
+        return RowGrid_getRangeValues(ctx, o->row_grid, argv, row_start, row_end, column_start, column_end);
+    }
+}
+
+unsigned char GridType_parseStorageType(const char *name)
+{
+    if (strcasecmp(name, "ARRAY") == 0)
+        return STORAGE_TYPE_ARRAY;
+    if (strcasecmp(name, "ROW") == 0)
+        return STORAGE_TYPE_ROW;
+    if (strcasecmp(name, "COLUMNAR") == 0)
+        return STORAGE_TYPE_COLUMN;
+    if (strcasecmp(name, "SPARSE") == 0)
+        return STORAGE_TYPE_SPARSE;
+    if (strcasecmp(name, "TILE") == 0)
+        return STORAGE_TYPE_TILE;
+    return 0;
+}
+
+const char *GridType_storageTypeName(unsigned char storage_type)
+{
+    switch (storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        return "ARRAY";
+    case STORAGE_TYPE_COLUMN:
+        return "COLUMNAR";
+    case STORAGE_TYPE_SPARSE:
+        return "SPARSE";
+    case STORAGE_TYPE_TILE:
+        return "TILE";
+    default:
+        return "ROW";
+    }
+}
+
+int GridType_isDimOption(RedisModuleString *arg)
+{
+    const char *name = RedisModule_StringPtrLen(arg, NULL);
+    return strcasecmp(name, "CAPPED") == 0 || strcasecmp(name, "STORAGE") == 0;
+}
+
+// Reads the CAPPED and STORAGE options, which come before the values, moving the start of the
+// values past them. The leading option pairs are read as options when they are followed by no
+// values or by one for every cell. When they are followed by any other count they are read as
+// values, so a grid can still be filled with values which look like options.
+int GridType_getDimOptions(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, long long len, int *values, long long *capped_rows, unsigned char *storage_type)
+{
+    int options = 0;
+    while (argc - *values - options >= 2 && GridType_isDimOption(argv[*values + options]))
+        options += 2;
+
+    // All the leading pairs are options when nothing follows them, otherwise only as many as
+    // leave one value for every cell.
+    long long count = argc - *values;
+    if (count - options != 0)
+    {
+        if (count - len < 0 || count - len > options || (count - len) % 2 != 0)
+            return REDISMODULE_OK;
+        options = (int)(count - len);
+    }
+
+    for (RedisModuleString **option = argv + *values; option < argv + *values + options; option += 2)
+    {
+        if (strcasecmp(RedisModule_StringPtrLen(option[0], NULL), "CAPPED") == 0)
+        {
+            if (RedisModule_StringToLongLong(option[1], capped_rows) != REDISMODULE_OK || *capped_rows < 0)
+            {
+                RedisModule_ReplyWithError(ctx, "Capped rows must be a positive integer");
+                return REDISMODULE_ERR;
+            }
+        }
+        else if ((*storage_type = GridType_parseStorageType(RedisModule_StringPtrLen(option[1], NULL))) == 0)
+        {
+            RedisModule_ReplyWithError(ctx, "Storage must be one of ARRAY, ROW, COLUMNAR, SPARSE or TILE");
+            return REDISMODULE_ERR;
+        }
+    }
+    *values += options;
+
+    return REDISMODULE_OK;
+}
+
+int GridType_DimCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.DIM KEY ROWS COLS [CAPPED ROWS] [STORAGE ARRAY|ROW|COLUMNAR|SPARSE|TILE] [R0-C0, R0-C1,,, ... ]
+    if (argc < 4)
+        return RedisModule_WrongArity(ctx);
+
+    long long rows;
+    if (RedisModule_StringToLongLong(argv[2], &rows) != REDISMODULE_OK)
+    {
+        return RedisModule_ReplyWithError(ctx, "WRONGTYPE Row should be an int");
+    }
+    if (rows < 0)
+    {
+        return RedisModule_ReplyWithError(ctx, "Rows must be gretaer than 0");
+    }
+    if ((unsigned long long)rows > SIZE_MAX)
+    {
+        return RedisModule_ReplyWithError(ctx, "Rows to large");
+    }
+
+    long long columns;
+    if (RedisModule_StringToLongLong(argv[3], &columns) != REDISMODULE_OK)
+    {
+        return RedisModule_ReplyWithError(ctx, "WRONGTYPE Row should be an int");
+    }
+    if (columns < 0)
+    {
+        return RedisModule_ReplyWithError(ctx, "Columns must be grater than 0");
+    }
+    if ((unsigned long long)columns > SIZE_MAX)
+    {
+        return RedisModule_ReplyWithError(ctx, "Columns too large");
+    }
+
+    long long len = rows * columns;
+    if ((unsigned long long)len > SIZE_MAX)
+        return RedisModule_ReplyWithError(ctx, "Grid too large");
+
+    int values = 4;
+    long long capped_rows = -1;
+    unsigned char storage_type = 0;
+    if (GridType_getDimOptions(ctx, argv, argc, len, &values, &capped_rows, &storage_type) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+    
+    if (argc > values && (argc - values) != len)
+        return RedisModule_ReplyWithError(ctx, "ARGCOUNT Invalid number of values for grid");
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+
+    // The cap and the storage type of an existing grid are kept unless they are given again.
+    long long grid_capped_rows = capped_rows;
+    unsigned char grid_storage_type = storage_type ? storage_type : current_storage_type;
+    if (type == REDISMODULE_KEYTYPE_MODULE && RedisModule_ModuleTypeGetType(key) == GridType)
+    {
+        struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+        if (capped_rows < 0)
+            grid_capped_rows = (long long)o->capped_rows;
+        if (!storage_type)
+            grid_storage_type = o->storage_type;
+    }
+    if (grid_capped_rows > 0 && rows > grid_capped_rows)
+    {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithError(ctx, "Rows exceed the capped rows of the grid");
+    }
+
+    // Only the array and row storage drop their oldest rows without moving the rows they keep.
+    if (grid_capped_rows > 0 && grid_storage_type != STORAGE_TYPE_ARRAY && grid_storage_type != STORAGE_TYPE_ROW)
+    {
+        RedisModule_CloseKey(key);
+        return RedisModule_ReplyWithError(ctx, "Capped grids must use ARRAY or ROW storage");
+    }
+
+    // A grid given a storage type is created in it, or converted to it when it exists.
+    int status = GridType_reshapeObject(ctx, key, type, grid_storage_type, (size_t)rows, (size_t)columns, argc > values ? argv + values : NULL);
+    if (RedisModule_KeyType(key) == REDISMODULE_KEYTYPE_MODULE && RedisModule_ModuleTypeGetType(key) == GridType)
+    {
+        struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+        if (capped_rows >= 0)
+            o->capped_rows = (size_t)capped_rows;
+        if (storage_type && status == REDISMODULE_OK && GridType_convertObject(o, storage_type) != REDISMODULE_OK)
+        {
+            RedisModule_CloseKey(key);
+            return RedisModule_ReplyWithError(ctx, "Failed to convert the grid");
+        }
+    }
+    RedisModule_CloseKey(key);
+
+    if (status != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to dimension the grid");
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return status;
+}
+
+int GridType_SetCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // GRID.SET KEY ROW-START ROW-END COLUMN-START COLUMN-END ROW0-COL0 ... ROWN-COLN
+    if (argc < 6)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long row_start, row_end, column_start, column_end;
+    int are_ranges_ok  = GridType_getRangeValues(ctx, o, argv + 2, &row_start, &row_end, &column_start, &column_end);
+    if (are_ranges_ok != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long len = rows * columns;
+
+    if (len != argc - 6)
+        return RedisModule_ReplyWithError(ctx, "Invalid number of values");
+
+    if (GridType_setObject(o, row_start, row_end, column_start, column_end, argv + 6) != REDISMODULE_OK)
+    {
+        return RedisModule_ReplyWithError(ctx, "Failed to set one or more items in the grid");
+    }
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+// A rectangle of a grid and the values to set it to.
+struct GridTypeRect {
+    long long row_start;
+    long long row_end;
+    long long column_start;
+    long long column_end;
+    RedisModuleString **values;
+};
+
+// Parses ROW-START ROW-END COLUMN-START COLUMN-END VALUES... for each rectangle.
+int GridType_getMSetRects(RedisModuleCtx *ctx, struct GridTypeObject *o, RedisModuleString **argv, int argc, struct GridTypeRect *rects, size_t *count)
+{
+    *count = 0;
+    for (int i = 2; i < argc; ++*count)
+    {
+        struct GridTypeRect *rect = rects + *count;
+        if (argc - i < 5)
+        {
+            RedisModule_ReplyWithError(ctx, "Invalid number of values");
+            return REDISMODULE_ERR;
+        }
+
+        if (GridType_getRangeValues(ctx, o, argv + i, &rect->row_start, &rect->row_end, &rect->column_start, &rect->column_end) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+
+        long long rows = 1 + (max(rect->row_start, rect->row_end) - min(rect->row_start, rect->row_end));
+        long long columns = 1 + (max(rect->column_start, rect->column_end) - min(rect->column_start, rect->column_end));
+        long long len = rows * columns;
+
+        if (len > argc - i - 4)
+        {
+            RedisModule_ReplyWithError(ctx, "Invalid number of values");
+            return REDISMODULE_ERR;
+        }
+
+        rect->values = argv + i + 4;
+        i += 4 + (int)len;
+    }
+
+    return REDISMODULE_OK;
+}
+
+// Parses CELLS ROW COLUMN VALUE ... as a rectangle for each cell.
+int GridType_getMSetCells(RedisModuleCtx *ctx, struct GridTypeObject *o, RedisModuleString **argv, int argc, struct GridTypeRect *rects, size_t *count)
+{
+    if (argc == 3 || (argc - 3) % 3 != 0)
+    {
+        RedisModule_ReplyWithError(ctx, "Invalid number of values");
+        return REDISMODULE_ERR;
+    }
+
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    *count = 0;
+    for (int i = 3; i < argc; i += 3, ++*count)
+    {
+        struct GridTypeRect *rect = rects + *count;
+        if (GridType_getRangeValue(ctx, argv, i, rows, &rect->row_start, "Row must be an integer", "Row outside the bounds of the grid") != REDISMODULE_OK ||
+            GridType_getRangeValue(ctx, argv, i + 1, columns, &rect->column_start, "Column must be an integer", "Column outside the bounds of the grid") != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+
+        rect->row_end = rect->row_start;
+        rect->column_end = rect->column_start;
+        rect->values = argv + i + 2;
+    }
+
+    return REDISMODULE_OK;
+}
+
+int GridType_MSetCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // GRID.MSET KEY ROW-START ROW-END COLUMN-START COLUMN-END ROW0-COL0 ... ROWN-COLN [ROW-START ...]
+    // GRID.MSET KEY CELLS ROW COLUMN VALUE [ROW COLUMN VALUE ...]
+    if (argc < 3)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    // Every rectangle is checked before any is set, so a bad one leaves the grid unchanged.
+    const char *keyword = RedisModule_StringPtrLen(argv[2], NULL);
+    int is_cells = strcasecmp(keyword, "CELLS") == 0;
+    struct GridTypeRect *rects = (struct GridTypeRect*)RedisModule_Alloc(sizeof(struct GridTypeRect) * (size_t)(argc / 3));
+    size_t count;
+    int are_rects_ok = is_cells ?
+        GridType_getMSetCells(ctx, o, argv, argc, rects, &count) :
+        GridType_getMSetRects(ctx, o, argv, argc, rects, &count);
+    if (are_rects_ok != REDISMODULE_OK)
+    {
+        RedisModule_Free(rects);
+        return REDISMODULE_ERR;
+    }
+
+    for (const struct GridTypeRect *rect = rects, *end = rects + count; rect < end; ++rect)
+    {
+        if (GridType_setObject(o, rect->row_start, rect->row_end, rect->column_start, rect->column_end, rect->values) != REDISMODULE_OK)
+        {
+            RedisModule_Free(rects);
+            return RedisModule_ReplyWithError(ctx, "Failed to set one or more items in the grid");
+        }
+    }
+
+    RedisModule_Free(rects);
+
+    // Replicated once all of the rectangles are set, as the command was issued.
+    RedisModule_ReplicateVerbatim(ctx);
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+int GridType_AppendRowsCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // GRID.APPENDROWS KEY ROW0-COL0 ... ROWN-COLN
+    if (argc < 3)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+    if (columns == 0)
+        return RedisModule_ReplyWithError(ctx, "The grid has no columns");
+    if ((argc - 2) % columns != 0)
+        return RedisModule_ReplyWithError(ctx, "Invalid number of values");
+
+    long long count = (argc - 2) / columns;
+    if (GridType_appendRowsObject(o, (size_t)count, argv + 2) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to append the rows to the grid");
+
+    GridType_getDimensions(o, &rows, &columns);
+    RedisModule_ReplyWithLongLong(ctx, rows);
+
+    return REDISMODULE_OK;
+}
+
+int GridType_PushRowCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // GRID.PUSHROW KEY COL0 ... COLN
+    if (argc < 3)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+    if (columns == 0)
+        return RedisModule_ReplyWithError(ctx, "The grid has no columns");
+    if (argc - 2 != columns)
+        return RedisModule_ReplyWithError(ctx, "Invalid number of values");
+
+    if (GridType_appendRowsObject(o, 1, argv + 2) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to push the row to the grid");
+
+    GridType_getDimensions(o, &rows, &columns);
+    RedisModule_ReplyWithLongLong(ctx, rows);
+
+    return REDISMODULE_OK;
+}
+
+// Reads the position and the count of the rows or columns to insert or delete. Inserts may be
+// made at the position after the last one.
+int GridType_getEditValues(RedisModuleCtx *ctx, RedisModuleString **argv, long long max_value, long long *position, long long *count, const char *bounds_errmsg)
+{
+    if (GridType_getRangeValue(ctx, argv, 2, max_value, position, "WRONGTYPE Position should be an int", bounds_errmsg) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_StringToLongLong(argv[3], count) != REDISMODULE_OK || *count <= 0)
+    {
+        RedisModule_ReplyWithError(ctx, "Count must be a positive integer");
+        return REDISMODULE_ERR;
+    }
+
+    return REDISMODULE_OK;
+}
+
+int GridType_InsertRowsCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // GRID.INSERTROWS KEY ROW COUNT
+    if (argc != 4)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns, row, count;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getEditValues(ctx, argv, rows + 1, &row, &count, "Row out of range") != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    if (columns > 0 && (unsigned long long)count > SIZE_MAX / (size_t)columns - (size_t)rows)
+        return RedisModule_ReplyWithError(ctx, "Grid too large");
+    if (o->capped_rows > 0 && (size_t)(rows + count) > o->capped_rows)
+        return RedisModule_ReplyWithError(ctx, "Rows exceed the capped rows of the grid");
+
+    if (GridType_insertRowsObject(o, (size_t)row, (size_t)count) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to insert the rows into the grid");
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+int GridType_DeleteRowsCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // GRID.DELETEROWS KEY ROW COUNT
+    if (argc != 4)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns, row, count;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getEditValues(ctx, argv, rows, &row, &count, "Row out of range") != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    if (count > rows - row)
+        return RedisModule_ReplyWithError(ctx, "Count out of range");
+
+    // As with dimensioning, a grid without rows is deleted.
+    if (count == rows)
+        RedisModule_DeleteKey(key);
+    else if (GridType_deleteRowsObject(o, (size_t)row, (size_t)count) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to delete the rows from the grid");
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+int GridType_InsertColumnsCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // GRID.INSERTCOLS KEY COLUMN COUNT
+    if (argc != 4)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns, column, count;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getEditValues(ctx, argv, columns + 1, &column, &count, "Column out of range") != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    if (rows > 0 && (unsigned long long)count > SIZE_MAX / (size_t)rows - (size_t)columns)
+        return RedisModule_ReplyWithError(ctx, "Grid too large");
+
+    if (GridType_insertColumnsObject(o, (size_t)column, (size_t)count) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to insert the columns into the grid");
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+int GridType_DeleteColumnsCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // GRID.DELETECOLS KEY COLUMN COUNT
+    if (argc != 4)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns, column, count;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getEditValues(ctx, argv, columns, &column, &count, "Column out of range") != REDISMODULE_OK)
+        return REDISMODULE_OK;
+    if (count > columns - column)
+        return RedisModule_ReplyWithError(ctx, "Count out of range");
+
+    // As with dimensioning, a grid without columns is deleted.
+    if (count == columns)
+        RedisModule_DeleteKey(key);
+    else if (GridType_deleteColumnsObject(o, (size_t)column, (size_t)count) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to delete the columns from the grid");
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+int GridType_LoadBlobCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.LOADBLOB KEY BLOB
+    if (argc != 3)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    size_t len;
+    const char *data = RedisModule_StringPtrLen(argv[2], &len);
+    struct BlobReader blob;
+    if (Blob_open(&blob, data, len) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Invalid blob");
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type != REDISMODULE_KEYTYPE_EMPTY && RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    // As with dimensioning, an existing grid keeps its cap.
+    if (type != REDISMODULE_KEYTYPE_EMPTY)
+    {
+        struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+        if (o->capped_rows > 0 && blob.rows > o->capped_rows)
+            return RedisModule_ReplyWithError(ctx, "Rows exceed the capped rows of the grid");
+    }
+
+    // Every cell is overwritten from the blob, so an existing grid is only resized.
+    if (GridType_reshapeObject(ctx, key, type, current_storage_type, blob.rows, blob.columns, NULL) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to dimension the grid");
+
+    if (blob.rows > 0 && blob.columns > 0)
+    {
+        struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+        if (GridType_setBlobObject(o, 0, (long long)blob.rows - 1, 0, (long long)blob.columns - 1, &blob) != REDISMODULE_OK)
+            return RedisModule_ReplyWithError(ctx, "Failed to set one or more items in the grid");
+    }
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+int GridType_SetBlobCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.SETBLOB KEY ROW-START ROW-END COLUMN-START COLUMN-END BLOB
+    if (argc != 7)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long row_start, row_end, column_start, column_end;
+    int are_ranges_ok  = GridType_getRangeValues(ctx, o, argv + 2, &row_start, &row_end, &column_start, &column_end);
+    if (are_ranges_ok != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t len;
+    const char *data = RedisModule_StringPtrLen(argv[6], &len);
+    struct BlobReader blob;
+    if (Blob_open(&blob, data, len) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Invalid blob");
+
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    if ((size_t)rows != blob.rows || (size_t)columns != blob.columns)
+        return RedisModule_ReplyWithError(ctx, "The blob does not match the range");
+
+    if (GridType_setBlobObject(o, row_start, row_end, column_start, column_end, &blob) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Failed to set one or more items in the grid");
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+int GridType_CopyCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.COPY SOURCE DESTINATION [REPLACE]
+    if (argc != 3 && argc != 4)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    int replace = 0;
+    if (argc == 4)
+    {
+        if (strcasecmp(RedisModule_StringPtrLen(argv[3], NULL), "REPLACE") != 0)
+            return RedisModule_ReplyWithError(ctx, "Expected REPLACE");
+        replace = 1;
+    }
+
+    RedisModuleKey *source = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ);
+    int type = RedisModule_KeyType(source);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(source) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(source);
+
+    // A grid copied onto itself is left as it is.
+    if (RedisModule_StringCompare(argv[1], argv[2]) == 0)
+        return RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    RedisModuleKey *destination = RedisModule_OpenKey(ctx, argv[2], REDISMODULE_READ|REDISMODULE_WRITE);
+    if (RedisModule_KeyType(destination) != REDISMODULE_KEYTYPE_EMPTY && !replace)
+        return RedisModule_ReplyWithError(ctx, "Destination key already exists");
+
+    // The copy shares its storage with the original until one of them is written to.
+    struct GridTypeObject *copy = GridType_copyObject(o);
+    if (!copy)
+        return RedisModule_ReplyWithError(ctx, "Failed to copy the grid");
+
+    RedisModule_ModuleTypeSetValue(destination, GridType, copy);
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+// Reads the ORDER ROWS or ORDER COLUMNS which may follow the arguments of a read.
+int GridType_getOrder(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int argi, int *order)
+{
+    *order = GRID_ORDER_ROWS;
+    if (argc == argi)
+        return REDISMODULE_OK;
+
+    if (strcasecmp(RedisModule_StringPtrLen(argv[argi], NULL), "ORDER") != 0)
+    {
+        RedisModule_ReplyWithError(ctx, "Expected ORDER");
+        return REDISMODULE_ERR;
+    }
+
+    const char *name = RedisModule_StringPtrLen(argv[argi + 1], NULL);
+    if (strcasecmp(name, "COLUMNS") == 0)
+        *order = GRID_ORDER_COLUMNS;
+    else if (strcasecmp(name, "ROWS") != 0)
+    {
+        RedisModule_ReplyWithError(ctx, "Order must be ROWS or COLUMNS");
+        return REDISMODULE_ERR;
+    }
+
+    return REDISMODULE_OK;
+}
+
+// Reads the STEP and ORDER options which may follow the range of GRID.RANGE.
+int GridType_getRangeOptions(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int argi, long long *row_step, long long *column_step, int *order)
+{
+    *row_step = *column_step = 1;
+    *order = GRID_ORDER_ROWS;
+
+    while (argi < argc)
+    {
+        const char *keyword = RedisModule_StringPtrLen(argv[argi], NULL);
+        if (strcasecmp(keyword, "ORDER") == 0 && argi + 2 <= argc)
+        {
+            if (GridType_getOrder(ctx, argv, argi + 2, argi, order) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+            argi += 2;
+        }
+        else if (strcasecmp(keyword, "STEP") == 0 && argi + 3 <= argc)
+        {
+            if (RedisModule_StringToLongLong(argv[argi + 1], row_step) != REDISMODULE_OK || *row_step <= 0 ||
+                RedisModule_StringToLongLong(argv[argi + 2], column_step) != REDISMODULE_OK || *column_step <= 0)
+            {
+                RedisModule_ReplyWithError(ctx, "Step must be a positive integer");
+                return REDISMODULE_ERR;
+            }
+            argi += 3;
+        }
+        else
+        {
+            RedisModule_ReplyWithError(ctx, "Expected STEP or ORDER");
+            return REDISMODULE_ERR;
+        }
+    }
+
+    return REDISMODULE_OK;
+}
+
+int GridType_RangeCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.RANGE KEY START-ROW END-ROW SART-COLUMN END-COLUMN [STEP ROWS COLUMNS] [ORDER ROWS|COLUMNS]
+    if (argc < 6)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    long long row_step, column_step;
+    int order;
+    if (GridType_getRangeOptions(ctx, argv, argc, 6, &row_step, &column_step, &order) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long row_start, row_end, column_start, column_end;
+    int are_ranges_ok  = GridType_getRangeValues(ctx, o, argv + 2, &row_start, &row_end, &column_start, &column_end);
+    if (are_ranges_ok != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    // A stepped read only touches the cells it replies with, so it is not snapshotted for the workers.
+    int is_stepped = row_step > 1 || column_step > 1;
+    if (is_stepped || GridType_replyInBackground(ctx, o, row_start, row_end, column_start, column_end, 0, order) != REDISMODULE_OK)
+        GridType_rangeObject(ctx, o, row_start, row_end, column_start, column_end, row_step, column_step, order);
+
+    return REDISMODULE_OK;
+}
+
+int GridType_MRangeCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.MRANGE KEY START-ROW END-ROW START-COLUMN END-COLUMN [KEY START-ROW END-ROW START-COLUMN END-COLUMN ...]
+    if (argc < 6 || (argc - 1) % 5 != 0)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    // Every key and range is checked before the reply is started, a missing key replies with a null.
+    size_t count = (size_t)(argc - 1) / 5;
+    struct GridTypeObject **objects = (struct GridTypeObject**)RedisModule_Alloc(sizeof(struct GridTypeObject*) * count);
+    struct GridTypeRect *rects = (struct GridTypeRect*)RedisModule_Alloc(sizeof(struct GridTypeRect) * count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        RedisModuleString **args = argv + 1 + i * 5;
+        RedisModuleKey *key = RedisModule_OpenKey(ctx, args[0], REDISMODULE_READ);
+        int type = RedisModule_KeyType(key);
+        objects[i] = NULL;
+        if (type == REDISMODULE_KEYTYPE_EMPTY)
+            continue;
+        if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        {
+            RedisModule_Free(objects);
+            RedisModule_Free(rects);
+            return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        }
+
+        objects[i] = RedisModule_ModuleTypeGetValue(key);
+        struct GridTypeRect *rect = rects + i;
+        if (GridType_getRangeValues(ctx, objects[i], args + 1, &rect->row_start, &rect->row_end, &rect->column_start, &rect->column_end) != REDISMODULE_OK)
+        {
+            RedisModule_Free(objects);
+            RedisModule_Free(rects);
+            return REDISMODULE_ERR;
+        }
+    }
+
+    RedisModule_ReplyWithArray(ctx, (long)count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const struct GridTypeRect *rect = rects + i;
+        if (objects[i])
+            GridType_rangeObject(ctx, objects[i], rect->row_start, rect->row_end, rect->column_start, rect->column_end, 1, 1, GRID_ORDER_ROWS);
+        else
+            RedisModule_ReplyWithNull(ctx);
+    }
+
+    RedisModule_Free(objects);
+    RedisModule_Free(rects);
+
+    return REDISMODULE_OK;
+}
+
+int GridType_RangeBlobCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.RANGEBLOB KEY START-ROW END-ROW START-COLUMN END-COLUMN
+    if (argc != 6)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long row_start, row_end, column_start, column_end;
+    int are_ranges_ok  = GridType_getRangeValues(ctx, o, argv + 2, &row_start, &row_end, &column_start, &column_end);
+    if (are_ranges_ok != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t len;
+    char *blob = GridType_rangeBlobObject(o, row_start, row_end, column_start, column_end, &len);
+    if (!blob)
+        return RedisModule_ReplyWithError(ctx, "Range is too large");
+
+    RedisModule_ReplyWithStringBuffer(ctx, blob, len);
+    RedisModule_Free(blob);
+
+    return REDISMODULE_OK;
+}
+
+int GridType_AggCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.AGG KEY FUNCTION START-ROW END-ROW START-COLUMN END-COLUMN [AXIS ROWS|COLUMNS]
+    if (argc != 7 && argc != 9)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    int function = Aggregate_parseFunction(RedisModule_StringPtrLen(argv[2], NULL));
+    if (function == 0)
+        return RedisModule_ReplyWithError(ctx, "Function must be one of SUM, MEAN, MIN, MAX, COUNT or STDDEV");
+
+    int axis = AGGREGATE_AXIS_NONE;
+    if (argc == 9)
+    {
+        const char *keyword = RedisModule_StringPtrLen(argv[7], NULL);
+        const char *name = RedisModule_StringPtrLen(argv[8], NULL);
+        if (strcasecmp(keyword, "AXIS") != 0)
+            return RedisModule_ReplyWithError(ctx, "Expected AXIS");
+        if (strcasecmp(name, "ROWS") == 0)
+            axis = AGGREGATE_AXIS_ROWS;
+        else if (strcasecmp(name, "COLUMNS") == 0)
+            axis = AGGREGATE_AXIS_COLUMNS;
+        else
+            return RedisModule_ReplyWithError(ctx, "Axis must be ROWS or COLUMNS");
+    }
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long row_start, row_end, column_start, column_end;
+    int are_ranges_ok  = GridType_getRangeValues(ctx, o, argv + 3, &row_start, &row_end, &column_start, &column_end);
+    if (are_ranges_ok != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t count = 1;
+    if (axis == AGGREGATE_AXIS_ROWS)
+        count = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    else if (axis == AGGREGATE_AXIS_COLUMNS)
+        count = 1 + (max(column_start, column_end) - min(column_start, column_end));
+
+    struct Aggregate *results = (struct Aggregate*)RedisModule_Alloc(sizeof(struct Aggregate) * count);
+    for (size_t i = 0; i < count; ++i)
+        Aggregate_init(results + i);
+
+    GridType_aggregateObject(o, row_start, row_end, column_start, column_end, axis, results);
+
+    if (axis == AGGREGATE_AXIS_NONE)
+    {
+        Aggregate_reply(ctx, results, function);
+    }
+    else
+    {
+        RedisModule_ReplyWithArray(ctx, (long)count);
+        for (size_t i = 0; i < count; ++i)
+            Aggregate_reply(ctx, results + i, function);
+    }
+
+    RedisModule_Free(results);
+
+    return REDISMODULE_OK;
+}
+
+void GridType_replyWithBucket(RedisModuleCtx *ctx, const struct Aggregate *a, int is_reversed)
+{
+    if (a->count == 0)
+    {
+        for (int i = 0; i < 4; ++i)
+            RedisModule_ReplyWithNull(ctx);
+        return;
+    }
+
+    // A bucket read backwards is aggregated forwards, so its first number is the last one found.
+    RedisModule_ReplyWithDouble(ctx, is_reversed ? a->last : a->first);
+    RedisModule_ReplyWithDouble(ctx, is_reversed ? a->first : a->last);
+    RedisModule_ReplyWithDouble(ctx, a->min);
+    RedisModule_ReplyWithDouble(ctx, a->max);
+}
+
+int GridType_DownsampleCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.DOWNSAMPLE KEY START-ROW END-ROW START-COLUMN END-COLUMN BUCKET-ROWS
+    if (argc != 7)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    long long bucket_rows;
+    if (RedisModule_StringToLongLong(argv[6], &bucket_rows) != REDISMODULE_OK || bucket_rows <= 0)
+        return RedisModule_ReplyWithError(ctx, "Bucket rows must be a positive integer");
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long row_start, row_end, column_start, column_end;
+    int are_ranges_ok  = GridType_getRangeValues(ctx, o, argv + 2, &row_start, &row_end, &column_start, &column_end);
+    if (are_ranges_ok != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long buckets = (rows + bucket_rows - 1) / bucket_rows;
+    long long row_sign = row_start < row_end ? 1 : -1;
+
+    struct Aggregate *results = (struct Aggregate*)RedisModule_Alloc(sizeof(struct Aggregate) * (size_t)columns);
+
+    // Each bucket replies with the first, last, lowest and highest number in each column.
+    RedisModule_ReplyWithArray(ctx, (long)(buckets * columns * 4));
+    for (long long b = 0; b < buckets; ++b)
+    {
+        long long first = row_start + row_sign * b * bucket_rows;
+        long long last = first + row_sign * (min(bucket_rows, rows - b * bucket_rows) - 1);
+
+        for (long long c = 0; c < columns; ++c)
+            Aggregate_init(results + c);
+        GridType_aggregateObject(o, min(first, last), max(first, last), column_start, column_end, AGGREGATE_AXIS_COLUMNS, results);
+
+        for (long long c = 0; c < columns; ++c)
+            GridType_replyWithBucket(ctx, results + c, row_sign < 0);
+    }
+
+    RedisModule_Free(results);
+
+    return REDISMODULE_OK;
+}
+
+// Reads the SELECT START-COLUMN END-COLUMN which may follow the arguments of a row search.
+int GridType_getSelect(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int argi, long long columns, int *is_select, long long *column_start, long long *column_end)
+{
+    *is_select = argi < argc;
+    if (!*is_select)
+        return REDISMODULE_OK;
+
+    if (strcasecmp(RedisModule_StringPtrLen(argv[argi], NULL), "SELECT") != 0)
+    {
+        RedisModule_ReplyWithError(ctx, "Expected SELECT");
+        return REDISMODULE_ERR;
+    }
+    if (argc - argi != 3)
+    {
+        RedisModule_WrongArity(ctx);
+        return REDISMODULE_ERR;
+    }
+
+    if (GridType_getRangeValue(ctx, argv, argi + 1, columns, column_start, "Start column must be an integer", "Start column outside the bounds of the grid") != REDISMODULE_OK ||
+        GridType_getRangeValue(ctx, argv, argi + 2, columns, column_end, "End column must be an integer", "End column outside the bounds of the grid") != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    return REDISMODULE_OK;
+}
+
+// The number of replies for each row found, which is the row followed by the selected values.
+long long GridType_selectedReplies(int is_select, long long column_start, long long column_end)
+{
+    return is_select ? 2 + (max(column_start, column_end) - min(column_start, column_end)) : 1;
+}
+
+void GridType_replyWithRow(RedisModuleCtx *ctx, struct GridTypeObject *o, long long row, int is_select, long long column_start, long long column_end)
+{
+    RedisModule_ReplyWithLongLong(ctx, row);
+    if (is_select)
+        GridType_replyColumns(ctx, o, row, row, column_start, column_end, 1, 1);
+}
+
+// Reads the filters up to the end of the arguments or a SELECT, which is left at argi.
+int GridType_getFilters(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, int *argi, long long columns, struct Filter *filters, struct FilterValue *values, size_t *count)
+{
+    int is_or = 0;
+
+    for (*count = 0; ; )
+    {
+        if (argc - *argi < 3)
+        {
+            RedisModule_WrongArity(ctx);
+            return REDISMODULE_ERR;
+        }
+
+        long long column;
+        if (GridType_getRangeValue(ctx, argv, *argi, columns, &column, "Column must be an integer", "Column outside the bounds of the grid") != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+
+        struct Filter *filter = filters + *count;
+        filter->column = (size_t)column;
+        filter->is_or = is_or;
+        filter->op = Filter_parseOp(RedisModule_StringPtrLen(argv[*argi + 1], NULL));
+        if (filter->op == 0)
+        {
+            RedisModule_ReplyWithError(ctx, "Operator must be one of =, !=, <, <=, >, >=, IN or PREFIX");
+            return REDISMODULE_ERR;
+        }
+
+        // IN is followed by the number of values.
+        long long value_count = 1;
+        *argi += 2;
+        if (filter->op == FILTER_IN)
+        {
+            if (RedisModule_StringToLongLong(argv[*argi], &value_count) != REDISMODULE_OK || value_count <= 0)
+            {
+                RedisModule_ReplyWithError(ctx, "Count must be a positive integer");
+                return REDISMODULE_ERR;
+            }
+            if (value_count > argc - *argi - 1)
+            {
+                RedisModule_WrongArity(ctx);
+                return REDISMODULE_ERR;
+            }
+            ++*argi;
+        }
+
+        filter->values = values;
+        filter->count = (size_t)value_count;
+        for (long long i = 0; i < value_count; ++i, ++*argi, ++values)
+        {
+            size_t len;
+            const char *data = RedisModule_StringPtrLen(argv[*argi], &len);
+            Filter_initValue(values, data, len);
+        }
+
+        ++*count;
+        if (*argi == argc)
+            break;
+
+        const char *keyword = RedisModule_StringPtrLen(argv[*argi], NULL);
+        if (strcasecmp(keyword, "SELECT") == 0)
+            break;
+        if (strcasecmp(keyword, "AND") == 0)
+            is_or = 0;
+        else if (strcasecmp(keyword, "OR") == 0)
+            is_or = 1;
+        else
+        {
+            RedisModule_ReplyWithError(ctx, "Expected AND, OR or SELECT");
+            return REDISMODULE_ERR;
+        }
+        ++*argi;
+    }
+
+    return REDISMODULE_OK;
+}
+
+int GridType_WhereCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.WHERE KEY COLUMN OPERATOR VALUE [AND|OR COLUMN OPERATOR VALUE ...] [SELECT START-COLUMN END-COLUMN]
+    if (argc < 5)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    // There are never more filters or values than arguments.
+    struct Filter *filters = (struct Filter*)RedisModule_Alloc(sizeof(struct Filter) * (size_t)argc);
+    struct FilterValue *values = (struct FilterValue*)RedisModule_Alloc(sizeof(struct FilterValue) * (size_t)argc);
+
+    int argi = 2, is_select;
+    size_t count;
+    long long column_start, column_end;
+    int is_ok = GridType_getFilters(ctx, argv, argc, &argi, columns, filters, values, &count);
+    if (is_ok == REDISMODULE_OK)
+        is_ok = GridType_getSelect(ctx, argv, argc, argi, columns, &is_select, &column_start, &column_end);
+
+    if (is_ok != REDISMODULE_OK)
+    {
+        RedisModule_Free(filters);
+        RedisModule_Free(values);
+        return REDISMODULE_ERR;
+    }
+
+    uint64_t *matches = (uint64_t*)RedisModule_Alloc(sizeof(uint64_t) * max(Filter_words((size_t)rows), (size_t)1));
+    size_t total = GridType_whereObject(o, filters, count, (size_t)rows, matches);
+
+    RedisModule_Free(filters);
+    RedisModule_Free(values);
+
+    // Only the matching rows are replied, with their values when columns are selected.
+    RedisModule_ReplyWithArray(ctx, (long)(total * GridType_selectedReplies(is_select, column_start, column_end)));
+    for (size_t w = 0; w < Filter_words((size_t)rows); ++w)
+    {
+        for (uint64_t word = matches[w]; word; word &= word - 1)
+            GridType_replyWithRow(ctx, o, (long long)(w * 64 + (size_t)__builtin_ctzll(word)), is_select, column_start, column_end);
+    }
+
+    RedisModule_Free(matches);
+
+    return REDISMODULE_OK;
+}
+
+int GridType_IndexCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.INDEX CREATE KEY COLUMN HASH|SORTED
+    // GRID.INDEX DROP KEY COLUMN
+    if (argc < 4)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    const char *subcommand = RedisModule_StringPtrLen(argv[1], NULL);
+    int is_create = strcasecmp(subcommand, "CREATE") == 0;
+    if (!is_create && strcasecmp(subcommand, "DROP") != 0)
+        return RedisModule_ReplyWithError(ctx, "Expected CREATE or DROP");
+    if (argc != (is_create ? 5 : 4))
+        return RedisModule_WrongArity(ctx);
+
+    int index_type = 0;
+    if (is_create && (index_type = GridIndex_parseType(RedisModule_StringPtrLen(argv[4], NULL))) == 0)
+        return RedisModule_ReplyWithError(ctx, "Index must be HASH or SORTED");
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[2], REDISMODULE_READ|REDISMODULE_WRITE);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+        return RedisModule_ReplyWithError(ctx, "Empty key");
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+        return RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns, column;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getRangeValue(ctx, argv, 3, columns, &column, "Column must be an integer", "Column outside the bounds of the grid") != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    struct GridIndex **p = &o->indexes;
+    while (*p && (*p)->column != (size_t)column)
+        p = &(*p)->next;
+
+    // Dropping an index replies whether there was one to drop.
+    if (!is_create)
+    {
+        struct GridIndex *index = *p;
+        if (index)
+        {
+            *p = index->next;
+            GridIndex_release(index);
+        }
+        return RedisModule_ReplyWithLongLong(ctx, index != NULL);
+    }
+
+    if (*p)
+        return RedisModule_ReplyWithError(ctx, "Column is already indexed");
+
+    struct GridIndex *index = GridIndex_create((size_t)column, index_type);
+    if (!index || GridType_buildIndex(o, index) != REDISMODULE_OK)
+    {
+        if (index)
+            GridIndex_release(index);
+        return RedisModule_ReplyWithError(ctx, "Failed to build the index");
+    }
+    *p = index;
+
+    RedisModule_ReplyWithSimpleString(ctx, "OK");
+
+    return REDISMODULE_OK;
+}
+
+// Opens the grid and finds the index on the column of a lookup, rebuilding it when it is stale.
+struct GridTypeObject *GridType_getLookupIndex(RedisModuleCtx *ctx, RedisModuleString **argv, struct GridIndex **index)
+{
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ);
+    int type = RedisModule_KeyType(key);
+    if (type == REDISMODULE_KEYTYPE_EMPTY)
+    {
+        RedisModule_ReplyWithError(ctx, "Empty key");
+        return NULL;
+    }
+    if (type != REDISMODULE_KEYTYPE_MODULE || RedisModule_ModuleTypeGetType(key) != GridType)
+    {
+        RedisModule_ReplyWithError(ctx, REDISMODULE_ERRORMSG_WRONGTYPE);
+        return NULL;
+    }
+
+    struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
+
+    long long rows, columns, column;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getRangeValue(ctx, argv, 2, columns, &column, "Column must be an integer", "Column outside the bounds of the grid") != REDISMODULE_OK)
+        return NULL;
+
+    *index = GridType_findIndex(o, (size_t)column);
+    if (!*index)
+    {
+        RedisModule_ReplyWithError(ctx, "Column is not indexed");
+        return NULL;
+    }
+    if ((*index)->is_stale && GridType_buildIndex(o, *index) != REDISMODULE_OK)
+    {
+        RedisModule_ReplyWithError(ctx, "Failed to build the index");
+        return NULL;
+    }
+
+    return o;
+}
+
+void GridType_replyWithRows(RedisModuleCtx *ctx, struct GridTypeObject *o, size_t *rows, size_t count, int is_select, long long column_start, long long column_end)
+{
+    RedisModule_ReplyWithArray(ctx, (long)((long long)count * GridType_selectedReplies(is_select, column_start, column_end)));
+    for (size_t i = 0; i < count; ++i)
+        GridType_replyWithRow(ctx, o, (long long)rows[i], is_select, column_start, column_end);
+
+    if (rows)
+        RedisModule_Free(rows);
+}
+
+int GridType_LookupCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.LOOKUP KEY COLUMN VALUE [SELECT START-COLUMN END-COLUMN]
+    if (argc != 4 && argc != 7)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    struct GridIndex *index;
+    struct GridTypeObject *o = GridType_getLookupIndex(ctx, argv, &index);
+    if (!o)
+        return REDISMODULE_ERR;
+
+    long long rows, columns, column_start, column_end;
+    int is_select;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getSelect(ctx, argv, argc, 4, columns, &is_select, &column_start, &column_end) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t len;
+    const char *data = RedisModule_StringPtrLen(argv[3], &len);
+    size_t *found;
+    size_t count = GridIndex_lookup(index, data, len, &found);
+    GridType_replyWithRows(ctx, o, found, count, is_select, column_start, column_end);
+
+    return REDISMODULE_OK;
+}
+
+int GridType_LookupRangeCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+{
+    // GRID.LOOKUPRANGE KEY COLUMN MIN MAX [SELECT START-COLUMN END-COLUMN]
+    if (argc != 5 && argc != 8)
+        return RedisModule_WrongArity(ctx);
+
+    RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
+
+    struct GridIndex *index;
+    struct GridTypeObject *o = GridType_getLookupIndex(ctx, argv, &index);
+    if (!o)
+        return REDISMODULE_ERR;
+    if (index->type != GRID_INDEX_SORTED)
+        return RedisModule_ReplyWithError(ctx, "Column does not have a SORTED index");
 
-/* Commands */
+    long long rows, columns, column_start, column_end;
+    int is_select;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getSelect(ctx, argv, argc, 5, columns, &is_select, &column_start, &column_end) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
 
-int GridType_getRangeValues(RedisModuleCtx *ctx, struct GridTypeObject *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end)
-{
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
-        return ArrayGrid_getRangeValues(ctx, o->array_grid, argv, row_start, row_end, column_start, column_end);
-    else
-        return RowGrid_getRangeValues(ctx, o->row_grid, argv, row_start, row_end, column_start, column_end);
+    size_t min_len, max_len;
+    const char *min_data = RedisModule_StringPtrLen(argv[3], &min_len);
+    const char *max_data = RedisModule_StringPtrLen(argv[4], &max_len);
+    size_t *found;
+    size_t count = GridIndex_lookupRange(index, min_data, min_len, max_data, max_len, &found);
+    GridType_replyWithRows(ctx, o, found, count, is_select, column_start, column_end);
+
+    return REDISMODULE_OK;
 }
 
-int GridType_DimCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+int GridType_SortCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 {
-    // GRID.DIM KEY ROWS COLS [R0-C0, R0-C1,,, ... ]
+    // GRID.SORT KEY BY COLUMN [ASC|DESC] [NUMERIC|ALPHA] [STORE DESTINATION]
     if (argc < 4)
         return RedisModule_WrongArity(ctx);
 
-    long long rows;
-    if (RedisModule_StringToLongLong(argv[2], &rows) != REDISMODULE_OK)
-    {
-        return RedisModule_ReplyWithError(ctx, "WRONGTYPE Row should be an int");
-    }
-    if (rows < 0)
-    {
-        return RedisModule_ReplyWithError(ctx, "Rows must be gretaer than 0");
-    }
-    if ((unsigned long long)rows > SIZE_MAX)
+    int argi, is_descending = 0, mode = GRID_SORT_VALUE, store = 0;
+    for (argi = 4; argi < argc; ++argi)
     {
-        return RedisModule_ReplyWithError(ctx, "Rows to large");
+        const char *option = RedisModule_StringPtrLen(argv[argi], NULL);
+        if (strcasecmp(option, "ASC") == 0)
+            is_descending = 0;
+        else if (strcasecmp(option, "DESC") == 0)
+            is_descending = 1;
+        else if (strcasecmp(option, "NUMERIC") == 0)
+            mode = GRID_SORT_NUMERIC;
+        else if (strcasecmp(option, "ALPHA") == 0)
+            mode = GRID_SORT_ALPHA;
+        else if (strcasecmp(option, "STORE") == 0 && argi + 1 < argc)
+            store = ++argi;
+        else if (strcasecmp(option, "STORE") == 0)
+            return RedisModule_WrongArity(ctx);
+        else
+            return RedisModule_ReplyWithError(ctx, "Expected ASC, DESC, NUMERIC, ALPHA or STORE");
     }
 
-    long long columns;
-    if (RedisModule_StringToLongLong(argv[3], &columns) != REDISMODULE_OK)
-    {
-        return RedisModule_ReplyWithError(ctx, "WRONGTYPE Row should be an int");
-    }
-    if (columns < 0)
-    {
-        return RedisModule_ReplyWithError(ctx, "Columns must be grater than 0");
-    }
-    if ((unsigned long long)columns > SIZE_MAX)
+    // The destination is a key when the sort is stored.
+    if (RedisModule_IsKeysPositionRequest(ctx))
     {
-        return RedisModule_ReplyWithError(ctx, "Columns too large");
+        RedisModule_KeyAtPos(ctx, 1);
+        if (store)
+            RedisModule_KeyAtPos(ctx, store);
+        return REDISMODULE_OK;
     }
 
-    long long len = rows * columns;
-    if ((unsigned long long)len > SIZE_MAX)
-        return RedisModule_ReplyWithError(ctx, "Grid too large");
-    
-    if (argc > 4 && (argc - 4) != len)
-        return RedisModule_ReplyWithError(ctx, "ARGCOUNT Invalid number of values for grid");
-
-    RedisModuleKey *key = RedisModule_OpenKey(ctx, argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
-    int type = RedisModule_KeyType(key);
-    int status = GridType_reshapeObject(ctx, key, type, current_storage_type, (size_t)rows, (size_t)columns, argc - 4 > 0 ? argv + 4 : NULL);
-    RedisModule_CloseKey(key);
-
-    RedisModule_ReplyWithSimpleString(ctx, "OK");
-
-    return status;
-}
-
-int GridType_SetCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
-{
     RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
 
-    // GRID.SET KEY ROW-START ROW-END COLUMN-START COLUMN-END ROW0-COL0 ... ROWN-COLN
-    if (argc < 6)
-        return RedisModule_WrongArity(ctx);
+    if (strcasecmp(RedisModule_StringPtrLen(argv[2], NULL), "BY") != 0)
+        return RedisModule_ReplyWithError(ctx, "Expected BY");
 
-    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    // A grid stored onto itself is sorted in place.
+    if (store && RedisModule_StringCompare(argv[1], argv[store]) == 0)
+        store = 0;
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], store ? REDISMODULE_READ : REDISMODULE_READ|REDISMODULE_WRITE);
     int type = RedisModule_KeyType(key);
     if (type == REDISMODULE_KEYTYPE_EMPTY)
         return RedisModule_ReplyWithError(ctx, "Empty key");
@@ -219,37 +2808,49 @@ int GridType_SetCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 
     struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
 
-    long long row_start, row_end, column_start, column_end;
-    int are_ranges_ok  = GridType_getRangeValues(ctx, o, argv + 2, &row_start, &row_end, &column_start, &column_end);
-    if (are_ranges_ok != REDISMODULE_OK)
+    long long rows, columns, column;
+    GridType_getDimensions(o, &rows, &columns);
+    if (GridType_getRangeValue(ctx, argv, 3, columns, &column, "Column must be an integer", "Column outside the bounds of the grid") != REDISMODULE_OK)
         return REDISMODULE_ERR;
 
-    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
-    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
-    long long len = rows * columns;
-
-    if (len != argc - 6)
-        return RedisModule_ReplyWithError(ctx, "Invalid number of values");
+    if (!store)
+    {
+        if (GridType_sortObject(o, (size_t)column, mode, is_descending) != REDISMODULE_OK)
+            return RedisModule_ReplyWithError(ctx, "Failed to sort the grid");
+        return RedisModule_ReplyWithSimpleString(ctx, "OK");
+    }
 
-    if (GridType_setObject(o, row_start, row_end, column_start, column_end, argv + 6) != REDISMODULE_OK)
+    // Row storage shares its rows with the copy, so sorting the copy moves them without copying their cells.
+    struct GridTypeObject *copy = GridType_copyObject(o);
+    if (!copy)
+        return RedisModule_ReplyWithError(ctx, "Failed to copy the grid");
+    if (GridType_sortObject(copy, (size_t)column, mode, is_descending) != REDISMODULE_OK)
     {
-        return RedisModule_ReplyWithError(ctx, "Failed to set one or more items in the grid");
+        GridType_releaseObject(copy);
+        return RedisModule_ReplyWithError(ctx, "Failed to sort the grid");
     }
 
+    RedisModuleKey *destination = RedisModule_OpenKey(ctx, argv[store], REDISMODULE_READ|REDISMODULE_WRITE);
+    RedisModule_ModuleTypeSetValue(destination, GridType, copy);
+
     RedisModule_ReplyWithSimpleString(ctx, "OK");
 
     return REDISMODULE_OK;
 }
 
-int GridType_RangeCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
+int GridType_ChangesCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 {
-    // GRID.RANGE KEY START-ROW END-ROW SART-COLUMN END-COLUMN
-    if (argc < 6)
+    // GRID.CHANGES KEY SINCE-VERSION
+    if (argc != 3)
         return RedisModule_WrongArity(ctx);
 
     RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
 
-    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
+    long long since;
+    if (RedisModule_StringToLongLong(argv[2], &since) != REDISMODULE_OK)
+        return RedisModule_ReplyWithError(ctx, "Version must be an integer");
+
+    RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ);
     int type = RedisModule_KeyType(key);
     if (type == REDISMODULE_KEYTYPE_EMPTY)
         return RedisModule_ReplyWithError(ctx, "Empty key");
@@ -258,19 +2859,48 @@ int GridType_RangeCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int arg
 
     struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
 
-    long long row_start, row_end, column_start, column_end;
-    int are_ranges_ok  = GridType_getRangeValues(ctx, o, argv + 2, &row_start, &row_end, &column_start, &column_end);
-    if (are_ranges_ok != REDISMODULE_OK)
-        return REDISMODULE_ERR;
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    // The reply holds the version to read the next changes from, the shape of the grid, the
+    // number of rows dropped from the front of the grid, and the rectangles changed since.
+    size_t *bounds;
+    size_t count = GridChanges_since(o->changes, since > 0 ? (uint64_t)since : 0, (size_t)rows, (size_t)columns, &bounds);
+
+    RedisModule_ReplyWithArray(ctx, 5);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->changes->version);
+    RedisModule_ReplyWithLongLong(ctx, rows);
+    RedisModule_ReplyWithLongLong(ctx, columns);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->changes->dropped);
+    RedisModule_ReplyWithArray(ctx, (long)count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        RedisModule_ReplyWithArray(ctx, 4);
+        for (size_t j = 0; j < 4; ++j)
+            RedisModule_ReplyWithLongLong(ctx, (long long)bounds[i * 4 + j]);
+    }
 
-    GridType_rangeObject(ctx, o, row_start, row_end, column_start, column_end);
+    if (bounds)
+        RedisModule_Free(bounds);
 
     return REDISMODULE_OK;
 }
 
 int GridType_getShape(RedisModuleCtx *ctx, struct GridTypeObject* o)
 {
-    return ArrayGrid_getShape(ctx, o->array_grid);
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        return ArrayGrid_getShape(ctx, o->array_grid);
+    case STORAGE_TYPE_COLUMN:
+        return ColumnGrid_getShape(ctx, o->column_grid);
+    case STORAGE_TYPE_SPARSE:
+        return SparseGrid_getShape(ctx, o->sparse_grid);
+    case STORAGE_TYPE_TILE:
+        return TileGrid_getShape(ctx, o->tile_grid);
+    default:
+        return RowGrid_getShape(ctx, o->row_grid);
+    }
 }
 
 int GridType_ShapeCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
@@ -295,12 +2925,16 @@ int GridType_ShapeCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int arg
 
 int GridType_DumpCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 {
-    // GRID.DUMP KEY
-    if (argc != 2)
+    // GRID.DUMP KEY [ORDER ROWS|COLUMNS]
+    if (argc != 2 && argc != 4)
         return RedisModule_WrongArity(ctx);
 
     RedisModule_AutoMemory(ctx); /* Use automatic memory management. */
 
+    int order;
+    if (GridType_getOrder(ctx, argv, argc, 2, &order) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
     RedisModuleKey *key = RedisModule_OpenKey(ctx,argv[1], REDISMODULE_READ|REDISMODULE_WRITE);
     int type = RedisModule_KeyType(key);
     if (type == REDISMODULE_KEYTYPE_EMPTY)
@@ -310,7 +2944,12 @@ int GridType_DumpCommand(RedisModuleCtx *ctx, RedisModuleString **argv, int argc
 
     struct GridTypeObject *o = RedisModule_ModuleTypeGetValue(key);
 
-    return GridType_dump(ctx, o);
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+    if (rows > 0 && columns > 0 && GridType_replyInBackground(ctx, o, 0, rows - 1, 0, columns - 1, 1, order) == REDISMODULE_OK)
+        return REDISMODULE_OK;
+
+    return GridType_dump(ctx, o, order);
 }
 
 /* Type Methods */
@@ -320,58 +2959,352 @@ void GridType_Free(void *value)
     GridType_releaseObject((struct GridTypeObject*)value);
 }
 
+// Version 0 saved every cell on its own, and did not record the storage type.
+struct GridTypeObject *GridType_rdbLoadCells(RedisModuleIO *rdb)
+{
+    struct GridTypeObject *o = (struct GridTypeObject*) RedisModule_Alloc(sizeof(struct GridTypeObject));
+    o->storage_type = current_storage_type;
+    o->capped_rows = 0;
+    o->indexes = NULL;
+
+    void *grid;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        grid = o->array_grid = ArrayGrid_rdbLoad(rdb);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        grid = o->column_grid = ColumnGrid_rdbLoad(rdb);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        grid = o->sparse_grid = SparseGrid_rdbLoad(rdb);
+        break;
+    case STORAGE_TYPE_TILE:
+        grid = o->tile_grid = TileGrid_rdbLoad(rdb);
+        break;
+    default:
+        grid = o->row_grid = RowGrid_rdbLoad(rdb);
+        break;
+    }
+    if (!grid)
+    {
+        RedisModule_LogIOError(rdb, "warning", "Failed to load a grid");
+        RedisModule_Free(o);
+        return NULL;
+    }
+
+    // The changes are tracked from the load, as they are for a created grid.
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+    o->changes = GridChanges_create((size_t)rows, (size_t)columns);
+    if (!o->changes)
+    {
+        RedisModule_LogIOError(rdb, "warning", "Failed to allocate a grid");
+        GridType_releaseObject(o);
+        return NULL;
+    }
+
+    return o;
+}
+
+
+void GridType_rdbSaveBand(RedisModuleIO *rdb, const char *blob, size_t len)
+{
+    // A band is only compressed when that makes it smaller.
+    char *compressed = rdb_compression ? (char*)RedisModule_Alloc(len) : NULL;
+    size_t compressed_len = compressed ? Compress_compress(blob, len, compressed, len) : 0;
+
+    if (compressed_len > 0)
+    {
+        RedisModule_SaveUnsigned(rdb, GRID_RDB_BAND_COMPRESSED);
+        RedisModule_SaveUnsigned(rdb, (uint64_t)len);
+        RedisModule_SaveStringBuffer(rdb, compressed, compressed_len);
+    }
+    else
+    {
+        RedisModule_SaveUnsigned(rdb, GRID_RDB_BAND_RAW);
+        RedisModule_SaveUnsigned(rdb, (uint64_t)len);
+        RedisModule_SaveStringBuffer(rdb, blob, len);
+    }
+
+    if (compressed)
+        RedisModule_Free(compressed);
+}
+
 void GridType_RdbSave(RedisModuleIO *rdb, void *value) 
 {
     struct GridTypeObject *o = value;
 
-    if (o->storage_type == STORAGE_TYPE_ARRAY)
-        ArrayGrid_rdbSave(rdb, o->array_grid);
-    else
-        RowGrid_rdbSave(rdb, o->row_grid);
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    RedisModule_SaveUnsigned(rdb, (uint64_t)o->storage_type);
+    RedisModule_SaveUnsigned(rdb, (uint64_t)rows);
+    RedisModule_SaveUnsigned(rdb, (uint64_t)columns);
+    RedisModule_SaveUnsigned(rdb, (uint64_t)o->capped_rows);
+
+    // Only the columns and types of the indexes are saved, as they are rebuilt from the cells.
+    uint64_t index_count = 0;
+    for (const struct GridIndex *index = o->indexes; index; index = index->next)
+        ++index_count;
+    RedisModule_SaveUnsigned(rdb, index_count);
+    for (const struct GridIndex *index = o->indexes; index; index = index->next)
+    {
+        RedisModule_SaveUnsigned(rdb, (uint64_t)index->column);
+        RedisModule_SaveUnsigned(rdb, (uint64_t)index->type);
+    }
+
+    if (columns == 0)
+        return;
+
+    long long band_rows = max(GRID_RDB_BAND_CELLS / columns, 1LL);
+    for (long long row = 0; row < rows; )
+    {
+        long long row_end = min(row + band_rows, rows) - 1;
+
+        size_t len;
+        char *blob = GridType_snapshotObject(o, row, row_end, 0, columns - 1, &len);
+        if (!blob)
+        {
+            // Only a band with over 4GB of text in a column fails, and a single row never does.
+            band_rows = max(band_rows / 2, 1LL);
+            continue;
+        }
+
+        GridType_rdbSaveBand(rdb, blob, len);
+        RedisModule_Free(blob);
+
+        row = row_end + 1;
+    }
+}
+
+char *GridType_rdbLoadBand(RedisModuleIO *rdb, size_t *len)
+{
+    uint64_t encoding = RedisModule_LoadUnsigned(rdb);
+    size_t raw_len = (size_t)RedisModule_LoadUnsigned(rdb);
+
+    size_t data_len;
+    char *data = RedisModule_LoadStringBuffer(rdb, &data_len);
+
+    if (encoding == GRID_RDB_BAND_RAW && data_len == raw_len)
+    {
+        *len = raw_len;
+        return data;
+    }
+
+    char *blob = NULL;
+    if (encoding == GRID_RDB_BAND_COMPRESSED)
+    {
+        blob = (char*)RedisModule_Alloc(raw_len);
+        if (blob && Compress_decompress(data, data_len, blob, raw_len) != REDISMODULE_OK)
+        {
+            RedisModule_Free(blob);
+            blob = NULL;
+        }
+    }
+
+    RedisModule_Free(data);
+    *len = raw_len;
+    return blob;
+}
+
+struct GridTypeObject *GridType_rdbLoadBands(RedisModuleIO *rdb, int encver)
+{
+    unsigned char storage_type = (unsigned char)RedisModule_LoadUnsigned(rdb);
+    size_t rows = (size_t)RedisModule_LoadUnsigned(rdb);
+    size_t columns = (size_t)RedisModule_LoadUnsigned(rdb);
+    size_t capped_rows = encver >= 2 ? (size_t)RedisModule_LoadUnsigned(rdb) : 0;
+
+    struct GridIndex *indexes = NULL, **tail = &indexes;
+    size_t index_count = encver >= 3 ? (size_t)RedisModule_LoadUnsigned(rdb) : 0;
+    for (size_t i = 0; i < index_count; ++i)
+    {
+        size_t column = (size_t)RedisModule_LoadUnsigned(rdb);
+        int type = (int)RedisModule_LoadUnsigned(rdb);
+        if (column < columns && (type == GRID_INDEX_HASH || type == GRID_INDEX_SORTED) && (*tail = GridIndex_create(column, type)) != NULL)
+            tail = &(*tail)->next;
+    }
+
+    switch (storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+    case STORAGE_TYPE_ROW:
+    case STORAGE_TYPE_COLUMN:
+    case STORAGE_TYPE_SPARSE:
+    case STORAGE_TYPE_TILE:
+        break;
+    default:
+        storage_type = current_storage_type;
+        break;
+    }
+
+    // The grid is rebuilt in the storage type it was saved from, a band of rows at a time.
+    struct GridTypeObject *o = GridType_createObject(storage_type, rows, columns, NULL);
+    if (!o)
+    {
+        RedisModule_LogIOError(rdb, "warning", "Failed to allocate a grid");
+        for (struct GridIndex *index = indexes, *next; index; index = next)
+        {
+            next = index->next;
+            GridIndex_release(index);
+        }
+        return NULL;
+    }
+    o->capped_rows = capped_rows;
+
+    for (size_t row = 0; row < rows && columns > 0; )
+    {
+        size_t len;
+        char *blob = GridType_rdbLoadBand(rdb, &len);
+
+        struct BlobReader reader;
+        int is_valid = blob &&
+            Blob_open(&reader, blob, len) == REDISMODULE_OK &&
+            reader.columns == columns &&
+            reader.rows > 0 &&
+            reader.rows <= rows - row &&
+            GridType_setBlobObject(o, (long long)row, (long long)(row + reader.rows - 1), 0, (long long)columns - 1, &reader) == REDISMODULE_OK;
+
+        if (blob)
+            RedisModule_Free(blob);
+
+        if (!is_valid)
+        {
+            RedisModule_LogIOError(rdb, "warning", "Invalid band of rows in a grid");
+            o->indexes = indexes;
+            GridType_releaseObject(o);
+            return NULL;
+        }
+
+        row += reader.rows;
+    }
+
+    // The indexes are built in one pass over their columns once every cell is loaded.
+    o->indexes = indexes;
+    for (struct GridIndex *index = o->indexes; index; index = index->next)
+        GridType_buildIndex(o, index);
+
+    return o;
 }
 
 void *GridType_RdbLoad(RedisModuleIO *rdb, int encver) 
 {
-    if (encver != 0)
+    switch (encver)
     {
+    case 0:
+        return GridType_rdbLoadCells(rdb);
+    case 1:
+    case 2:
+    case GRID_ENCODING_VERSION:
+        return GridType_rdbLoadBands(rdb, encver);
+    default:
         /* RedisModule_Log("warning","Can't load data with version %d", encver);*/
         return NULL;
     }
+}
 
-    struct GridTypeObject *o = (struct GridTypeObject*) RedisModule_Alloc(sizeof(struct GridTypeObject));
-    o->storage_type = current_storage_type;
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
-        o->array_grid = ArrayGrid_rdbLoad(rdb);
-    else
-        o->row_grid = RowGrid_rdbLoad(rdb);
-    return o;
+void GridType_aofRewriteIndexes(RedisModuleIO *aof, RedisModuleString *key, struct GridTypeObject *o)
+{
+    for (const struct GridIndex *index = o->indexes; index; index = index->next)
+        RedisModule_EmitAOF(aof, "GRID.INDEX", "cslc", "CREATE", key, (long long)index->column, GridIndex_typeName(index->type));
 }
 
 void GridType_AofRewrite(RedisModuleIO *aof, RedisModuleString *key, void *value) 
 {
     struct GridTypeObject *o = value;
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
+
+    long long rows, columns;
+    GridType_getDimensions(o, &rows, &columns);
+
+    // A grid with a cap or its own storage type is first created empty with them, where the options
+    // can not be read as values, and is then dimensioned again as it is rebuilt.
+    if (o->capped_rows > 0 || o->storage_type != current_storage_type)
+    {
+        if (o->capped_rows > 0)
+            RedisModule_EmitAOF(aof, "GRID.DIM", "sllclcc", key, 0LL, columns, "CAPPED", (long long)o->capped_rows, "STORAGE", GridType_storageTypeName(o->storage_type));
+        else
+            RedisModule_EmitAOF(aof, "GRID.DIM", "sllcc", key, 0LL, columns, "STORAGE", GridType_storageTypeName(o->storage_type));
+
+        // Dimensioning an existing grid to no rows deletes it, so an empty grid is left as created.
+        if (rows == 0)
+        {
+            GridType_aofRewriteIndexes(aof, key, o);
+            return;
+        }
+    }
+
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
         ArrayGrid_aofRewrite(aof, key, o->array_grid);
-    else
+        break;
+    case STORAGE_TYPE_COLUMN:
+        ColumnGrid_aofRewrite(aof, key, o->column_grid);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        SparseGrid_aofRewrite(aof, key, o->sparse_grid);
+        break;
+    case STORAGE_TYPE_TILE:
+        TileGrid_aofRewrite(aof, key, o->tile_grid);
+        break;
+    default:
         RowGrid_aofRewrite(aof, key, o->row_grid);
+        break;
+    }
+
+    GridType_aofRewriteIndexes(aof, key, o);
 }
 
 size_t GridType_MemUsage(const void *value) 
 {
     const struct GridTypeObject *o = value;
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
-        return ArrayGrid_memUsage(o->array_grid);
-    else
-        return RowGrid_memUsage(o->row_grid);
+    size_t size;
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
+        size = ArrayGrid_memUsage(o->array_grid);
+        break;
+    case STORAGE_TYPE_COLUMN:
+        size = ColumnGrid_memUsage(o->column_grid);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        size = SparseGrid_memUsage(o->sparse_grid);
+        break;
+    case STORAGE_TYPE_TILE:
+        size = TileGrid_memUsage(o->tile_grid);
+        break;
+    default:
+        size = RowGrid_memUsage(o->row_grid);
+        break;
+    }
+
+    for (const struct GridIndex *index = o->indexes; index; index = index->next)
+        size += GridIndex_memUsage(index);
+    size += GridChanges_memUsage(o->changes);
+    return size;
 }
 
 void GridType_Digest(RedisModuleDigest *md, void *value) 
 {
     struct GridTypeObject *o = value;
-    if (o->storage_type & STORAGE_TYPE_ARRAY)
+    switch (o->storage_type)
+    {
+    case STORAGE_TYPE_ARRAY:
         ArrayGrid_digest(md, o->array_grid);
-    else
+        break;
+    case STORAGE_TYPE_COLUMN:
+        ColumnGrid_digest(md, o->column_grid);
+        break;
+    case STORAGE_TYPE_SPARSE:
+        SparseGrid_digest(md, o->sparse_grid);
+        break;
+    case STORAGE_TYPE_TILE:
+        TileGrid_digest(md, o->tile_grid);
+        break;
+    default:
         RowGrid_digest(md, o->row_grid);
+        break;
+    }
 }
 
 /* Initialisation */
@@ -387,6 +3320,21 @@ unsigned char GridType_getStorageType(RedisModuleCtx *ctx,RedisModuleString **ar
             RedisModule_Log(ctx, "notice", "Setting storage to ARRAY");
             return STORAGE_TYPE_ARRAY;
         }
+        if (len != 0 && strcmp("STORAGE=COLUMNAR", s) == 0)
+        {
+            RedisModule_Log(ctx, "notice", "Setting storage to COLUMNAR");
+            return STORAGE_TYPE_COLUMN;
+        }
+        if (len != 0 && strcmp("STORAGE=SPARSE", s) == 0)
+        {
+            RedisModule_Log(ctx, "notice", "Setting storage to SPARSE");
+            return STORAGE_TYPE_SPARSE;
+        }
+        if (len != 0 && strcmp("STORAGE=TILE", s) == 0)
+        {
+            RedisModule_Log(ctx, "notice", "Setting storage to TILE");
+            return STORAGE_TYPE_TILE;
+        }
     }
 
     RedisModule_Log(ctx, "notice", "Setting storage to ROW");
@@ -394,6 +3342,29 @@ unsigned char GridType_getStorageType(RedisModuleCtx *ctx,RedisModuleString **ar
     return STORAGE_TYPE_ROW;
 }
 
+long long GridType_getNumericOption(RedisModuleCtx *ctx, RedisModuleString **argv, int argc, const char *name, long long default_value)
+{
+    size_t name_len = strlen(name);
+    for (RedisModuleString**p = argv, **end = argv + argc; p < end; ++p)
+    {
+        size_t len;
+        const char* s = RedisModule_StringPtrLen(*p, &len);
+        if (len > name_len + 1 && strncmp(name, s, name_len) == 0 && s[name_len] == '=')
+        {
+            char *endptr;
+            long long value = strtoll(s + name_len + 1, &endptr, 10);
+            if (*endptr == '\0' && value >= 0)
+            {
+                RedisModule_Log(ctx, "notice", "Setting %s to %lld", name, value);
+                return value;
+            }
+            RedisModule_Log(ctx, "warning", "Ignoring invalid option %s", s);
+        }
+    }
+
+    return default_value;
+}
+
 int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 {
     if (RedisModule_Init(ctx, "GRID", 1, REDISMODULE_APIVER_1) == REDISMODULE_ERR)
@@ -401,6 +3372,14 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
 
     current_storage_type = GridType_getStorageType(ctx, argv, argc);
 
+    // Reads of at least the threshold number of cells are replied to from the worker threads.
+    worker_threshold = GridType_getNumericOption(ctx, argv, argc, "WORKER_THRESHOLD", WORKER_DEFAULT_THRESHOLD);
+    long long workers = GridType_getNumericOption(ctx, argv, argc, "WORKERS", WORKER_DEFAULT_THREADS);
+    rdb_compression = GridType_getNumericOption(ctx, argv, argc, "RDB_COMPRESSION", 1) != 0;
+    ColumnGrid_setDictionaryEncoding(GridType_getNumericOption(ctx, argv, argc, "DICTIONARY", 1) != 0);
+    if (workers > 0 && Worker_start((size_t)workers) != REDISMODULE_OK)
+        RedisModule_Log(ctx, "warning", "Failed to start the worker threads; large reads will block");
+
     RedisModuleTypeMethods tm = {
         .version = REDISMODULE_TYPE_METHOD_VERSION,
         .rdb_load = GridType_RdbLoad,
@@ -411,7 +3390,7 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
         .digest = GridType_Digest
     };
 
-    GridType = RedisModule_CreateDataType(ctx, "GRID-RTB_", 0, &tm);
+    GridType = RedisModule_CreateDataType(ctx, "GRID-RTB_", GRID_ENCODING_VERSION, &tm);
     if (GridType == NULL)
         return REDISMODULE_ERR;
 
@@ -421,9 +3400,69 @@ int RedisModule_OnLoad(RedisModuleCtx *ctx, RedisModuleString **argv, int argc)
     if (RedisModule_CreateCommand(ctx, "GRID.SET", GridType_SetCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
+    if (RedisModule_CreateCommand(ctx, "GRID.MSET", GridType_MSetCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.APPENDROWS", GridType_AppendRowsCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.PUSHROW", GridType_PushRowCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.INSERTROWS", GridType_InsertRowsCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.DELETEROWS", GridType_DeleteRowsCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.INSERTCOLS", GridType_InsertColumnsCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.DELETECOLS", GridType_DeleteColumnsCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.LOADBLOB", GridType_LoadBlobCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.SETBLOB", GridType_SetBlobCommand, "write deny-oom", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.COPY", GridType_CopyCommand, "write deny-oom", 1, 2, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
     if (RedisModule_CreateCommand(ctx, "GRID.RANGE", GridType_RangeCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
+    if (RedisModule_CreateCommand(ctx, "GRID.MRANGE", GridType_MRangeCommand, "readonly", 1, -1, 5) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.RANGEBLOB", GridType_RangeBlobCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.AGG", GridType_AggCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.DOWNSAMPLE", GridType_DownsampleCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.WHERE", GridType_WhereCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.INDEX", GridType_IndexCommand, "write deny-oom", 2, 2, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.LOOKUP", GridType_LookupCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.LOOKUPRANGE", GridType_LookupRangeCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.SORT", GridType_SortCommand, "write deny-oom getkeys-api", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
+    if (RedisModule_CreateCommand(ctx, "GRID.CHANGES", GridType_ChangesCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
+        return REDISMODULE_ERR;
+
     if (RedisModule_CreateCommand(ctx, "GRID.SHAPE", GridType_ShapeCommand, "readonly", 1, 1, 1) == REDISMODULE_ERR)
         return REDISMODULE_ERR;
 
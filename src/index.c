@@ -0,0 +1,567 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "utils.h"
+#include "index.h"
+
+// Marks an empty slot in the rows of a hash index key.
+#define GRID_INDEX_NO_ROW SIZE_MAX
+
+// The value of a cell, as it is compared with the nodes.
+struct GridIndexKey {
+    const char *data;
+    size_t len;
+    int is_number;
+    double number;
+    uint32_t hash;
+};
+
+static inline const char *GridIndex_nodeData(const struct GridIndexNode *node)
+{
+    return (const char*)(node->next + node->level);
+}
+
+static inline size_t GridIndex_nodeSize(const struct GridIndexNode *node)
+{
+    return sizeof(struct GridIndexNode) + sizeof(struct GridIndexNode*) * node->level + node->len;
+}
+
+static void GridIndex_initKey(struct GridIndexKey *key, const char *data, size_t len)
+{
+    key->data = data;
+    key->len = len;
+    key->is_number = GridType_parseDouble(data, len, &key->number) == REDISMODULE_OK;
+
+    if (key->is_number)
+    {
+        // Negative zero is the same key as zero.
+        if (key->number == 0)
+            key->number = 0;
+        uint64_t bits;
+        memcpy(&bits, &key->number, sizeof(bits));
+        bits ^= bits >> 33;
+        bits *= 0xff51afd7ed558ccdULL;
+        bits ^= bits >> 33;
+        key->hash = (uint32_t)bits;
+    }
+    else
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < len; ++i)
+        {
+            hash ^= (unsigned char)data[i];
+            hash *= 16777619u;
+        }
+        key->hash = hash;
+    }
+}
+
+static int GridIndex_compare(const struct GridIndexKey *key, const struct GridIndexNode *node)
+{
+    if (key->is_number != node->is_number)
+        return key->is_number ? -1 : 1;
+    if (key->is_number)
+        return key->number < node->number ? -1 : key->number > node->number;
+
+    int cmp = memcmp(key->data, GridIndex_nodeData(node), min(key->len, (size_t)node->len));
+    if (cmp != 0)
+        return cmp;
+    return key->len < node->len ? -1 : key->len > node->len;
+}
+
+// Nodes with the same key are ordered by their row.
+static int GridIndex_compareRow(const struct GridIndexKey *key, size_t row, const struct GridIndexNode *node)
+{
+    int cmp = GridIndex_compare(key, node);
+    if (cmp != 0)
+        return cmp;
+    return row < node->row ? -1 : row > node->row;
+}
+
+static struct GridIndexNode *GridIndex_createNode(struct GridIndex *index, const struct GridIndexKey *key, size_t row, int level)
+{
+    // Numbers are compared by their value, so their text is not kept.
+    size_t len = key->is_number ? 0 : key->len;
+    struct GridIndexNode *node = (struct GridIndexNode*)RedisModule_Alloc(sizeof(struct GridIndexNode) + sizeof(struct GridIndexNode*) * level + len);
+    if (!node)
+        return NULL;
+
+    node->row = row;
+    node->number = key->is_number ? key->number : 0;
+    node->hash = key->hash;
+    node->len = (uint32_t)len;
+    node->is_number = (unsigned char)key->is_number;
+    node->level = (unsigned char)level;
+    memcpy((char*)GridIndex_nodeData(node), key->data, len);
+
+    index->bytes += GridIndex_nodeSize(node);
+    ++index->count;
+    return node;
+}
+
+static void GridIndex_freeNode(struct GridIndex *index, struct GridIndexNode *node)
+{
+    index->bytes -= GridIndex_nodeSize(node);
+    --index->count;
+    RedisModule_Free(node);
+}
+
+static inline size_t GridIndex_rowsSize(size_t capacity)
+{
+    return sizeof(struct GridIndexRows) + sizeof(size_t) * capacity;
+}
+
+static inline size_t GridIndex_rowSlot(size_t row, size_t mask)
+{
+    return (size_t)(((uint64_t)row * 0x9e3779b97f4a7c15ULL) >> 32) & mask;
+}
+
+static struct GridIndexRows *GridIndex_allocRows(size_t capacity)
+{
+    struct GridIndexRows *rows = (struct GridIndexRows*)RedisModule_Alloc(GridIndex_rowsSize(capacity));
+    if (!rows)
+        return NULL;
+
+    rows->count = 0;
+    rows->mask = capacity - 1;
+    for (size_t i = 0; i < capacity; ++i)
+        rows->rows[i] = GRID_INDEX_NO_ROW;
+    return rows;
+}
+
+// The set must have room for the row, which is not already in it.
+static void GridIndex_insertRow(struct GridIndexRows *rows, size_t row)
+{
+    size_t i = GridIndex_rowSlot(row, rows->mask);
+    while (rows->rows[i] != GRID_INDEX_NO_ROW)
+        i = (i + 1) & rows->mask;
+    rows->rows[i] = row;
+    ++rows->count;
+}
+
+// Adds a row to the rows of a key, doubling them once they are three quarters full.
+static int GridIndex_addRow(struct GridIndex *index, struct GridIndexNode *node, size_t row)
+{
+    struct GridIndexRows *rows = node->rows;
+    size_t capacity = rows->mask + 1;
+    if (rows->count + 1 > capacity - capacity / 4)
+    {
+        struct GridIndexRows *grown = GridIndex_allocRows(capacity * 2);
+        if (!grown)
+            return REDISMODULE_ERR;
+
+        for (size_t i = 0; i < capacity; ++i)
+        {
+            if (rows->rows[i] != GRID_INDEX_NO_ROW)
+                GridIndex_insertRow(grown, rows->rows[i]);
+        }
+
+        index->bytes += GridIndex_rowsSize(capacity * 2) - GridIndex_rowsSize(capacity);
+        RedisModule_Free(rows);
+        node->rows = rows = grown;
+    }
+
+    GridIndex_insertRow(rows, row);
+    return REDISMODULE_OK;
+}
+
+// Removes a row from the rows of a key, moving back the rows probed past it so none is cut off
+// from its slot. Returns 0 when the key does not hold the row.
+static int GridIndex_removeRow(struct GridIndexRows *rows, size_t row)
+{
+    size_t i = GridIndex_rowSlot(row, rows->mask);
+    for (size_t probes = 0; rows->rows[i] != row; i = (i + 1) & rows->mask)
+    {
+        if (rows->rows[i] == GRID_INDEX_NO_ROW || ++probes > rows->mask)
+            return 0;
+    }
+
+    rows->rows[i] = GRID_INDEX_NO_ROW;
+    for (size_t j = (i + 1) & rows->mask; rows->rows[j] != GRID_INDEX_NO_ROW; j = (j + 1) & rows->mask)
+    {
+        size_t slot = GridIndex_rowSlot(rows->rows[j], rows->mask);
+        if (((j - slot) & rows->mask) >= ((j - i) & rows->mask))
+        {
+            rows->rows[i] = rows->rows[j];
+            rows->rows[j] = GRID_INDEX_NO_ROW;
+            i = j;
+        }
+    }
+
+    --rows->count;
+    return 1;
+}
+
+// Returns the link to the node of the key in a hash index, which is NULL when there is none.
+static struct GridIndexNode **GridIndex_findKey(const struct GridIndex *index, const struct GridIndexKey *key)
+{
+    struct GridIndexNode **p = index->buckets + (key->hash & index->bucket_mask);
+    while (*p && ((*p)->hash != key->hash || GridIndex_compare(key, *p) != 0))
+        p = &(*p)->next[0];
+    return p;
+}
+
+int GridIndex_parseType(const char *name)
+{
+    if (strcasecmp(name, "HASH") == 0)
+        return GRID_INDEX_HASH;
+    if (strcasecmp(name, "SORTED") == 0)
+        return GRID_INDEX_SORTED;
+    return 0;
+}
+
+const char *GridIndex_typeName(int type)
+{
+    return type == GRID_INDEX_HASH ? "HASH" : "SORTED";
+}
+
+static int GridIndex_init(struct GridIndex *index)
+{
+    index->offset = 0;
+    index->count = 0;
+    index->bytes = 0;
+    index->level = 1;
+
+    if (index->type == GRID_INDEX_HASH)
+    {
+        index->buckets = (struct GridIndexNode**)RedisModule_Calloc(GRID_INDEX_MIN_BUCKETS, sizeof(struct GridIndexNode*));
+        index->bucket_mask = GRID_INDEX_MIN_BUCKETS - 1;
+        return index->buckets ? REDISMODULE_OK : REDISMODULE_ERR;
+    }
+
+    index->head = (struct GridIndexNode*)RedisModule_Calloc(1, sizeof(struct GridIndexNode) + sizeof(struct GridIndexNode*) * GRID_INDEX_MAX_LEVEL);
+    if (!index->head)
+        return REDISMODULE_ERR;
+    index->head->level = GRID_INDEX_MAX_LEVEL;
+    return REDISMODULE_OK;
+}
+
+static void GridIndex_freeNodes(struct GridIndex *index)
+{
+    if (index->type == GRID_INDEX_HASH)
+    {
+        for (size_t b = 0; b <= index->bucket_mask; ++b)
+        {
+            for (struct GridIndexNode *node = index->buckets[b], *next; node; node = next)
+            {
+                next = node->next[0];
+                RedisModule_Free(node->rows);
+                RedisModule_Free(node);
+            }
+        }
+        RedisModule_Free(index->buckets);
+        index->buckets = NULL;
+    }
+    else
+    {
+        for (struct GridIndexNode *node = index->head->next[0], *next; node; node = next)
+        {
+            next = node->next[0];
+            RedisModule_Free(node);
+        }
+        RedisModule_Free(index->head);
+        index->head = NULL;
+    }
+}
+
+struct GridIndex *GridIndex_create(size_t column, int type)
+{
+    struct GridIndex *index = (struct GridIndex*)RedisModule_Calloc(1, sizeof(struct GridIndex));
+    if (!index)
+        return NULL;
+
+    index->column = column;
+    index->type = type;
+    index->seed = 0x9e3779b97f4a7c15ULL ^ column;
+    if (GridIndex_init(index) != REDISMODULE_OK)
+    {
+        RedisModule_Free(index);
+        return NULL;
+    }
+
+    return index;
+}
+
+void GridIndex_release(struct GridIndex *index)
+{
+    GridIndex_freeNodes(index);
+    RedisModule_Free(index);
+}
+
+void GridIndex_clear(struct GridIndex *index)
+{
+    GridIndex_freeNodes(index);
+    GridIndex_init(index);
+}
+
+static int GridIndex_rehash(struct GridIndex *index, size_t bucket_count)
+{
+    struct GridIndexNode **buckets = (struct GridIndexNode**)RedisModule_Calloc(bucket_count, sizeof(struct GridIndexNode*));
+    if (!buckets)
+        return REDISMODULE_ERR;
+
+    for (size_t b = 0; b <= index->bucket_mask; ++b)
+    {
+        for (struct GridIndexNode *node = index->buckets[b], *next; node; node = next)
+        {
+            next = node->next[0];
+            struct GridIndexNode **bucket = buckets + (node->hash & (bucket_count - 1));
+            node->next[0] = *bucket;
+            *bucket = node;
+        }
+    }
+
+    RedisModule_Free(index->buckets);
+    index->buckets = buckets;
+    index->bucket_mask = bucket_count - 1;
+    return REDISMODULE_OK;
+}
+
+// Each level holds about a quarter of the nodes of the level below it.
+static int GridIndex_randomLevel(struct GridIndex *index)
+{
+    uint64_t x = index->seed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    index->seed = x;
+
+    int level = 1;
+    while (level < GRID_INDEX_MAX_LEVEL && (x & 3) == 0)
+    {
+        ++level;
+        x >>= 2;
+    }
+    return level;
+}
+
+// Finds the last node before the key and row at each level.
+static void GridIndex_findUpdates(const struct GridIndex *index, const struct GridIndexKey *key, size_t row, struct GridIndexNode **update)
+{
+    struct GridIndexNode *x = index->head;
+    for (int i = index->level - 1; i >= 0; --i)
+    {
+        while (x->next[i] && GridIndex_compareRow(key, row, x->next[i]) > 0)
+            x = x->next[i];
+        update[i] = x;
+    }
+}
+
+int GridIndex_add(struct GridIndex *index, const char *data, size_t len, size_t row)
+{
+    struct GridIndexKey key;
+    GridIndex_initKey(&key, data, len);
+    row += index->offset;
+
+    if (index->type == GRID_INDEX_HASH)
+    {
+        struct GridIndexNode *node = *GridIndex_findKey(index, &key);
+        if (node)
+            return GridIndex_addRow(index, node, row);
+
+        // The buckets grow with the number of keys, however many rows hold them.
+        if (index->count > index->bucket_mask && GridIndex_rehash(index, (index->bucket_mask + 1) * 2) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+
+        struct GridIndexRows *rows = GridIndex_allocRows(1);
+        if (!rows)
+            return REDISMODULE_ERR;
+        node = GridIndex_createNode(index, &key, 0, 1);
+        if (!node)
+        {
+            RedisModule_Free(rows);
+            return REDISMODULE_ERR;
+        }
+
+        GridIndex_insertRow(rows, row);
+        node->rows = rows;
+        index->bytes += GridIndex_rowsSize(1);
+
+        struct GridIndexNode **bucket = index->buckets + (key.hash & index->bucket_mask);
+        node->next[0] = *bucket;
+        *bucket = node;
+        return REDISMODULE_OK;
+    }
+
+    struct GridIndexNode *update[GRID_INDEX_MAX_LEVEL];
+    GridIndex_findUpdates(index, &key, row, update);
+
+    int level = GridIndex_randomLevel(index);
+    for (int i = index->level; i < level; ++i)
+        update[i] = index->head;
+
+    struct GridIndexNode *node = GridIndex_createNode(index, &key, row, level);
+    if (!node)
+        return REDISMODULE_ERR;
+
+    index->level = max(index->level, level);
+    for (int i = 0; i < level; ++i)
+    {
+        node->next[i] = update[i]->next[i];
+        update[i]->next[i] = node;
+    }
+
+    return REDISMODULE_OK;
+}
+
+void GridIndex_remove(struct GridIndex *index, const char *data, size_t len, size_t row)
+{
+    struct GridIndexKey key;
+    GridIndex_initKey(&key, data, len);
+    row += index->offset;
+
+    if (index->type == GRID_INDEX_HASH)
+    {
+        struct GridIndexNode **p = GridIndex_findKey(index, &key);
+        struct GridIndexNode *node = *p;
+        if (!node || !GridIndex_removeRow(node->rows, row) || node->rows->count > 0)
+            return;
+
+        // The node goes with the last row holding its key.
+        *p = node->next[0];
+        index->bytes -= GridIndex_rowsSize(node->rows->mask + 1);
+        RedisModule_Free(node->rows);
+        GridIndex_freeNode(index, node);
+        return;
+    }
+
+    struct GridIndexNode *update[GRID_INDEX_MAX_LEVEL];
+    GridIndex_findUpdates(index, &key, row, update);
+
+    struct GridIndexNode *node = update[0]->next[0];
+    if (!node || GridIndex_compareRow(&key, row, node) != 0)
+        return;
+
+    for (int i = 0; i < index->level && update[i]->next[i] == node; ++i)
+        update[i]->next[i] = node->next[i];
+    while (index->level > 1 && !index->head->next[index->level - 1])
+        --index->level;
+
+    GridIndex_freeNode(index, node);
+}
+
+// The rows are dropped from the front of the grid, once their nodes have been removed.
+void GridIndex_dropRows(struct GridIndex *index, size_t rows)
+{
+    index->offset += rows;
+}
+
+static int GridIndex_pushRow(size_t **rows, size_t *count, size_t *capacity, size_t row)
+{
+    if (*count == *capacity)
+    {
+        size_t new_capacity = max(*capacity * 2, (size_t)16);
+        size_t *new_rows = (size_t*)RedisModule_Realloc(*rows, sizeof(size_t) * new_capacity);
+        if (!new_rows)
+            return REDISMODULE_ERR;
+        *rows = new_rows;
+        *capacity = new_capacity;
+    }
+
+    (*rows)[(*count)++] = row;
+    return REDISMODULE_OK;
+}
+
+static int GridIndex_compareRows(const void *a, const void *b)
+{
+    size_t x = *(const size_t*)a, y = *(const size_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Returns the rows in order, with the cells in the range from min to max sorted by their key.
+static size_t GridIndex_collectRange(const struct GridIndex *index, const struct GridIndexKey *min_key, const struct GridIndexKey *max_key, size_t **rows)
+{
+    size_t count = 0, capacity = 0;
+    *rows = NULL;
+
+    struct GridIndexNode *x = index->head;
+    for (int i = index->level - 1; i >= 0; --i)
+    {
+        while (x->next[i] && GridIndex_compare(min_key, x->next[i]) > 0)
+            x = x->next[i];
+    }
+
+    for (x = x->next[0]; x && GridIndex_compare(max_key, x) >= 0; x = x->next[0])
+    {
+        if (GridIndex_pushRow(rows, &count, &capacity, x->row - index->offset) != REDISMODULE_OK)
+            break;
+    }
+
+    return count;
+}
+
+// Returns the rows holding the value in order. The caller frees the rows.
+size_t GridIndex_lookup(const struct GridIndex *index, const char *data, size_t len, size_t **rows)
+{
+    struct GridIndexKey key;
+    GridIndex_initKey(&key, data, len);
+
+    if (index->type == GRID_INDEX_SORTED)
+        return GridIndex_collectRange(index, &key, &key, rows);
+
+    *rows = NULL;
+    const struct GridIndexNode *node = *GridIndex_findKey(index, &key);
+    if (!node)
+        return 0;
+
+    *rows = (size_t*)RedisModule_Alloc(sizeof(size_t) * node->rows->count);
+    if (!*rows)
+        return 0;
+
+    size_t count = 0;
+    for (size_t i = 0; i <= node->rows->mask; ++i)
+    {
+        if (node->rows->rows[i] != GRID_INDEX_NO_ROW)
+            (*rows)[count++] = node->rows->rows[i] - index->offset;
+    }
+
+    if (count > 1)
+        qsort(*rows, count, sizeof(size_t), GridIndex_compareRows);
+    return count;
+}
+
+// Returns the rows of the cells from min to max in the order of their values. Only valid for
+// a sorted index. The caller frees the rows.
+size_t GridIndex_lookupRange(const struct GridIndex *index, const char *min_data, size_t min_len, const char *max_data, size_t max_len, size_t **rows)
+{
+    struct GridIndexKey min_key, max_key;
+    GridIndex_initKey(&min_key, min_data, min_len);
+    GridIndex_initKey(&max_key, max_data, max_len);
+    return GridIndex_collectRange(index, &min_key, &max_key, rows);
+}
+
+size_t GridIndex_memUsage(const struct GridIndex *index)
+{
+    size_t size = sizeof(struct GridIndex) + index->bytes;
+    if (index->type == GRID_INDEX_HASH)
+        size += sizeof(struct GridIndexNode*) * (index->bucket_mask + 1);
+    else
+        size += sizeof(struct GridIndexNode) + sizeof(struct GridIndexNode*) * GRID_INDEX_MAX_LEVEL;
+    return size;
+}
@@ -0,0 +1,94 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __INDEX_H
+#define __INDEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GRID_INDEX_HASH 1
+#define GRID_INDEX_SORTED 2
+
+#define GRID_INDEX_MAX_LEVEL 32
+#define GRID_INDEX_MIN_BUCKETS 16
+
+// The rows of a key in a hash index, held in an open addressed set so a row is added and
+// removed without walking the other rows holding the key.
+struct GridIndexRows {
+    size_t count;
+    size_t mask;
+    size_t rows[];
+};
+
+// An indexed value. Cells holding numbers are keyed by their value, so "1.50" and "1.5" are
+// the same key, and sort before the other cells, which sort by their bytes. A hash index
+// keeps a node for each key, chained through next[0], holding the rows of the key, while a
+// sorted index keeps a node for each cell in a skip list. The text of a cell follows the next
+// pointers.
+struct GridIndexNode {
+    union {
+        size_t row;
+        struct GridIndexRows *rows;
+    };
+    double number;
+    uint32_t hash;
+    uint32_t len;
+    unsigned char is_number;
+    unsigned char level;
+    struct GridIndexNode *next[];
+};
+
+// The rows of the nodes are offset by the number of rows dropped from the front of the grid
+// since the index was built, so dropping rows does not renumber the nodes. A stale index
+// holds no nodes, and is rebuilt from the column when it is next used.
+struct GridIndex {
+    size_t column;
+    int type;
+    int is_stale;
+    size_t offset;
+    size_t count;
+    size_t bytes;
+    struct GridIndexNode **buckets;
+    size_t bucket_mask;
+    struct GridIndexNode *head;
+    int level;
+    uint64_t seed;
+    struct GridIndex *next;
+};
+
+int GridIndex_parseType(const char *name);
+const char *GridIndex_typeName(int type);
+struct GridIndex *GridIndex_create(size_t column, int type);
+void GridIndex_release(struct GridIndex *index);
+void GridIndex_clear(struct GridIndex *index);
+int GridIndex_add(struct GridIndex *index, const char *data, size_t len, size_t row);
+void GridIndex_remove(struct GridIndex *index, const char *data, size_t len, size_t row);
+void GridIndex_dropRows(struct GridIndex *index, size_t rows);
+size_t GridIndex_lookup(const struct GridIndex *index, const char *data, size_t len, size_t **rows);
+size_t GridIndex_lookupRange(const struct GridIndex *index, const char *min_data, size_t min_len, const char *max_data, size_t max_len, size_t **rows);
+size_t GridIndex_memUsage(const struct GridIndex *index);
+
+#endif // __INDEX_H
@@ -23,39 +23,129 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stddef.h>
 #include <string.h>
 
 #include "utils.h"
+#include "aof.h"
 #include "row_grid.h"
 
-void RowGrid_clearRow(char **cstart, char **cend)
+static inline struct RowGridRow *RowGrid_header(char **row)
+{
+    return (struct RowGridRow*)((char*)row - offsetof(struct RowGridRow, cells));
+}
+
+char **RowGrid_allocRow(size_t columns)
+{
+    struct RowGridRow *row = (struct RowGridRow*)RedisModule_Alloc(sizeof(struct RowGridRow) + sizeof(char*) * columns);
+    if (!row)
+        return NULL;
+
+    row->refcount = 1;
+    return row->cells;
+}
+
+char **RowGrid_callocRow(size_t columns)
+{
+    char **row = RowGrid_allocRow(columns);
+    if (row)
+        memset(row, 0, sizeof(char*) * columns);
+    return row;
+}
+
+char **RowGrid_reallocRow(char **row, size_t columns)
+{
+    struct RowGridRow *header = (struct RowGridRow*)RedisModule_Realloc(RowGrid_header(row), sizeof(struct RowGridRow) + sizeof(char*) * columns);
+    return header ? header->cells : NULL;
+}
+
+void RowGrid_freeRow(char **row)
+{
+    if (row && --RowGrid_header(row)->refcount == 0)
+        RedisModule_Free(RowGrid_header(row));
+}
+
+int RowGrid_isShared(char **row)
+{
+    return RowGrid_header(row)->refcount > 1;
+}
+
+// Gives the grid its own copy of a row it shares with another grid, so the row can be written to.
+char **RowGrid_ownRow(char ***r, size_t columns)
+{
+    if (!RowGrid_isShared(*r))
+        return *r;
+
+    char **row = RowGrid_allocRow(columns);
+    if (!row)
+        return NULL;
+
+    memcpy(row, *r, sizeof(char*) * columns);
+    RowGrid_freeRow(*r);
+    *r = row;
+    return row;
+}
+
+int RowGrid_ownRows(char ***rstart, char ***rend, size_t columns)
+{
+    for (char ***r = rstart; r < rend; ++r)
+    {
+        if (!RowGrid_ownRow(r, columns))
+            return REDISMODULE_ERR;
+    }
+    return REDISMODULE_OK;
+}
+
+// Allocates empty rows from rstart to rend, freeing the ones already allocated if a row can not be.
+int RowGrid_callocRows(char ***rstart, char ***rend, size_t columns)
+{
+    for (char ***r = rstart; r < rend; ++r)
+    {
+        *r = RowGrid_callocRow(columns);
+        if (!*r)
+        {
+            for (char ***p = rstart; p < r; ++p)
+                RowGrid_freeRow(*p);
+            return REDISMODULE_ERR;
+        }
+    }
+    return REDISMODULE_OK;
+}
+
+void RowGrid_clearRow(struct Arena *arena, char **cstart, char **cend)
 {
     for (char **c = cstart; c < cend; ++c)
     {
         if (*c)
         {
-            RedisModule_Free(*c);
+            Arena_release(arena, GridCell_size(*c));
             *c = NULL;
         }
     }
 }
 
-void RowGrid_clearRows(char ***rstart, char ***rend, size_t columns)
+void RowGrid_clearRows(struct Arena *arena, char ***rstart, char ***rend, size_t columns)
 {
     for (char ***r = rstart; r < rend; ++r)
-        RowGrid_clearRow(*r, *r + columns);
+        RowGrid_clearRow(arena, *r, *r + columns);
 }
 
-int RowGrid_copyRow(RedisModuleString** source, char **cstart, char **cend)
+int RowGrid_copyRow(struct Arena *arena, RedisModuleString** source, char **cstart, char **cend)
 {
     if (!cstart)
         return REDISMODULE_ERR;
 
+    if (!source)
+    {
+        memset(cstart, 0, (cend - cstart) * sizeof(char*));
+        return REDISMODULE_OK;
+    }
+
     for (char **c = cstart; c < cend; ++c, ++source)
     {
-        if (GridType_setRedisString(source, c) != REDISMODULE_OK)
+        if (GridType_setRedisString(arena, source, c) != REDISMODULE_OK)
         {
-            RowGrid_clearRow(cstart, c);
+            RowGrid_clearRow(arena, cstart, c);
             return REDISMODULE_ERR;
         }
     }
@@ -63,13 +153,16 @@ int RowGrid_copyRow(RedisModuleString** source, char **cstart, char **cend)
     return REDISMODULE_OK;
 }
 
-int RowGrid_copyRedisStrings(RedisModuleString **source, char ***rstart, char ***rend, size_t columns)
+int RowGrid_copyRedisStrings(struct Arena *arena, RedisModuleString **source, char ***rstart, char ***rend, size_t columns)
 {
+    if (Arena_reserve(arena, GridType_measureRedisStrings(source, (rend - rstart) * columns)) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
     for (char ***r = rstart; r < rend; ++r, source += columns)
     {
-        if (RowGrid_copyRow(source, *r, *r + columns) != REDISMODULE_OK)
+        if (RowGrid_copyRow(arena, source, *r, *r + columns) != REDISMODULE_OK)
         {
-            RowGrid_clearRows(rstart, r, columns);
+            RowGrid_clearRows(arena, rstart, r, columns);
             return REDISMODULE_ERR;
         }
     }
@@ -77,21 +170,32 @@ int RowGrid_copyRedisStrings(RedisModuleString **source, char ***rstart, char **
     return REDISMODULE_OK;
 }
 
-char ***RowGrid_copyAndAllocRedisStrings(RedisModuleString **source, size_t rows, size_t columns)
+char ***RowGrid_copyAndAllocRedisStrings(struct Arena *arena, RedisModuleString **source, size_t rows, size_t columns)
 {
     char ***rstart = (char***)RedisModule_Alloc(sizeof(char**) * rows);
     if (!rstart)
         return NULL;
 
-    for (char ***r = rstart, ***rend = rstart + rows; r < rend; ++r, source += columns)
+    if (source && Arena_reserve(arena, GridType_measureRedisStrings(source, rows * columns)) != REDISMODULE_OK)
+    {
+        RedisModule_Free(rstart);
+        return NULL;
+    }
+
+    for (char ***r = rstart, ***rend = rstart + rows; r < rend; ++r)
     {
-        *r = (char**)RedisModule_Alloc(sizeof(char*) * columns);
-        if (RowGrid_copyRow(source, *r, *r + columns) != REDISMODULE_OK)
+        *r = RowGrid_allocRow(columns);
+        if (RowGrid_copyRow(arena, source, *r, *r + columns) != REDISMODULE_OK)
         {
-            RowGrid_clearRows(rstart, r, columns);
+            RowGrid_clearRows(arena, rstart, r, columns);
+            for (char ***p = rstart; p <= r; ++p)
+                RowGrid_freeRow(*p);
             RedisModule_Free(rstart);
             return NULL;
         }
+
+        if (source)
+            source += columns;
     }
 
     return rstart;
@@ -103,29 +207,86 @@ struct RowGrid *RowGrid_createObject(size_t rows, size_t columns, RedisModuleStr
     if (!o)
         return NULL;
 
-    o->rstart = RowGrid_copyAndAllocRedisStrings(source, rows, columns);
+    Arena_init(&o->arena);
+
+    o->rstart = RowGrid_copyAndAllocRedisStrings(&o->arena, source, rows, columns);
     if (!o->rstart)
     {
+        Arena_free(&o->arena);
         RedisModule_Free(o);
         return NULL;
     }
 
     o->rows = rows;
     o->columns = columns;
+    o->capacity = rows;
+    o->rbase = o->rstart;
     o->rend = o->rstart + rows;
 
     return o;
 }
 
+struct RowGrid *RowGrid_copyObject(const struct RowGrid *o)
+{
+    struct RowGrid *copy = (struct RowGrid *)RedisModule_Alloc(sizeof(struct RowGrid));
+    if (!copy)
+        return NULL;
+
+    copy->rstart = (char***)RedisModule_Alloc(sizeof(char**) * o->rows);
+    if (!copy->rstart && o->rows > 0)
+    {
+        RedisModule_Free(copy);
+        return NULL;
+    }
+
+    // The rows and their cells are shared until one of the grids writes to them.
+    memcpy(copy->rstart, o->rstart, sizeof(char**) * o->rows);
+    for (char ***r = o->rstart; r < o->rend; ++r)
+        ++RowGrid_header(*r)->refcount;
+
+    copy->rows = o->rows;
+    copy->columns = o->columns;
+    copy->capacity = o->rows;
+    copy->rbase = copy->rstart;
+    copy->rend = copy->rstart + o->rows;
+    Arena_share(&copy->arena, &o->arena);
+
+    return copy;
+}
+
 void RowGrid_releaseObject(struct RowGrid *o)
 {
-    RowGrid_clearRows(o->rstart, o->rend, o->columns);
+    Arena_free(&o->arena);
     for (char ***r = o->rstart; r < o->rend; ++r)
-        RedisModule_Free(*r);
-    RedisModule_Free(o->rstart);
+        RowGrid_freeRow(*r);
+    RedisModule_Free(o->rbase);
     RedisModule_Free(o);
 }
 
+void RowGrid_compact(struct RowGrid *o)
+{
+    // Every cell is moved, so the grid can no longer share any rows.
+    if (RowGrid_ownRows(o->rstart, o->rend, o->columns) != REDISMODULE_OK)
+        return;
+
+    struct Arena arena;
+    Arena_init(&arena);
+    if (Arena_reserve(&arena, Arena_liveBytes(&o->arena)) != REDISMODULE_OK)
+        return;
+
+    for (char ***r = o->rstart; r < o->rend; ++r)
+    {
+        for (char **c = *r, **cend = *r + o->columns; c < cend; ++c)
+        {
+            if (*c)
+                *c = GridCell_copy(&arena, *c);
+        }
+    }
+
+    Arena_free(&o->arena);
+    o->arena = arena;
+}
+
 int RowGrid_setObject(struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source)
 {
     long long row_sign = row_start < row_end ? 1 : -1;
@@ -133,145 +294,477 @@ int RowGrid_setObject(struct RowGrid *o, long long row_start, long long row_end,
 
     for (long long r = row_start; r != row_end + row_sign; r += row_sign)
     {
+        char **row = RowGrid_ownRow(o->rstart + r, o->columns);
+        if (!row)
+            return REDISMODULE_ERR;
+
         for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++source)
         {
-            if (GridType_resetRedisString(source, &o->rstart[r][c]) != REDISMODULE_OK)
+            if (GridType_resetRedisString(&o->arena, source, row + c) != REDISMODULE_OK)
                 return REDISMODULE_ERR;
         }
     }
 
+    if (Arena_shouldCompact(&o->arena))
+        RowGrid_compact(o);
+
     return REDISMODULE_OK;
 }
 
-int RowGrid_resizeAndCopyObject(struct RowGrid *o, size_t rows, size_t columns)
+int RowGrid_setBlobObject(struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob)
 {
-    // If there are fewer rows in the new grid clear the old rows of data and free them.
-    for (char ***r = o->rstart + rows; r < o->rend; ++r)
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    if (RowGrid_ownRows(o->rstart + min(row_start, row_end), o->rstart + max(row_start, row_end) + 1, o->columns) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    // The blob is column oriented, so fill the range a column at a time.
+    size_t j = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++j)
     {
-        RowGrid_clearRow(*r, *r + o->columns);
-        RedisModule_Free(*r);
+        size_t i = 0;
+        for (long long r = row_start; r != row_end + row_sign; r += row_sign, ++i)
+        {
+            char buf[GRID_NUMBER_BUFSIZE];
+            size_t len;
+            const char *text = Blob_formatCell(blob, j, i, buf, &len);
+            if (GridType_resetString(&o->arena, text, len, o->rstart[r] + c) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
     }
 
-    if (columns != o->columns)
+    if (Arena_shouldCompact(&o->arena))
+        RowGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+// Makes room for the given rows after rstart, doubling the capacity so appending a row at a time is amortized.
+int RowGrid_reserveRows(struct RowGrid *o, size_t rows)
+{
+    size_t dropped = (size_t)(o->rstart - o->rbase);
+    if (dropped + rows <= o->capacity)
+        return REDISMODULE_OK;
+
+    // The room left by dropped rows is reused once it is half of the pointers, which keeps a capped grid amortized too.
+    if (dropped > 0)
     {
-        // We have already delt with surpless rows so calculate the row end.
-        char *** rend =o->rstart + min(rows, o->rows);
+        memmove(o->rbase, o->rstart, sizeof(char**) * o->rows);
+        o->rstart = o->rbase;
+        o->rend = o->rbase + o->rows;
+        if (dropped >= o->capacity / 2 && rows <= o->capacity)
+            return REDISMODULE_OK;
+    }
 
-        // if there are less columns in the new grid clear the surpless data.
-        if (columns < o->columns)
-        {
-            for (char ***r = o->rstart; r < rend; ++r)
-                RowGrid_clearRow(*r + columns, *r + o->columns);
-        }
+    size_t capacity = max(rows, o->capacity * 2);
+    char ***rbase = (char***)RedisModule_Realloc(o->rbase, sizeof(char**) * capacity);
+    if (!rbase)
+        return REDISMODULE_ERR;
 
-        // Resize the columns
-        for (char ***r = o->rstart; r < rend; ++r)
-            *r = (char**)RedisModule_Realloc(*r, sizeof(char*) * columns);
+    o->rbase = rbase;
+    o->rstart = rbase;
+    o->rend = rbase + o->rows;
+    o->capacity = capacity;
 
-        // If the new columns are longer initialize the memory.
-        if (columns > o->columns)
+    return REDISMODULE_OK;
+}
+
+int RowGrid_appendRows(struct RowGrid *o, size_t rows, RedisModuleString **source)
+{
+    if (RowGrid_reserveRows(o, o->rows + rows) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    char ***rend = o->rend + rows;
+    for (char ***r = o->rend; r < rend; ++r)
+    {
+        *r = RowGrid_allocRow(o->columns);
+        if (!*r)
         {
-            size_t trim_len = sizeof(char*) * (columns - o->columns);
-            for (char ***r = o->rstart; r < rend; ++r)
-                memset(*r + o->columns, 0, trim_len);
-            
+            for (char ***p = o->rend; p < r; ++p)
+                RowGrid_freeRow(*p);
+            return REDISMODULE_ERR;
         }
+    }
 
-        o->columns = columns;
+    if (RowGrid_copyRedisStrings(&o->arena, source, o->rend, rend, o->columns) != REDISMODULE_OK)
+    {
+        for (char ***r = o->rend; r < rend; ++r)
+            RowGrid_freeRow(*r);
+        return REDISMODULE_ERR;
     }
 
-    // If the rows are a different size, resize them
-    if (rows != o->rows)
+    o->rows += rows;
+    o->rend = rend;
+
+    return REDISMODULE_OK;
+}
+
+// The first rows are dropped by moving rstart past them, their room is reused by a later append.
+void RowGrid_dropRows(struct RowGrid *o, size_t rows)
+{
+    char ***rstart = o->rstart + rows;
+    for (char ***r = o->rstart; r < rstart; ++r)
     {
-        o->rstart = (char***)RedisModule_Realloc(o->rstart, sizeof(char**) * rows);
-        o->rend = o->rstart + rows;
-        
-        // If there are more rows allocate columns
-        if (rows > o->rows)
+        // The cells of a shared row are still in use by the other grid.
+        if (!RowGrid_isShared(*r))
+            RowGrid_clearRow(&o->arena, *r, *r + o->columns);
+        RowGrid_freeRow(*r);
+    }
+
+    o->rstart = rstart;
+    o->rows -= rows;
+
+    if (Arena_shouldCompact(&o->arena))
+        RowGrid_compact(o);
+}
+
+// Rows are inserted by moving the row pointers on the shorter side of them, the rows before
+// move down into the room left by dropped rows when there is enough of it.
+int RowGrid_insertRows(struct RowGrid *o, size_t row, size_t count)
+{
+    char ***r;
+    if (row < o->rows / 2 && (size_t)(o->rstart - o->rbase) >= count)
+    {
+        memmove(o->rstart - count, o->rstart, sizeof(char**) * row);
+        o->rstart -= count;
+        r = o->rstart + row;
+
+        // The rows before are moved back if the new rows can not be allocated.
+        if (RowGrid_callocRows(r, r + count, o->columns) != REDISMODULE_OK)
         {
-            for (char ***r = o->rstart + o->rows; r < o->rend; ++r)
-                *r = (char**)RedisModule_Calloc(columns, sizeof(char*));
+            memmove(o->rstart + count, o->rstart, sizeof(char**) * row);
+            o->rstart += count;
+            return REDISMODULE_ERR;
         }
+    }
+    else
+    {
+        if (RowGrid_reserveRows(o, o->rows + count) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+        r = o->rstart + row;
+        memmove(r + count, r, sizeof(char**) * (o->rows - row));
 
-        o->rows = rows;
+        // The rows after are moved back if the new rows can not be allocated.
+        if (RowGrid_callocRows(r, r + count, o->columns) != REDISMODULE_OK)
+        {
+            memmove(r, r + count, sizeof(char**) * (o->rows - row));
+            return REDISMODULE_ERR;
+        }
     }
 
+    o->rows += count;
+    o->rend = o->rstart + o->rows;
+
     return REDISMODULE_OK;
 }
 
-int RowGrid_resizeAndReplaceObject(struct RowGrid *o, size_t rows, size_t columns, RedisModuleString **source)
+void RowGrid_deleteRows(struct RowGrid *o, size_t row, size_t count)
 {
-    if (rows == o->rows && columns == o->columns)
-        return RowGrid_setObject(o, 0, rows - 1, 0, columns - 1, source);
+    char ***r = o->rstart + row;
+    for (char ***p = r; p < r + count; ++p)
+    {
+        // The cells of a shared row are still in use by the other grid.
+        if (!RowGrid_isShared(*p))
+            RowGrid_clearRow(&o->arena, *p, *p + o->columns);
+        RowGrid_freeRow(*p);
+    }
 
-    // Clear the existing values.
-    RowGrid_clearRows(o->rstart, o->rend, o->columns);
+    if (row < o->rows - row - count)
+    {
+        memmove(o->rstart + count, o->rstart, sizeof(char**) * row);
+        o->rstart += count;
+    }
+    else
+        memmove(r, r + count, sizeof(char**) * (o->rows - row - count));
 
-    // if there are fewer rows in the new grid free them.
-    for (char ***r = o->rstart + rows; r < o->rend; ++r)
-        RedisModule_Free(*r);
+    o->rows -= count;
+    o->rend = o->rstart + o->rows;
+
+    if (Arena_shouldCompact(&o->arena))
+        RowGrid_compact(o);
+}
 
-    if (columns != o->columns)
+int RowGrid_insertColumns(struct RowGrid *o, size_t column, size_t count)
+{
+    // Every row changes width, so they can not be shared.
+    if (RowGrid_ownRows(o->rstart, o->rend, o->columns) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    // Every row is grown before any is shifted. A row which has grown before a later
+    // allocation fails is still a valid row of the old width.
+    size_t columns = o->columns + count;
+    for (char ***r = o->rstart; r < o->rend; ++r)
+    {
+        char **row = RowGrid_reallocRow(*r, columns);
+        if (!row)
+            return REDISMODULE_ERR;
+        *r = row;
+    }
+
+    for (char ***r = o->rstart; r < o->rend; ++r)
     {
-        // We have already delt with surpless rows so calculate the row end.
-        char *** rend =o->rstart + min(rows, o->rows);
+        memmove(*r + column + count, *r + column, sizeof(char*) * (o->columns - column));
+        memset(*r + column, 0, sizeof(char*) * count);
+    }
+
+    o->columns = columns;
+
+    return REDISMODULE_OK;
+}
+
+int RowGrid_deleteColumns(struct RowGrid *o, size_t column, size_t count)
+{
+    // Every row changes width, so they can not be shared.
+    if (RowGrid_ownRows(o->rstart, o->rend, o->columns) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    size_t columns = o->columns - count;
+    for (char ***r = o->rstart; r < o->rend; ++r)
+    {
+        char **row = *r;
+        RowGrid_clearRow(&o->arena, row + column, row + column + count);
+        memmove(row + column, row + column + count, sizeof(char*) * (columns - column));
+
+        // A row which can not be shrunk keeps its larger allocation.
+        row = RowGrid_reallocRow(row, columns);
+        if (row)
+            *r = row;
+    }
+
+    o->columns = columns;
+
+    if (Arena_shouldCompact(&o->arena))
+        RowGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+// Rows are moved by their pointers, so no cells are copied, and shared rows stay shared.
+int RowGrid_permuteRows(struct RowGrid *o, const size_t *order)
+{
+    char ***rows = (char***)RedisModule_Alloc(sizeof(char**) * o->rows);
+    if (!rows)
+        return REDISMODULE_ERR;
+
+    for (size_t r = 0; r < o->rows; ++r)
+        rows[r] = o->rstart[order[r]];
+    memcpy(o->rstart, rows, sizeof(char**) * o->rows);
+
+    RedisModule_Free(rows);
+
+    return REDISMODULE_OK;
+}
+
+int RowGrid_resizeAndCopyObject(struct RowGrid *o, size_t rows, size_t columns)
+{
+    char ***rkeep = o->rstart + min(rows, o->rows);
 
-        // Resize the columns
-        for (char ***r = o->rstart; r < rend; ++r)
-            *r = (char**)RedisModule_Realloc(*r, sizeof(char*) * columns);
+    // The rows which are kept change width, so they can not be shared.
+    if (columns != o->columns && RowGrid_ownRows(o->rstart, rkeep, o->columns) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
 
-        // If the new columns are longer initialize the memory.
-        if (columns > o->columns)
+    // Everything which can fail is allocated before any row is changed. A kept row which has
+    // grown before a later allocation fails is still a valid row of the old width.
+    if (columns > o->columns)
+    {
+        for (char ***r = o->rstart; r < rkeep; ++r)
         {
-            size_t trim_len = sizeof(char*) * (columns - o->columns);
-            for (char***r = o->rstart; r < rend; ++r)
-                memset(*r + o->columns, 0, trim_len);
+            char **row = RowGrid_reallocRow(*r, columns);
+            if (!row)
+                return REDISMODULE_ERR;
+            *r = row;
         }
+    }
 
-        o->columns = columns;
+    if (rows > o->rows)
+    {
+        if (RowGrid_reserveRows(o, rows) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
+        rkeep = o->rstart + o->rows;
+        if (RowGrid_callocRows(o->rend, o->rstart + rows, columns) != REDISMODULE_OK)
+            return REDISMODULE_ERR;
     }
 
-    // If the rows are a different size, resize them
-    if (rows != o->rows)
+    // If there are fewer rows in the new grid clear the old rows of data and free them.
+    for (char ***r = o->rstart + rows; r < o->rend; ++r)
     {
-        o->rstart = (char***)RedisModule_Realloc(o->rstart, sizeof(char**) * rows);
-        o->rend = o->rstart + rows;
-        
-        // If there are more rows allocate columns
-        if (rows > o->rows)
+        // The cells of a shared row are still in use by the other grid.
+        if (!RowGrid_isShared(*r))
+            RowGrid_clearRow(&o->arena, *r, *r + o->columns);
+        RowGrid_freeRow(*r);
+    }
+
+    // if there are less columns in the new grid clear the surpless data and shrink the rows,
+    // a row which can not be shrunk keeps its larger allocation.
+    if (columns < o->columns)
+    {
+        for (char ***r = o->rstart; r < rkeep; ++r)
         {
-            for (char ***r = o->rstart + o->rows; r < o->rend; ++r)
-                *r = (char**)RedisModule_Calloc(columns, sizeof(char*));
+            RowGrid_clearRow(&o->arena, *r + columns, *r + o->columns);
+            char **row = RowGrid_reallocRow(*r, columns);
+            if (row)
+                *r = row;
         }
+    }
 
-        o->rows = rows;
+    // If the new columns are longer initialize the memory.
+    if (columns > o->columns)
+    {
+        size_t trim_len = sizeof(char*) * (columns - o->columns);
+        for (char ***r = o->rstart; r < rkeep; ++r)
+            memset(*r + o->columns, 0, trim_len);
     }
 
-    RowGrid_copyRedisStrings(source, o->rstart, o->rend, o->columns);
+    o->columns = columns;
+    o->rows = rows;
+    o->rend = o->rstart + rows;
+
+    if (Arena_shouldCompact(&o->arena))
+        RowGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int RowGrid_resizeAndReplaceObject(struct RowGrid *o, size_t rows, size_t columns, RedisModuleString **source)
+{
+    if (rows == o->rows && columns == o->columns)
+        return RowGrid_setObject(o, 0, rows - 1, 0, columns - 1, source);
+
+    // Every value is replaced, so the new rows are built in their own arena and the grid
+    // is only changed once all of them could be allocated.
+    struct Arena arena;
+    Arena_init(&arena);
+
+    char ***rstart = RowGrid_copyAndAllocRedisStrings(&arena, source, rows, columns);
+    if (!rstart)
+    {
+        Arena_free(&arena);
+        return REDISMODULE_ERR;
+    }
+
+    // A shared row is only released, its cells are still in use by the other grid.
+    for (char ***r = o->rstart; r < o->rend; ++r)
+        RowGrid_freeRow(*r);
+    RedisModule_Free(o->rbase);
+    Arena_free(&o->arena);
+
+    o->arena = arena;
+    o->rows = rows;
+    o->columns = columns;
+    o->capacity = rows;
+    o->rbase = rstart;
+    o->rstart = rstart;
+    o->rend = rstart + rows;
 
     return REDISMODULE_OK;
 }
 
-void RowGrid_rangeObject(RedisModuleCtx *ctx, struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end)
+void RowGrid_rangeObject(RedisModuleCtx *ctx, struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
 {
-    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
-    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end)) / row_step;
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end)) / column_step;
     RedisModule_ReplyWithArray(ctx, (long)(rows * columns));
 
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+    {
+        for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+        {
+            GridCell_reply(ctx, o->rstart[r][c]);
+        }
+    }
+}
+
+// Replies the cells of the range a column at a time, without an array header.
+void RowGrid_replyColumns(RedisModuleCtx *ctx, struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+    {
+        for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+            GridCell_reply(ctx, o->rstart[r][c]);
+    }
+}
+
+void RowGrid_aggregateObject(struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results)
+{
     long long row_sign = row_start < row_end ? 1 : -1;
     long long column_sign = column_start < column_end ? 1 : -1;
 
+    struct Aggregate *a = results;
     for (long long r = row_start; r != row_end + row_sign; r += row_sign)
     {
+        if (axis == AGGREGATE_AXIS_ROWS)
+            a = results + (r - row_start) * row_sign;
+
         for (long long c = column_start; c != column_end + column_sign; c += column_sign)
         {
-            char *s = o->rstart[r][c];
-            if (s)
-                RedisModule_ReplyWithSimpleString(ctx, s);
-            else
-                RedisModule_ReplyWithNull(ctx);
+            if (axis == AGGREGATE_AXIS_COLUMNS)
+                a = results + (c - column_start) * column_sign;
+
+            double value;
+            if (GridCell_toDouble(o->rstart[r][c], &value) == REDISMODULE_OK)
+                Aggregate_add(a, value);
+        }
+    }
+}
+
+void RowGrid_filterObject(const struct RowGrid *o, const struct Filter *filter, uint64_t *bits)
+{
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        if (Filter_matchCell(filter, o->rstart[r][filter->column]))
+            Filter_setBit(bits, r);
+    }
+}
+
+void RowGrid_gatherColumn(struct RowGrid *o, char **cells, long long column, long long row_start, long long row_end)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+        *cells++ = o->rstart[r][column];
+}
+
+char *RowGrid_rangeBlobObject(struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len)
+{
+    size_t rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    size_t columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    char **cells = (char**)RedisModule_Alloc(sizeof(char*) * rows);
+
+    size_t size = Blob_headerSize(columns);
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        RowGrid_gatherColumn(o, cells, c, row_start, row_end);
+        size_t column_size = Blob_stringColumnSize(cells, rows);
+        if (column_size == BLOB_TOO_LARGE)
+        {
+            RedisModule_Free(cells);
+            return NULL;
         }
+        size += column_size;
+    }
+
+    char *blob = (char*)RedisModule_Alloc(size);
+    char *p = Blob_writeHeader(blob, rows, columns);
+    size_t i = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        RowGrid_gatherColumn(o, cells, c, row_start, row_end);
+        p = Blob_writeStringColumn(blob, p, i++, cells, rows);
     }
+
+    RedisModule_Free(cells);
+
+    *len = size;
+    return blob;
 }
 
 int RowGrid_getRangeValues(RedisModuleCtx *ctx, struct RowGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end)
@@ -302,52 +795,38 @@ int RowGrid_dump(RedisModuleCtx *ctx, struct RowGrid *o)
     for (char ***r = o->rstart; r < o->rend; ++r)
     {
         for (char **c = *r, **cend = *r + o->columns; c < cend; ++c)
-        {
-            if (*c)
-                RedisModule_ReplyWithSimpleString(ctx, *c);
-            else
-                RedisModule_ReplyWithNull(ctx);
-        }
+            GridCell_reply(ctx, *c);
     }
     
     return REDISMODULE_OK;
 }
 
-void RowGrid_rdbSave(RedisModuleIO *rdb, struct RowGrid *o)
-{
-    RedisModule_SaveUnsigned(rdb, (uint64_t)o->rows);
-    RedisModule_SaveUnsigned(rdb, (uint64_t)o->columns);
-    for (char ***r = o->rstart; r  < o->rend; ++r)
-    {
-        for (char **c = *r, **cend = *r + o->columns; c < cend; ++c)
-        {
-            if (*c)
-                RedisModule_SaveStringBuffer(rdb, *c, strlen(*c) + 1);
-            else
-                RedisModule_SaveStringBuffer(rdb, "", 1);
-        }
-    }
-}
-
 struct RowGrid* RowGrid_rdbLoad(RedisModuleIO *rdb)
 {
     size_t rows = (size_t) RedisModule_LoadUnsigned(rdb);
     size_t columns = (size_t) RedisModule_LoadUnsigned(rdb);
     char ***rstart = (char***) RedisModule_Alloc(sizeof(char**) * rows);
     char ***rend = rstart + rows;
+
+    struct RowGrid *o = (struct RowGrid*) RedisModule_Alloc(sizeof(struct RowGrid));
+    Arena_init(&o->arena);
+
     for (char ***r = rstart; r < rend; ++r)
     {
-        *r = (char**)RedisModule_Alloc(sizeof(char*) * columns);
+        *r = RowGrid_allocRow(columns);
         for (char **c = *r, **cend = *r + columns; c < cend; ++c)
         {
             size_t l;
-            *c = RedisModule_LoadStringBuffer(rdb, &l);
+            char *s = RedisModule_LoadStringBuffer(rdb, &l);
+            *c = l > 1 ? GridCell_create(&o->arena, s, l - 1) : NULL;
+            RedisModule_Free(s);
         }
     }
 
-    struct RowGrid *o = (struct RowGrid*) RedisModule_Alloc(sizeof(struct RowGrid));
     o->rows = rows;
     o->columns = columns;
+    o->capacity = rows;
+    o->rbase = rstart;
     o->rstart = rstart;
     o->rend = rend;
     return o;
@@ -355,43 +834,30 @@ struct RowGrid* RowGrid_rdbLoad(RedisModuleIO *rdb)
 
 void RowGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct RowGrid *o) 
 {
-    RedisModuleCtx *ctx = RedisModule_GetContextFromIO(aof);
-
-    size_t len = o->columns * o->rows;
-    RedisModuleString **start = (RedisModuleString**)RedisModule_Alloc(sizeof(RedisModuleString*) * len);
-    RedisModuleString **p = start, **end = start + len;
+    struct AofWriter writer;
+    Aof_open(&writer, aof, key, o->rows, o->columns);
 
     for (char ***r = o->rstart; r < o->rend; ++r)
     {
-        for (char **c = *r, **cend = *r + o->columns; c < cend; ++c, ++p)
+        for (char **c = *r, **cend = *r + o->columns; c < cend; ++c)
         {
             if (*c)
-                *p = RedisModule_CreateString(ctx, *c, strlen(*c));
+                Aof_writeCell(&writer, GridCell_data(*c), GridCell_length(*c));
             else
-                *p = RedisModule_CreateString(ctx, "", 0);
+                Aof_writeCell(&writer, NULL, 0);
         }
     }
 
-    RedisModule_EmitAOF(aof, "GRID.DIM","sllv", key, (long long)o->rows, (long long)o->columns, start, len);
-
-    for (p = start; p < end; ++p)
-        RedisModule_FreeString(ctx, *p);
-    RedisModule_Free(start);
+    Aof_close(&writer);
 }
 
 size_t RowGrid_memUsage(const struct RowGrid *o) 
 {
-    size_t usage = sizeof(*o) + sizeof(char***) * o->rows + o->rows * o->columns * sizeof(char**);
-
+    // Shared rows are counted in equal parts by the grids sharing them.
+    size_t size = sizeof(*o) + sizeof(char***) * o->capacity + Arena_memUsage(&o->arena);
     for (char ***r = o->rstart; r < o->rend; ++r)
-    {
-        for (char **c = *r, **cend = *r + o->columns; c < cend; ++c)
-        {
-            usage += *c ? strlen(*c) + 1 : 0;
-        }
-    }
-
-    return usage;
+        size += (sizeof(struct RowGridRow) + o->columns * sizeof(char**)) / RowGrid_header(*r)->refcount;
+    return size;
 }
 
 void RowGrid_digest(RedisModuleDigest *md, struct RowGrid *o)
@@ -404,7 +870,7 @@ void RowGrid_digest(RedisModuleDigest *md, struct RowGrid *o)
         for (char **c = *r, **cend = *r + o->columns; c < cend; ++c)
         {
             if (*c)
-                RedisModule_DigestAddStringBuffer(md, (unsigned char*)*c, strlen((const char*)*c) + 1);
+                RedisModule_DigestAddStringBuffer(md, (unsigned char*)GridCell_data(*c), GridCell_length(*c) + 1);
             else
                 RedisModule_DigestAddStringBuffer(md, (unsigned char*)"", 1);
         }
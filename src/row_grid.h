@@ -27,24 +27,53 @@
 #define  __ROW_GRID_H
 
 #include "redismodule.h"
+#include "arena.h"
+#include "aggregate.h"
+#include "filter.h"
+#include "blob.h"
 
+// Each row is allocated behind a reference count so a copy of the grid can
+// share it until one of the grids writes to the row.
+struct RowGridRow {
+    size_t refcount;
+    char *cells[];
+};
+
+// The row pointers have room for capacity rows from rbase, so rows can be
+// appended and dropped from the front without reallocating them each time.
 struct RowGrid {
     size_t rows;
     size_t columns;
+    size_t capacity;
+    char*** rbase;
     char*** rstart;
     char*** rend;
+    struct Arena arena;
 };
 
 struct RowGrid *RowGrid_createObject(size_t rows, size_t columns, RedisModuleString** source);
+struct RowGrid *RowGrid_copyObject(const struct RowGrid *o);
 void RowGrid_releaseObject(struct RowGrid *o);
+void RowGrid_compact(struct RowGrid *o);
 int RowGrid_setObject(struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source);
+int RowGrid_setBlobObject(struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob);
 int RowGrid_resizeAndCopyObject(struct RowGrid *o, size_t rows, size_t columns);
+int RowGrid_appendRows(struct RowGrid *o, size_t rows, RedisModuleString **source);
+void RowGrid_dropRows(struct RowGrid *o, size_t rows);
+int RowGrid_insertRows(struct RowGrid *o, size_t row, size_t count);
+void RowGrid_deleteRows(struct RowGrid *o, size_t row, size_t count);
+int RowGrid_insertColumns(struct RowGrid *o, size_t column, size_t count);
+int RowGrid_deleteColumns(struct RowGrid *o, size_t column, size_t count);
+int RowGrid_permuteRows(struct RowGrid *o, const size_t *order);
 int RowGrid_resizeAndReplaceObject(struct RowGrid *o, size_t rows, size_t columns, RedisModuleString **source);
-void RowGrid_rangeObject(RedisModuleCtx *ctx, struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end);
+void RowGrid_rangeObject(RedisModuleCtx *ctx, struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void RowGrid_replyColumns(RedisModuleCtx *ctx, struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void RowGrid_aggregateObject(struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results);
+void RowGrid_filterObject(const struct RowGrid *o, const struct Filter *filter, uint64_t *bits);
+char *RowGrid_rangeBlobObject(struct RowGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len);
 int RowGrid_getRangeValues(RedisModuleCtx *ctx, struct RowGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end);
 int RowGrid_getShape(RedisModuleCtx *ctx, struct RowGrid* o);
 int RowGrid_dump(RedisModuleCtx *ctx, struct RowGrid* o);
-void RowGrid_rdbSave(RedisModuleIO *rdb, struct RowGrid *o);
 struct RowGrid* RowGrid_rdbLoad(RedisModuleIO *rdb);
 void RowGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct RowGrid *o);
 size_t RowGrid_memUsage(const struct RowGrid *o);
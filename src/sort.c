@@ -0,0 +1,182 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <string.h>
+
+#include "utils.h"
+#include "sort.h"
+
+void Sort_initNumber(struct SortNumber *number, double value, size_t row)
+{
+    // Negative zero sorts as zero.
+    if (value == 0)
+        value = 0;
+
+    // Flipping the sign bit of a positive number, and every bit of a negative one, orders
+    // the bits of doubles the same way as their values.
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    number->key = bits >> 63 ? ~bits : bits ^ ((uint64_t)1 << 63);
+    number->row = row;
+}
+
+void Sort_initText(struct SortText *text, const char *data, size_t len, size_t row)
+{
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < sizeof(prefix); ++i)
+        prefix = (prefix << 8) | (i < len ? (unsigned char)data[i] : 0);
+
+    text->prefix = prefix;
+    text->data = data;
+    text->len = len;
+    text->row = row;
+}
+
+// A least significant digit radix sort, which is stable, so equal numbers keep the order of
+// their rows. The digits which are the same for every number are skipped.
+int Sort_numbers(struct SortNumber *numbers, size_t count, int is_descending)
+{
+    if (count < 2)
+        return REDISMODULE_OK;
+
+    struct SortNumber *buffer = (struct SortNumber*)RedisModule_Alloc(sizeof(struct SortNumber) * count);
+    if (!buffer)
+        return REDISMODULE_ERR;
+
+    // Inverting the keys sorts them from the highest.
+    uint64_t flip = is_descending ? ~(uint64_t)0 : 0;
+
+    size_t counts[sizeof(uint64_t)][SORT_RADIX_BUCKETS];
+    memset(counts, 0, sizeof(counts));
+    for (const struct SortNumber *n = numbers; n < numbers + count; ++n)
+    {
+        uint64_t key = n->key ^ flip;
+        for (size_t d = 0; d < sizeof(uint64_t); ++d)
+            ++counts[d][(key >> (d * SORT_RADIX_BITS)) & (SORT_RADIX_BUCKETS - 1)];
+    }
+
+    struct SortNumber *source = numbers, *dest = buffer;
+    for (size_t d = 0; d < sizeof(uint64_t); ++d)
+    {
+        size_t shift = d * SORT_RADIX_BITS;
+        if (counts[d][((numbers->key ^ flip) >> shift) & (SORT_RADIX_BUCKETS - 1)] == count)
+            continue;
+
+        size_t offsets[SORT_RADIX_BUCKETS], offset = 0;
+        for (size_t b = 0; b < SORT_RADIX_BUCKETS; ++b)
+        {
+            offsets[b] = offset;
+            offset += counts[d][b];
+        }
+
+        for (const struct SortNumber *n = source; n < source + count; ++n)
+            dest[offsets[((n->key ^ flip) >> shift) & (SORT_RADIX_BUCKETS - 1)]++] = *n;
+
+        struct SortNumber *swap = source;
+        source = dest;
+        dest = swap;
+    }
+
+    if (source != numbers)
+        memcpy(numbers, source, sizeof(struct SortNumber) * count);
+
+    RedisModule_Free(buffer);
+
+    return REDISMODULE_OK;
+}
+
+static inline int Sort_compareTexts(const struct SortText *a, const struct SortText *b)
+{
+    if (a->prefix != b->prefix)
+        return a->prefix < b->prefix ? -1 : 1;
+
+    size_t len = a->len < b->len ? a->len : b->len;
+    if (len > sizeof(uint64_t))
+    {
+        int cmp = memcmp(a->data + sizeof(uint64_t), b->data + sizeof(uint64_t), len - sizeof(uint64_t));
+        if (cmp != 0)
+            return cmp;
+    }
+
+    return a->len < b->len ? -1 : a->len > b->len;
+}
+
+// A bottom up merge sort, which is stable. Short runs are sorted in place by insertion first,
+// then the runs are merged back and forth between the texts and a buffer, so each pass reads
+// and writes the entries in order.
+int Sort_texts(struct SortText *texts, size_t count, int is_descending)
+{
+    if (count < 2)
+        return REDISMODULE_OK;
+
+    int sign = is_descending ? -1 : 1;
+
+    for (size_t start = 0; start < count; start += SORT_INSERTION_RUN)
+    {
+        size_t end = start + SORT_INSERTION_RUN < count ? start + SORT_INSERTION_RUN : count;
+        for (size_t i = start + 1; i < end; ++i)
+        {
+            struct SortText text = texts[i];
+            size_t j = i;
+            for (; j > start && sign * Sort_compareTexts(&texts[j - 1], &text) > 0; --j)
+                texts[j] = texts[j - 1];
+            texts[j] = text;
+        }
+    }
+
+    if (count <= SORT_INSERTION_RUN)
+        return REDISMODULE_OK;
+
+    struct SortText *buffer = (struct SortText*)RedisModule_Alloc(sizeof(struct SortText) * count);
+    if (!buffer)
+        return REDISMODULE_ERR;
+
+    struct SortText *source = texts, *dest = buffer;
+    for (size_t width = SORT_INSERTION_RUN; width < count; width *= 2)
+    {
+        for (size_t start = 0; start < count; start += 2 * width)
+        {
+            size_t middle = start + width < count ? start + width : count;
+            size_t end = middle + width < count ? middle + width : count;
+            size_t i = start, j = middle, k = start;
+            while (i < middle && j < end)
+                dest[k++] = sign * Sort_compareTexts(&source[j], &source[i]) < 0 ? source[j++] : source[i++];
+            while (i < middle)
+                dest[k++] = source[i++];
+            while (j < end)
+                dest[k++] = source[j++];
+        }
+
+        struct SortText *swap = source;
+        source = dest;
+        dest = swap;
+    }
+
+    if (source != texts)
+        memcpy(texts, source, sizeof(struct SortText) * count);
+
+    RedisModule_Free(buffer);
+
+    return REDISMODULE_OK;
+}
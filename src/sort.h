@@ -0,0 +1,59 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef __SORT_H
+#define __SORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GRID_SORT_VALUE 0
+#define GRID_SORT_NUMERIC 1
+#define GRID_SORT_ALPHA 2
+
+#define SORT_RADIX_BITS 8
+#define SORT_RADIX_BUCKETS (1 << SORT_RADIX_BITS)
+#define SORT_INSERTION_RUN 16
+
+// A number to sort, keyed by an unsigned integer which orders the same way as the value.
+struct SortNumber {
+    uint64_t key;
+    size_t row;
+};
+
+// A text to sort. The first bytes of the text are packed into the prefix, so most compares
+// are decided without following the pointer to the text.
+struct SortText {
+    uint64_t prefix;
+    const char *data;
+    size_t len;
+    size_t row;
+};
+
+void Sort_initNumber(struct SortNumber *number, double value, size_t row);
+void Sort_initText(struct SortText *text, const char *data, size_t len, size_t row);
+int Sort_numbers(struct SortNumber *numbers, size_t count, int is_descending);
+int Sort_texts(struct SortText *texts, size_t count, int is_descending);
+
+#endif // __SORT_H
@@ -0,0 +1,568 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "utils.h"
+#include "sparse_grid.h"
+
+// Returns the position of the first entry at or after the column.
+size_t SparseGrid_find(const struct SparseRow *row, size_t column)
+{
+    size_t lo = 0, hi = row->count;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (row->entries[mid].column < column)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void SparseGrid_clearRow(struct Arena *arena, struct SparseRow *row, size_t start)
+{
+    for (struct SparseEntry *e = row->entries + start, *end = row->entries + row->count; e < end; ++e)
+        Arena_release(arena, GridCell_size(e->cell));
+
+    row->count = start;
+    if (row->count == 0 && row->entries)
+    {
+        RedisModule_Free(row->entries);
+        row->entries = NULL;
+        row->capacity = 0;
+    }
+}
+
+void SparseGrid_freeRows(struct SparseRow *rstart, struct SparseRow *rend)
+{
+    for (struct SparseRow *r = rstart; r < rend; ++r)
+    {
+        if (r->entries)
+            RedisModule_Free(r->entries);
+    }
+}
+
+int SparseGrid_setCell(struct Arena *arena, struct SparseRow *row, size_t column, const char *data, size_t len)
+{
+    size_t i = SparseGrid_find(row, column);
+    int is_present = i < row->count && row->entries[i].column == column;
+
+    if (len == 0)
+    {
+        if (!is_present)
+            return REDISMODULE_OK;
+
+        Arena_release(arena, GridCell_size(row->entries[i].cell));
+        memmove(row->entries + i, row->entries + i + 1, sizeof(struct SparseEntry) * (row->count - i - 1));
+        if (--row->count == 0)
+            SparseGrid_clearRow(arena, row, 0);
+        return REDISMODULE_OK;
+    }
+
+    char *cell = GridCell_create(arena, data, len);
+    if (!cell)
+        return REDISMODULE_ERR;
+
+    if (is_present)
+    {
+        Arena_release(arena, GridCell_size(row->entries[i].cell));
+        row->entries[i].cell = cell;
+        return REDISMODULE_OK;
+    }
+
+    if (row->count == row->capacity)
+    {
+        size_t capacity = max(row->capacity * 2, (size_t)SPARSE_MIN_ROW_CAPACITY);
+        struct SparseEntry *entries = (struct SparseEntry*)RedisModule_Realloc(row->entries, sizeof(struct SparseEntry) * capacity);
+        if (!entries)
+            return REDISMODULE_ERR;
+        row->entries = entries;
+        row->capacity = capacity;
+    }
+
+    memmove(row->entries + i + 1, row->entries + i, sizeof(struct SparseEntry) * (row->count - i));
+    row->entries[i].column = column;
+    row->entries[i].cell = cell;
+    ++row->count;
+
+    return REDISMODULE_OK;
+}
+
+int SparseGrid_setRedisString(struct Arena *arena, struct SparseRow *row, size_t column, RedisModuleString *source)
+{
+    size_t len;
+    const char *data = RedisModule_StringPtrLen(source, &len);
+    return SparseGrid_setCell(arena, row, column, data, len);
+}
+
+int SparseGrid_copyRedisStrings(struct SparseGrid *o, RedisModuleString **source)
+{
+    if (!source)
+        return REDISMODULE_OK;
+
+    if (Arena_reserve(&o->arena, GridType_measureRedisStrings(source, o->rows * o->columns)) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    // The columns arrive in order, so every entry is appended.
+    for (struct SparseRow *r = o->rstart; r < o->rend; ++r)
+    {
+        for (size_t c = 0; c < o->columns; ++c, ++source)
+        {
+            if (SparseGrid_setRedisString(&o->arena, r, c, *source) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    return REDISMODULE_OK;
+}
+
+struct SparseGrid *SparseGrid_createObject(size_t rows, size_t columns, RedisModuleString **source)
+{
+    struct SparseGrid *o = (struct SparseGrid *)RedisModule_Alloc(sizeof(struct SparseGrid));
+    if (!o)
+        return NULL;
+
+    Arena_init(&o->arena);
+
+    o->rstart = (struct SparseRow*)RedisModule_Calloc(rows, sizeof(struct SparseRow));
+    if (!o->rstart && rows > 0)
+    {
+        RedisModule_Free(o);
+        return NULL;
+    }
+
+    o->rows = rows;
+    o->columns = columns;
+    o->rend = o->rstart + rows;
+
+    if (SparseGrid_copyRedisStrings(o, source) != REDISMODULE_OK)
+    {
+        SparseGrid_releaseObject(o);
+        return NULL;
+    }
+
+    return o;
+}
+
+struct SparseGrid *SparseGrid_copyObject(const struct SparseGrid *o)
+{
+    struct SparseGrid *copy = SparseGrid_createObject(o->rows, o->columns, NULL);
+    if (!copy)
+        return NULL;
+
+    // The entries are copied, but the cells are shared with the original through the arena.
+    Arena_share(&copy->arena, &o->arena);
+
+    for (struct SparseRow *r = copy->rstart, *source = o->rstart; r < copy->rend; ++r, ++source)
+    {
+        if (source->count == 0)
+            continue;
+
+        r->entries = (struct SparseEntry*)RedisModule_Alloc(sizeof(struct SparseEntry) * source->count);
+        if (!r->entries)
+        {
+            SparseGrid_releaseObject(copy);
+            return NULL;
+        }
+
+        memcpy(r->entries, source->entries, sizeof(struct SparseEntry) * source->count);
+        r->count = r->capacity = source->count;
+    }
+
+    return copy;
+}
+
+void SparseGrid_releaseObject(struct SparseGrid *o)
+{
+    Arena_free(&o->arena);
+    SparseGrid_freeRows(o->rstart, o->rend);
+    RedisModule_Free(o->rstart);
+    RedisModule_Free(o);
+}
+
+void SparseGrid_compact(struct SparseGrid *o)
+{
+    struct Arena arena;
+    Arena_init(&arena);
+    if (Arena_reserve(&arena, Arena_liveBytes(&o->arena)) != REDISMODULE_OK)
+        return;
+
+    for (struct SparseRow *r = o->rstart; r < o->rend; ++r)
+    {
+        for (struct SparseEntry *e = r->entries, *end = r->entries + r->count; e < end; ++e)
+            e->cell = GridCell_copy(&arena, e->cell);
+    }
+
+    Arena_free(&o->arena);
+    o->arena = arena;
+}
+
+const char *SparseGrid_getCell(const struct SparseGrid *o, size_t row, size_t column)
+{
+    const struct SparseRow *r = o->rstart + row;
+    size_t i = SparseGrid_find(r, column);
+    return i < r->count && r->entries[i].column == column ? r->entries[i].cell : NULL;
+}
+
+int SparseGrid_setObject(struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+    {
+        for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++source)
+        {
+            if (SparseGrid_setRedisString(&o->arena, o->rstart + r, (size_t)c, *source) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (Arena_shouldCompact(&o->arena))
+        SparseGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int SparseGrid_setBlobObject(struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    size_t i = 0;
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign, ++i)
+    {
+        size_t j = 0;
+        for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++j)
+        {
+            char buf[GRID_NUMBER_BUFSIZE];
+            size_t len;
+            const char *text = Blob_formatCell(blob, j, i, buf, &len);
+            if (SparseGrid_setCell(&o->arena, o->rstart + r, (size_t)c, text, text ? len : 0) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (Arena_shouldCompact(&o->arena))
+        SparseGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int SparseGrid_resizeRows(struct SparseGrid *o, size_t rows)
+{
+    if (rows == o->rows)
+        return REDISMODULE_OK;
+
+    struct SparseRow *rstart = (struct SparseRow*)RedisModule_Realloc(o->rstart, sizeof(struct SparseRow) * rows);
+    if (!rstart && rows > 0)
+        return REDISMODULE_ERR;
+
+    if (rows > o->rows)
+        memset(rstart + o->rows, 0, sizeof(struct SparseRow) * (rows - o->rows));
+
+    o->rstart = rstart;
+    o->rend = rstart + rows;
+    o->rows = rows;
+
+    return REDISMODULE_OK;
+}
+
+int SparseGrid_resizeAndCopyObject(struct SparseGrid *o, size_t rows, size_t columns)
+{
+    // Only the populated cells outside the new bounds need to be visited.
+    for (struct SparseRow *r = o->rstart + min(rows, o->rows); r < o->rend; ++r)
+        SparseGrid_clearRow(&o->arena, r, 0);
+    SparseGrid_freeRows(o->rstart + min(rows, o->rows), o->rend);
+    o->rend = o->rstart + min(rows, o->rows);
+
+    if (columns < o->columns)
+    {
+        for (struct SparseRow *r = o->rstart; r < o->rend; ++r)
+            SparseGrid_clearRow(&o->arena, r, SparseGrid_find(r, columns));
+    }
+    o->columns = columns;
+
+    if (SparseGrid_resizeRows(o, rows) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    if (Arena_shouldCompact(&o->arena))
+        SparseGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int SparseGrid_resizeAndReplaceObject(struct SparseGrid *o, size_t rows, size_t columns, RedisModuleString **source)
+{
+    // Every value is replaced, so the existing values can be dropped with the arena.
+    Arena_free(&o->arena);
+    SparseGrid_freeRows(o->rstart, o->rend);
+    memset(o->rstart, 0, sizeof(struct SparseRow) * o->rows);
+
+    o->columns = columns;
+    if (SparseGrid_resizeRows(o, rows) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    return SparseGrid_copyRedisStrings(o, source);
+}
+
+void SparseGrid_rangeObject(RedisModuleCtx *ctx, struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end)) / row_step;
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end)) / column_step;
+    RedisModule_ReplyWithArray(ctx, (long)(rows * columns));
+
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+    {
+        const struct SparseRow *row = o->rstart + r;
+
+        // Walk the entries alongside the columns rather than searching for each cell.
+        const struct SparseEntry *e = row->entries + SparseGrid_find(row, (size_t)(column_stride > 0 ? column_start : column_start + 1));
+        const struct SparseEntry *begin = row->entries, *end = row->entries + row->count;
+        long long direction = column_stride > 0 ? 1 : -1;
+        if (direction < 0)
+            --e;
+
+        for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+        {
+            // Entries between the stepped columns are skipped over.
+            while (e >= begin && e < end && (direction > 0 ? e->column < (size_t)c : e->column > (size_t)c))
+                e += direction;
+
+            if (e >= begin && e < end && e->column == (size_t)c)
+            {
+                GridCell_reply(ctx, e->cell);
+                e += direction;
+            }
+            else
+                RedisModule_ReplyWithNull(ctx);
+        }
+    }
+}
+
+// Replies the cells of the range a column at a time, without an array header. Each cell is
+// searched for in its row.
+void SparseGrid_replyColumns(RedisModuleCtx *ctx, struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+    {
+        for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+            GridCell_reply(ctx, SparseGrid_getCell(o, (size_t)r, (size_t)c));
+    }
+}
+
+void SparseGrid_aggregateObject(struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+    size_t column_first = (size_t)min(column_start, column_end), column_last = (size_t)max(column_start, column_end);
+
+    // Only the populated cells are visited.
+    struct Aggregate *a = results;
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+    {
+        if (axis == AGGREGATE_AXIS_ROWS)
+            a = results + (r - row_start) * row_sign;
+
+        const struct SparseRow *row = o->rstart + r;
+        for (const struct SparseEntry *e = row->entries + SparseGrid_find(row, column_first), *end = row->entries + row->count; e < end && e->column <= column_last; ++e)
+        {
+            if (axis == AGGREGATE_AXIS_COLUMNS)
+                a = results + ((long long)e->column - column_start) * column_sign;
+
+            double value;
+            if (GridCell_toDouble(e->cell, &value) == REDISMODULE_OK)
+                Aggregate_add(a, value);
+        }
+    }
+}
+
+void SparseGrid_filterObject(const struct SparseGrid *o, const struct Filter *filter, uint64_t *bits)
+{
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        if (Filter_matchCell(filter, SparseGrid_getCell(o, r, filter->column)))
+            Filter_setBit(bits, r);
+    }
+}
+
+void SparseGrid_gatherColumn(struct SparseGrid *o, char **cells, long long column, long long row_start, long long row_end)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+        *cells++ = (char*)SparseGrid_getCell(o, (size_t)r, (size_t)column);
+}
+
+char *SparseGrid_rangeBlobObject(struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len)
+{
+    size_t rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    size_t columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    char **cells = (char**)RedisModule_Alloc(sizeof(char*) * rows);
+
+    size_t size = Blob_headerSize(columns);
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        SparseGrid_gatherColumn(o, cells, c, row_start, row_end);
+        size_t column_size = Blob_stringColumnSize(cells, rows);
+        if (column_size == BLOB_TOO_LARGE)
+        {
+            RedisModule_Free(cells);
+            return NULL;
+        }
+        size += column_size;
+    }
+
+    char *blob = (char*)RedisModule_Alloc(size);
+    char *p = Blob_writeHeader(blob, rows, columns);
+    size_t i = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        SparseGrid_gatherColumn(o, cells, c, row_start, row_end);
+        p = Blob_writeStringColumn(blob, p, i++, cells, rows);
+    }
+
+    RedisModule_Free(cells);
+
+    *len = size;
+    return blob;
+}
+
+int SparseGrid_getRangeValues(RedisModuleCtx *ctx, struct SparseGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end)
+{
+    int are_ranges_ok  =
+        GridType_getRangeValue(ctx, argv, 0, (long long)o->rows, row_start, "Start row must be an integer", "Start row outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 1, (long long)o->rows, row_end, "End row must be an integer", "End row outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 2, (long long)o->columns, column_start, "Start column must be an integer", "Start column outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 3, (long long)o->columns, column_end, "End column must be an integer", "End column outside the bounds of the grid") == REDISMODULE_OK;
+    return are_ranges_ok ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+int SparseGrid_getShape(RedisModuleCtx *ctx, struct SparseGrid *o)
+{
+    RedisModule_ReplyWithArray(ctx, (long)2);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->rows);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->columns);
+    return REDISMODULE_OK;
+}
+
+int SparseGrid_dump(RedisModuleCtx *ctx, struct SparseGrid *o)
+{
+    RedisModule_ReplyWithArray(ctx, (long) (2 + o->rows * o->columns));
+
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->rows);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->columns);
+
+    for (struct SparseRow *r = o->rstart; r < o->rend; ++r)
+    {
+        const struct SparseEntry *e = r->entries, *end = r->entries + r->count;
+        for (size_t c = 0; c < o->columns; ++c)
+        {
+            if (e < end && e->column == c)
+                GridCell_reply(ctx, (e++)->cell);
+            else
+                RedisModule_ReplyWithNull(ctx);
+        }
+    }
+
+    return REDISMODULE_OK;
+}
+
+// Version 0 saved every grid densely, whatever the storage type.
+struct SparseGrid* SparseGrid_rdbLoad(RedisModuleIO *rdb)
+{
+    size_t rows = (size_t) RedisModule_LoadUnsigned(rdb);
+    size_t columns = (size_t) RedisModule_LoadUnsigned(rdb);
+
+    struct SparseGrid *o = SparseGrid_createObject(rows, columns, NULL);
+
+    for (struct SparseRow *r = o->rstart; r < o->rend; ++r)
+    {
+        for (size_t c = 0; c < columns; ++c)
+        {
+            size_t l;
+            char *s = RedisModule_LoadStringBuffer(rdb, &l);
+            if (l > 1)
+                SparseGrid_setCell(&o->arena, r, c, s, l - 1);
+            RedisModule_Free(s);
+        }
+    }
+
+    return o;
+}
+
+// An empty grid of the right shape followed by a GRID.SET for each populated cell.
+void SparseGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct SparseGrid *o)
+{
+    RedisModule_EmitAOF(aof, "GRID.DIM", "sll", key, (long long)o->rows, (long long)o->columns);
+
+    for (struct SparseRow *r = o->rstart; r < o->rend; ++r)
+    {
+        long long row = (long long)(r - o->rstart);
+        for (struct SparseEntry *e = r->entries, *end = r->entries + r->count; e < end; ++e)
+            RedisModule_EmitAOF(aof, "GRID.SET", "sllllb", key, row, row, (long long)e->column, (long long)e->column, GridCell_data(e->cell), GridCell_length(e->cell));
+    }
+}
+
+size_t SparseGrid_memUsage(const struct SparseGrid *o)
+{
+    size_t size = sizeof(*o) + sizeof(struct SparseRow) * o->rows + Arena_memUsage(&o->arena);
+    for (const struct SparseRow *r = o->rstart; r < o->rend; ++r)
+        size += sizeof(struct SparseEntry) * r->capacity;
+    return size;
+}
+
+void SparseGrid_digest(RedisModuleDigest *md, struct SparseGrid *o)
+{
+    RedisModule_DigestAddLongLong(md, o->rows);
+    RedisModule_DigestAddLongLong(md, o->columns);
+
+    for (struct SparseRow *r = o->rstart; r < o->rend; ++r)
+    {
+        const struct SparseEntry *e = r->entries, *end = r->entries + r->count;
+        for (size_t c = 0; c < o->columns; ++c)
+        {
+            if (e < end && e->column == c)
+            {
+                RedisModule_DigestAddStringBuffer(md, (unsigned char*)GridCell_data(e->cell), GridCell_length(e->cell) + 1);
+                ++e;
+            }
+            else
+                RedisModule_DigestAddStringBuffer(md, (unsigned char*)"", 1);
+        }
+    }
+
+    RedisModule_DigestEndSequence(md);
+}
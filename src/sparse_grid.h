@@ -0,0 +1,79 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __SPARSE_GRID_H
+#define  __SPARSE_GRID_H
+
+#include "redismodule.h"
+#include "arena.h"
+#include "aggregate.h"
+#include "filter.h"
+#include "blob.h"
+
+#define SPARSE_MIN_ROW_CAPACITY 4
+
+struct SparseEntry {
+    size_t column;
+    char *cell;
+};
+
+// The populated cells of a row, sorted by column. Empty rows hold no entries.
+struct SparseRow {
+    size_t count;
+    size_t capacity;
+    struct SparseEntry *entries;
+};
+
+struct SparseGrid {
+    size_t rows;
+    size_t columns;
+    struct SparseRow *rstart;
+    struct SparseRow *rend;
+    struct Arena arena;
+};
+
+struct SparseGrid *SparseGrid_createObject(size_t rows, size_t columns, RedisModuleString** source);
+struct SparseGrid *SparseGrid_copyObject(const struct SparseGrid *o);
+void SparseGrid_releaseObject(struct SparseGrid *o);
+void SparseGrid_compact(struct SparseGrid *o);
+const char *SparseGrid_getCell(const struct SparseGrid *o, size_t row, size_t column);
+int SparseGrid_setObject(struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source);
+int SparseGrid_setBlobObject(struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob);
+int SparseGrid_resizeAndCopyObject(struct SparseGrid *o, size_t rows, size_t columns);
+int SparseGrid_resizeAndReplaceObject(struct SparseGrid *o, size_t rows, size_t columns, RedisModuleString **source);
+void SparseGrid_rangeObject(RedisModuleCtx *ctx, struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void SparseGrid_replyColumns(RedisModuleCtx *ctx, struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void SparseGrid_aggregateObject(struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results);
+void SparseGrid_filterObject(const struct SparseGrid *o, const struct Filter *filter, uint64_t *bits);
+char *SparseGrid_rangeBlobObject(struct SparseGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len);
+int SparseGrid_getRangeValues(RedisModuleCtx *ctx, struct SparseGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end);
+int SparseGrid_getShape(RedisModuleCtx *ctx, struct SparseGrid* o);
+int SparseGrid_dump(RedisModuleCtx *ctx, struct SparseGrid* o);
+struct SparseGrid* SparseGrid_rdbLoad(RedisModuleIO *rdb);
+void SparseGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct SparseGrid *o);
+size_t SparseGrid_memUsage(const struct SparseGrid *o);
+void SparseGrid_digest(RedisModuleDigest *md, struct SparseGrid *o);
+
+#endif // __SPARSE_GRID_H
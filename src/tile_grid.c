@@ -0,0 +1,610 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "utils.h"
+#include "aof.h"
+#include "tile_grid.h"
+
+size_t TileGrid_tileCount(size_t len)
+{
+    return (len + TILE_GRID_MASK) >> TILE_GRID_SHIFT;
+}
+
+static inline struct TileGridTile *TileGrid_header(char **tile)
+{
+    return (struct TileGridTile*)((char*)tile - offsetof(struct TileGridTile, cells));
+}
+
+char **TileGrid_allocTile(void)
+{
+    struct TileGridTile *tile = (struct TileGridTile*)RedisModule_Calloc(1, sizeof(struct TileGridTile) + sizeof(char*) * TILE_GRID_CELLS);
+    if (!tile)
+        return NULL;
+
+    tile->refcount = 1;
+    return tile->cells;
+}
+
+void TileGrid_freeTile(char **tile)
+{
+    if (tile && --TileGrid_header(tile)->refcount == 0)
+        RedisModule_Free(TileGrid_header(tile));
+}
+
+int TileGrid_isShared(char **tile)
+{
+    return TileGrid_header(tile)->refcount > 1;
+}
+
+// Gives the grid its own copy of a tile it shares with another grid, so the tile can be written to.
+char **TileGrid_ownTile(char ***t)
+{
+    if (!TileGrid_isShared(*t))
+        return *t;
+
+    char **tile = TileGrid_allocTile();
+    if (!tile)
+        return NULL;
+
+    memcpy(tile, *t, sizeof(char*) * TILE_GRID_CELLS);
+    TileGrid_freeTile(*t);
+    *t = tile;
+    return tile;
+}
+
+char *TileGrid_getCell(const struct TileGrid *o, size_t row, size_t column)
+{
+    char **tile = o->tiles[(row >> TILE_GRID_SHIFT) * o->tile_columns + (column >> TILE_GRID_SHIFT)];
+    return tile ? tile[((row & TILE_GRID_MASK) << TILE_GRID_SHIFT) + (column & TILE_GRID_MASK)] : NULL;
+}
+
+int TileGrid_setString(struct TileGrid *o, size_t row, size_t column, const char *data, size_t len)
+{
+    char ***tile = o->tiles + (row >> TILE_GRID_SHIFT) * o->tile_columns + (column >> TILE_GRID_SHIFT);
+
+    // Clearing a cell never needs a tile to be allocated.
+    if (!*tile)
+    {
+        if (!data || len == 0)
+            return REDISMODULE_OK;
+
+        *tile = TileGrid_allocTile();
+        if (!*tile)
+            return REDISMODULE_ERR;
+    }
+    else if (!TileGrid_ownTile(tile))
+        return REDISMODULE_ERR;
+
+    return GridType_resetString(&o->arena, data, len, *tile + ((row & TILE_GRID_MASK) << TILE_GRID_SHIFT) + (column & TILE_GRID_MASK));
+}
+
+int TileGrid_setRedisString(struct TileGrid *o, size_t row, size_t column, RedisModuleString *source)
+{
+    size_t len;
+    const char *data = RedisModule_StringPtrLen(source, &len);
+    return TileGrid_setString(o, row, column, data, len);
+}
+
+void TileGrid_clearTile(struct Arena *arena, char **tile, size_t rows, size_t columns)
+{
+    // Clears the cells of the tile outside the first rows and columns.
+    for (size_t i = 0; i < TILE_GRID_SIZE; ++i)
+    {
+        for (char **p = tile + (i << TILE_GRID_SHIFT) + (i < rows ? columns : 0), **end = tile + ((i + 1) << TILE_GRID_SHIFT); p < end; ++p)
+        {
+            if (*p)
+            {
+                Arena_release(arena, GridCell_size(*p));
+                *p = NULL;
+            }
+        }
+    }
+}
+
+void TileGrid_freeTiles(struct TileGrid *o)
+{
+    for (char ***t = o->tiles, ***end = o->tiles + o->tile_rows * o->tile_columns; t < end; ++t)
+        TileGrid_freeTile(*t);
+}
+
+int TileGrid_copyRedisStrings(struct TileGrid *o, RedisModuleString **source)
+{
+    if (!source)
+        return REDISMODULE_OK;
+
+    if (Arena_reserve(&o->arena, GridType_measureRedisStrings(source, o->rows * o->columns)) != REDISMODULE_OK)
+        return REDISMODULE_ERR;
+
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        for (size_t c = 0; c < o->columns; ++c, ++source)
+        {
+            if (TileGrid_setRedisString(o, r, c, *source) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    return REDISMODULE_OK;
+}
+
+struct TileGrid *TileGrid_createObject(size_t rows, size_t columns, RedisModuleString **source)
+{
+    struct TileGrid *o = (struct TileGrid *)RedisModule_Alloc(sizeof(struct TileGrid));
+    if (!o)
+        return NULL;
+
+    Arena_init(&o->arena);
+
+    o->rows = rows;
+    o->columns = columns;
+    o->tile_rows = TileGrid_tileCount(rows);
+    o->tile_columns = TileGrid_tileCount(columns);
+    o->tiles = (char***)RedisModule_Calloc(o->tile_rows * o->tile_columns, sizeof(char**));
+    if (!o->tiles && o->tile_rows * o->tile_columns > 0)
+    {
+        RedisModule_Free(o);
+        return NULL;
+    }
+
+    if (TileGrid_copyRedisStrings(o, source) != REDISMODULE_OK)
+    {
+        TileGrid_releaseObject(o);
+        return NULL;
+    }
+
+    return o;
+}
+
+struct TileGrid *TileGrid_copyObject(const struct TileGrid *o)
+{
+    struct TileGrid *copy = (struct TileGrid *)RedisModule_Alloc(sizeof(struct TileGrid));
+    if (!copy)
+        return NULL;
+
+    size_t len = o->tile_rows * o->tile_columns;
+    copy->tiles = (char***)RedisModule_Alloc(sizeof(char**) * len);
+    if (!copy->tiles && len > 0)
+    {
+        RedisModule_Free(copy);
+        return NULL;
+    }
+
+    // The tiles and their cells are shared until one of the grids writes to them.
+    memcpy(copy->tiles, o->tiles, sizeof(char**) * len);
+    for (char ***t = o->tiles, ***end = o->tiles + len; t < end; ++t)
+    {
+        if (*t)
+            ++TileGrid_header(*t)->refcount;
+    }
+
+    copy->rows = o->rows;
+    copy->columns = o->columns;
+    copy->tile_rows = o->tile_rows;
+    copy->tile_columns = o->tile_columns;
+    Arena_share(&copy->arena, &o->arena);
+
+    return copy;
+}
+
+void TileGrid_releaseObject(struct TileGrid *o)
+{
+    Arena_free(&o->arena);
+    TileGrid_freeTiles(o);
+    RedisModule_Free(o->tiles);
+    RedisModule_Free(o);
+}
+
+void TileGrid_compact(struct TileGrid *o)
+{
+    // Every cell is moved, so the grid can no longer share any tiles.
+    for (char ***t = o->tiles, ***tend = o->tiles + o->tile_rows * o->tile_columns; t < tend; ++t)
+    {
+        if (*t && !TileGrid_ownTile(t))
+            return;
+    }
+
+    struct Arena arena;
+    Arena_init(&arena);
+    if (Arena_reserve(&arena, Arena_liveBytes(&o->arena)) != REDISMODULE_OK)
+        return;
+
+    for (char ***t = o->tiles, ***tend = o->tiles + o->tile_rows * o->tile_columns; t < tend; ++t)
+    {
+        if (!*t)
+            continue;
+
+        for (char **p = *t, **end = *t + TILE_GRID_CELLS; p < end; ++p)
+        {
+            if (*p)
+                *p = GridCell_copy(&arena, *p);
+        }
+    }
+
+    Arena_free(&o->arena);
+    o->arena = arena;
+}
+
+int TileGrid_setObject(struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+    {
+        for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++source)
+        {
+            if (TileGrid_setRedisString(o, (size_t)r, (size_t)c, *source) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (Arena_shouldCompact(&o->arena))
+        TileGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int TileGrid_setBlobObject(struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    // The blob is column oriented, so fill the range a column at a time.
+    size_t j = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign, ++j)
+    {
+        size_t i = 0;
+        for (long long r = row_start; r != row_end + row_sign; r += row_sign, ++i)
+        {
+            char buf[GRID_NUMBER_BUFSIZE];
+            size_t len;
+            const char *text = Blob_formatCell(blob, j, i, buf, &len);
+            if (TileGrid_setString(o, (size_t)r, (size_t)c, text, len) != REDISMODULE_OK)
+                return REDISMODULE_ERR;
+        }
+    }
+
+    if (Arena_shouldCompact(&o->arena))
+        TileGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+// Whether a tile which is kept holds cells beyond the new bounds of the grid.
+int TileGrid_isTrimmed(const struct TileGrid *o, size_t tr, size_t tc, size_t rows, size_t columns)
+{
+    return rows < min((tr + 1) << TILE_GRID_SHIFT, o->rows) || columns < min((tc + 1) << TILE_GRID_SHIFT, o->columns);
+}
+
+int TileGrid_resizeAndCopyObject(struct TileGrid *o, size_t rows, size_t columns)
+{
+    if (rows == o->rows && columns == o->columns)
+        return REDISMODULE_OK;
+
+    size_t tile_rows = TileGrid_tileCount(rows);
+    size_t tile_columns = TileGrid_tileCount(columns);
+
+    // The edge tiles which are kept and lose cells can not be shared.
+    for (size_t tr = 0; tr < min(tile_rows, o->tile_rows); ++tr)
+    {
+        for (size_t tc = 0; tc < min(tile_columns, o->tile_columns); ++tc)
+        {
+            char ***tile = o->tiles + tr * o->tile_columns + tc;
+            if (*tile && TileGrid_isTrimmed(o, tr, tc, rows, columns) && !TileGrid_ownTile(tile))
+                return REDISMODULE_ERR;
+        }
+    }
+
+    char ***tiles = (char***)RedisModule_Calloc(tile_rows * tile_columns, sizeof(char**));
+    if (!tiles && tile_rows * tile_columns > 0)
+        return REDISMODULE_ERR;
+
+    // Only the tiles on the new edges have cells to clear, and the tiles
+    // beyond them are dropped. The remaining tiles are moved, not copied.
+    for (size_t tr = 0; tr < o->tile_rows; ++tr)
+    {
+        for (size_t tc = 0; tc < o->tile_columns; ++tc)
+        {
+            char ***tile = o->tiles + tr * o->tile_columns + tc;
+            if (!*tile)
+                continue;
+
+            if (tr >= tile_rows || tc >= tile_columns)
+            {
+                // The cells of a shared tile are still in use by the other grid.
+                if (!TileGrid_isShared(*tile))
+                    TileGrid_clearTile(&o->arena, *tile, 0, 0);
+                TileGrid_freeTile(*tile);
+                continue;
+            }
+
+            if (TileGrid_isTrimmed(o, tr, tc, rows, columns))
+            {
+                size_t row_limit = min(rows - (tr << TILE_GRID_SHIFT), (size_t)TILE_GRID_SIZE);
+                size_t column_limit = min(columns - (tc << TILE_GRID_SHIFT), (size_t)TILE_GRID_SIZE);
+                TileGrid_clearTile(&o->arena, *tile, row_limit, column_limit);
+            }
+
+            tiles[tr * tile_columns + tc] = *tile;
+        }
+    }
+
+    RedisModule_Free(o->tiles);
+    o->rows = rows;
+    o->columns = columns;
+    o->tile_rows = tile_rows;
+    o->tile_columns = tile_columns;
+    o->tiles = tiles;
+
+    if (Arena_shouldCompact(&o->arena))
+        TileGrid_compact(o);
+
+    return REDISMODULE_OK;
+}
+
+int TileGrid_resizeAndReplaceObject(struct TileGrid *o, size_t rows, size_t columns, RedisModuleString **source)
+{
+    if (rows == o->rows && columns == o->columns)
+        return TileGrid_setObject(o, 0, rows - 1, 0, columns - 1, source);
+
+    // Every value is replaced, so build a new grid and drop the old storage whole.
+    struct TileGrid *replacement = TileGrid_createObject(rows, columns, source);
+    if (!replacement)
+        return REDISMODULE_ERR;
+
+    Arena_free(&o->arena);
+    TileGrid_freeTiles(o);
+    RedisModule_Free(o->tiles);
+
+    *o = *replacement;
+    RedisModule_Free(replacement);
+
+    return REDISMODULE_OK;
+}
+
+void TileGrid_rangeObject(RedisModuleCtx *ctx, struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    long long rows = 1 + (max(row_start, row_end) - min(row_start, row_end)) / row_step;
+    long long columns = 1 + (max(column_start, column_end) - min(column_start, column_end)) / column_step;
+    RedisModule_ReplyWithArray(ctx, (long)(rows * columns));
+
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+    {
+        for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+            GridCell_reply(ctx, TileGrid_getCell(o, (size_t)r, (size_t)c));
+    }
+}
+
+// Replies the cells of the range a column at a time, without an array header.
+void TileGrid_replyColumns(RedisModuleCtx *ctx, struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step)
+{
+    long long row_stride = row_start < row_end ? row_step : -row_step;
+    long long column_stride = column_start < column_end ? column_step : -column_step;
+
+    for (long long c = column_start; c != column_end + column_stride; c += column_stride)
+    {
+        for (long long r = row_start; r != row_end + row_stride; r += row_stride)
+            GridCell_reply(ctx, TileGrid_getCell(o, (size_t)r, (size_t)c));
+    }
+}
+
+void TileGrid_aggregateObject(struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    struct Aggregate *a = results;
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+    {
+        if (axis == AGGREGATE_AXIS_ROWS)
+            a = results + (r - row_start) * row_sign;
+
+        for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+        {
+            if (axis == AGGREGATE_AXIS_COLUMNS)
+                a = results + (c - column_start) * column_sign;
+
+            double value;
+            if (GridCell_toDouble(TileGrid_getCell(o, (size_t)r, (size_t)c), &value) == REDISMODULE_OK)
+                Aggregate_add(a, value);
+        }
+    }
+}
+
+void TileGrid_filterObject(const struct TileGrid *o, const struct Filter *filter, uint64_t *bits)
+{
+    size_t column = filter->column & TILE_GRID_MASK;
+
+    // Tiles which were never written to hold no cells, so their rows are skipped.
+    for (size_t t = 0; t < o->tile_rows; ++t)
+    {
+        char **tile = o->tiles[t * o->tile_columns + (filter->column >> TILE_GRID_SHIFT)];
+        if (!tile)
+            continue;
+
+        size_t row_end = min(o->rows, (t + 1) << TILE_GRID_SHIFT);
+        for (size_t r = t << TILE_GRID_SHIFT; r < row_end; ++r)
+        {
+            if (Filter_matchCell(filter, tile[((r & TILE_GRID_MASK) << TILE_GRID_SHIFT) + column]))
+                Filter_setBit(bits, r);
+        }
+    }
+}
+
+void TileGrid_gatherColumn(struct TileGrid *o, char **cells, long long column, long long row_start, long long row_end)
+{
+    long long row_sign = row_start < row_end ? 1 : -1;
+
+    for (long long r = row_start; r != row_end + row_sign; r += row_sign)
+        *cells++ = TileGrid_getCell(o, (size_t)r, (size_t)column);
+}
+
+char *TileGrid_rangeBlobObject(struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len)
+{
+    size_t rows = 1 + (max(row_start, row_end) - min(row_start, row_end));
+    size_t columns = 1 + (max(column_start, column_end) - min(column_start, column_end));
+    long long column_sign = column_start < column_end ? 1 : -1;
+
+    char **cells = (char**)RedisModule_Alloc(sizeof(char*) * rows);
+
+    size_t size = Blob_headerSize(columns);
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        TileGrid_gatherColumn(o, cells, c, row_start, row_end);
+        size_t column_size = Blob_stringColumnSize(cells, rows);
+        if (column_size == BLOB_TOO_LARGE)
+        {
+            RedisModule_Free(cells);
+            return NULL;
+        }
+        size += column_size;
+    }
+
+    char *blob = (char*)RedisModule_Alloc(size);
+    char *p = Blob_writeHeader(blob, rows, columns);
+    size_t i = 0;
+    for (long long c = column_start; c != column_end + column_sign; c += column_sign)
+    {
+        TileGrid_gatherColumn(o, cells, c, row_start, row_end);
+        p = Blob_writeStringColumn(blob, p, i++, cells, rows);
+    }
+
+    RedisModule_Free(cells);
+
+    *len = size;
+    return blob;
+}
+
+int TileGrid_getRangeValues(RedisModuleCtx *ctx, struct TileGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end)
+{
+    int are_ranges_ok  =
+        GridType_getRangeValue(ctx, argv, 0, (long long)o->rows, row_start, "Start row must be an integer", "Start row outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 1, (long long)o->rows, row_end, "End row must be an integer", "End row outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 2, (long long)o->columns, column_start, "Start column must be an integer", "Start column outside the bounds of the grid") == REDISMODULE_OK &&
+        GridType_getRangeValue(ctx, argv, 3, (long long)o->columns, column_end, "End column must be an integer", "End column outside the bounds of the grid") == REDISMODULE_OK;
+    return are_ranges_ok ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+int TileGrid_getShape(RedisModuleCtx *ctx, struct TileGrid *o)
+{
+    RedisModule_ReplyWithArray(ctx, (long)2);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->rows);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->columns);
+    return REDISMODULE_OK;
+}
+
+int TileGrid_dump(RedisModuleCtx *ctx, struct TileGrid *o)
+{
+    RedisModule_ReplyWithArray(ctx, (long) (2 + o->rows * o->columns));
+
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->rows);
+    RedisModule_ReplyWithLongLong(ctx, (long long)o->columns);
+
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        for (size_t c = 0; c < o->columns; ++c)
+            GridCell_reply(ctx, TileGrid_getCell(o, r, c));
+    }
+
+    return REDISMODULE_OK;
+}
+
+struct TileGrid *TileGrid_rdbLoad(RedisModuleIO *rdb)
+{
+    size_t rows = (size_t) RedisModule_LoadUnsigned(rdb);
+    size_t columns = (size_t) RedisModule_LoadUnsigned(rdb);
+
+    struct TileGrid *o = TileGrid_createObject(rows, columns, NULL);
+
+    for (size_t r = 0; r < rows; ++r)
+    {
+        for (size_t c = 0; c < columns; ++c)
+        {
+            size_t l;
+            char *s = RedisModule_LoadStringBuffer(rdb, &l);
+            if (l > 1)
+                TileGrid_setString(o, r, c, s, l - 1);
+            RedisModule_Free(s);
+        }
+    }
+
+    return o;
+}
+
+void TileGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct TileGrid *o) 
+{
+    struct AofWriter writer;
+    Aof_open(&writer, aof, key, o->rows, o->columns);
+
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        for (size_t c = 0; c < o->columns; ++c)
+        {
+            char *cell = TileGrid_getCell(o, r, c);
+            if (cell)
+                Aof_writeCell(&writer, GridCell_data(cell), GridCell_length(cell));
+            else
+                Aof_writeCell(&writer, NULL, 0);
+        }
+    }
+
+    Aof_close(&writer);
+}
+
+size_t TileGrid_memUsage(const struct TileGrid *o) 
+{
+    // Shared tiles are counted in equal parts by the grids sharing them.
+    size_t size = sizeof(*o) + sizeof(char**) * o->tile_rows * o->tile_columns + Arena_memUsage(&o->arena);
+    for (char ***t = o->tiles, ***end = o->tiles + o->tile_rows * o->tile_columns; t < end; ++t)
+    {
+        if (*t)
+            size += (sizeof(struct TileGridTile) + sizeof(char*) * TILE_GRID_CELLS) / TileGrid_header(*t)->refcount;
+    }
+    return size;
+}
+
+void TileGrid_digest(RedisModuleDigest *md, struct TileGrid *o)
+{
+    RedisModule_DigestAddLongLong(md, o->rows);
+    RedisModule_DigestAddLongLong(md, o->columns);
+    for (size_t r = 0; r < o->rows; ++r)
+    {
+        for (size_t c = 0; c < o->columns; ++c)
+        {
+            char *cell = TileGrid_getCell(o, r, c);
+            if (cell)
+                RedisModule_DigestAddStringBuffer(md, (unsigned char*)GridCell_data(cell), GridCell_length(cell) + 1);
+            else
+                RedisModule_DigestAddStringBuffer(md, (unsigned char*)"", 1);
+        }
+    }
+    RedisModule_DigestEndSequence(md);
+}
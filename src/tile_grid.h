@@ -0,0 +1,81 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __TILE_GRID_H
+#define  __TILE_GRID_H
+
+#include "redismodule.h"
+#include "arena.h"
+#include "aggregate.h"
+#include "filter.h"
+#include "blob.h"
+
+#define TILE_GRID_SHIFT 6
+#define TILE_GRID_SIZE (1 << TILE_GRID_SHIFT)
+#define TILE_GRID_MASK (TILE_GRID_SIZE - 1)
+#define TILE_GRID_CELLS (TILE_GRID_SIZE * TILE_GRID_SIZE)
+
+// Each tile is allocated behind a reference count so a copy of the grid can
+// share it until one of the grids writes to the tile.
+struct TileGridTile {
+    size_t refcount;
+    char *cells[];
+};
+
+// The grid is cut into square tiles which are stored row major. A tile is
+// only allocated when a value is written to it, and cells outside the grid
+// in the edge tiles are always empty.
+struct TileGrid {
+    size_t rows;
+    size_t columns;
+    size_t tile_rows;
+    size_t tile_columns;
+    char ***tiles;
+    struct Arena arena;
+};
+
+struct TileGrid *TileGrid_createObject(size_t rows, size_t columns, RedisModuleString** source);
+struct TileGrid *TileGrid_copyObject(const struct TileGrid *o);
+void TileGrid_releaseObject(struct TileGrid *o);
+void TileGrid_compact(struct TileGrid *o);
+char *TileGrid_getCell(const struct TileGrid *o, size_t row, size_t column);
+int TileGrid_setObject(struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, RedisModuleString **source);
+int TileGrid_setBlobObject(struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, const struct BlobReader *blob);
+int TileGrid_resizeAndCopyObject(struct TileGrid *o, size_t rows, size_t columns);
+int TileGrid_resizeAndReplaceObject(struct TileGrid *o, size_t rows, size_t columns, RedisModuleString **source);
+void TileGrid_rangeObject(RedisModuleCtx *ctx, struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void TileGrid_replyColumns(RedisModuleCtx *ctx, struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, long long row_step, long long column_step);
+void TileGrid_aggregateObject(struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, int axis, struct Aggregate *results);
+void TileGrid_filterObject(const struct TileGrid *o, const struct Filter *filter, uint64_t *bits);
+char *TileGrid_rangeBlobObject(struct TileGrid *o, long long row_start, long long row_end, long long column_start, long long column_end, size_t *len);
+int TileGrid_getRangeValues(RedisModuleCtx *ctx, struct TileGrid *o, RedisModuleString **argv, long long *row_start, long long *row_end, long long *column_start, long long *column_end);
+int TileGrid_getShape(RedisModuleCtx *ctx, struct TileGrid* o);
+int TileGrid_dump(RedisModuleCtx *ctx, struct TileGrid* o);
+struct TileGrid* TileGrid_rdbLoad(RedisModuleIO *rdb);
+void TileGrid_aofRewrite(RedisModuleIO *aof, RedisModuleString *key, struct TileGrid *o);
+size_t TileGrid_memUsage(const struct TileGrid *o);
+void TileGrid_digest(RedisModuleDigest *md, struct TileGrid *o);
+
+#endif //  __TILE_GRID_H
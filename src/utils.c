@@ -23,10 +23,123 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <ctype.h>
 #include "utils.h"
 
-int GridType_setRedisString(RedisModuleString** source, char** destination)
+char *GridCell_create(struct Arena *arena, const char *data, size_t len)
+{
+    GridCellLength prefix = (GridCellLength)len;
+    char *cell = Arena_alloc(arena, sizeof(prefix) + len + 1);
+    if (!cell)
+        return NULL;
+
+    memcpy(cell, &prefix, sizeof(prefix));
+    memcpy(cell + sizeof(prefix), data, len);
+    cell[sizeof(prefix) + len] = '\0';
+    return cell;
+}
+
+char *GridCell_copy(struct Arena *arena, const char *cell)
+{
+    size_t size = GridCell_size(cell);
+    char *copy = Arena_alloc(arena, size);
+    if (copy)
+        memcpy(copy, cell, size);
+    return copy;
+}
+
+void GridCell_reply(RedisModuleCtx *ctx, const char *cell)
+{
+    if (cell)
+        RedisModule_ReplyWithStringBuffer(ctx, GridCell_data(cell), GridCell_length(cell));
+    else
+        RedisModule_ReplyWithNull(ctx);
+}
+
+int GridCell_toDouble(const char *cell, double *value)
+{
+    if (!cell)
+        return REDISMODULE_ERR;
+    return GridType_parseDouble(GridCell_data(cell), GridCell_length(cell), value);
+}
+
+size_t GridType_formatLongLong(long long value, char *buf)
+{
+    return (size_t)snprintf(buf, GRID_NUMBER_BUFSIZE, "%lld", value);
+}
+
+size_t GridType_formatDouble(double value, char *buf)
+{
+    // Use the shortest precision that reads back as the same value.
+    for (int precision = 15; precision < 17; ++precision)
+    {
+        size_t len = (size_t)snprintf(buf, GRID_NUMBER_BUFSIZE, "%.*g", precision, value);
+        if (strtod(buf, NULL) == value)
+            return len;
+    }
+
+    return (size_t)snprintf(buf, GRID_NUMBER_BUFSIZE, "%.17g", value);
+}
+
+// Only accepts text which formats back to exactly the same bytes.
+int GridType_parseLongLong(const char *s, size_t len, long long *value)
+{
+    char buf[GRID_NUMBER_BUFSIZE];
+    if (len == 0 || len >= sizeof(buf))
+        return REDISMODULE_ERR;
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+
+    char *end;
+    errno = 0;
+    *value = strtoll(buf, &end, 10);
+    if (errno != 0 || end != buf + len)
+        return REDISMODULE_ERR;
+
+    char text[GRID_NUMBER_BUFSIZE];
+    if (GridType_formatLongLong(*value, text) != len || memcmp(text, s, len) != 0)
+        return REDISMODULE_ERR;
+
+    return REDISMODULE_OK;
+}
+
+int GridType_parseDouble(const char *s, size_t len, double *value)
+{
+    char buf[GRID_NUMBER_BUFSIZE];
+    if (len == 0 || len >= sizeof(buf))
+        return REDISMODULE_ERR;
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+
+    // Reject the forms strtod accepts which are not plain decimal numbers.
+    if (isspace((unsigned char)buf[0]) || strpbrk(buf, "xXnN") != NULL)
+        return REDISMODULE_ERR;
+
+    char *end;
+    *value = strtod(buf, &end);
+    if (end != buf + len)
+        return REDISMODULE_ERR;
+
+    return REDISMODULE_OK;
+}
+
+size_t GridType_measureRedisStrings(RedisModuleString** source, size_t len)
+{
+    size_t total = 0;
+    for (RedisModuleString **end = source + len; source < end; ++source)
+    {
+        size_t l;
+        RedisModule_StringPtrLen(*source, &l);
+        total += l == 0 ? 0 : sizeof(GridCellLength) + l + 1;
+    }
+    return total;
+}
+
+int GridType_setRedisString(struct Arena *arena, RedisModuleString** source, char** destination)
 {
     if (*source)
     {
@@ -38,10 +151,9 @@ int GridType_setRedisString(RedisModuleString** source, char** destination)
         }
         else
         {
-            *destination = RedisModule_Alloc(len + 1);
+            *destination = GridCell_create(arena, str, len);
             if (!*destination)
                 return REDISMODULE_ERR;
-            memcpy((void*)*destination, (void*)str, len + 1);
         }
     }
     else
@@ -52,12 +164,116 @@ int GridType_setRedisString(RedisModuleString** source, char** destination)
     return REDISMODULE_OK;
 }
 
-int GridType_resetRedisString(RedisModuleString** source, char** destination)
+int GridType_resetRedisString(struct Arena *arena, RedisModuleString** source, char** destination)
+{
+    if (*destination)
+        Arena_release(arena, GridCell_size(*destination));
+
+    return GridType_setRedisString(arena, source, destination);
+}
+
+int GridType_resetString(struct Arena *arena, const char *data, size_t len, char **destination)
 {
     if (*destination)
-        RedisModule_Free(*destination);
+        Arena_release(arena, GridCell_size(*destination));
+
+    if (!data || len == 0)
+    {
+        *destination = NULL;
+        return REDISMODULE_OK;
+    }
+
+    *destination = GridCell_create(arena, data, len);
+    return *destination ? REDISMODULE_OK : REDISMODULE_ERR;
+}
+
+// Only the values too long to be held in a slot take space in the arena.
+size_t GridSlot_measureRedisStrings(RedisModuleString** source, size_t len)
+{
+    size_t total = 0;
+    for (RedisModuleString **end = source + len; source < end; ++source)
+    {
+        size_t l;
+        RedisModule_StringPtrLen(*source, &l);
+        total += l <= GRID_SLOT_INLINE ? 0 : sizeof(GridCellLength) + l + 1;
+    }
+    return total;
+}
+
+void GridSlot_clear(struct Arena *arena, struct GridSlot *slot)
+{
+    if (slot->tag == GRID_SLOT_CELL)
+        Arena_release(arena, GridCell_size(slot->cell));
+    slot->tag = 0;
+}
+
+int GridSlot_set(struct Arena *arena, const char *data, size_t len, struct GridSlot *slot)
+{
+    GridSlot_clear(arena, slot);
+
+    if (!data || len == 0)
+        return REDISMODULE_OK;
+
+    if (len <= GRID_SLOT_INLINE)
+    {
+        memcpy(slot->data, data, len);
+        slot->data[len] = '\0';
+        slot->tag = (unsigned char)len;
+        return REDISMODULE_OK;
+    }
+
+    slot->cell = GridCell_create(arena, data, len);
+    if (!slot->cell)
+        return REDISMODULE_ERR;
+    slot->tag = GRID_SLOT_CELL;
+    return REDISMODULE_OK;
+}
+
+int GridSlot_setRedisString(struct Arena *arena, RedisModuleString *source, struct GridSlot *slot)
+{
+    size_t len = 0;
+    const char *data = source ? RedisModule_StringPtrLen(source, &len) : NULL;
+    return GridSlot_set(arena, data, len, slot);
+}
+
+// Moves a value which is held out of line into the given arena.
+int GridSlot_copy(struct Arena *arena, struct GridSlot *slot)
+{
+    if (slot->tag != GRID_SLOT_CELL)
+        return REDISMODULE_OK;
+
+    char *cell = GridCell_copy(arena, slot->cell);
+    if (!cell)
+        return REDISMODULE_ERR;
+    slot->cell = cell;
+    return REDISMODULE_OK;
+}
+
+// Returns the value as a cell, making one in the scratch arena when it is held inline.
+char *GridSlot_toCell(struct Arena *scratch, const struct GridSlot *slot)
+{
+    if (slot->tag == GRID_SLOT_CELL)
+        return slot->cell;
+    return slot->tag ? GridCell_create(scratch, slot->data, slot->tag) : NULL;
+}
 
-    return GridType_setRedisString(source, destination);
+void GridSlot_reply(RedisModuleCtx *ctx, const struct GridSlot *slot)
+{
+    size_t len;
+    const char *data = GridSlot_data(slot, &len);
+    if (data)
+        RedisModule_ReplyWithStringBuffer(ctx, data, len);
+    else
+        RedisModule_ReplyWithNull(ctx);
+}
+
+int GridSlot_toDouble(const struct GridSlot *slot, double *value)
+{
+    size_t len;
+    const char *data = GridSlot_data(slot, &len);
+    if (!data)
+        return REDISMODULE_ERR;
+    return GridType_parseDouble(data, len, value);
 }
 
 int GridType_getRangeValue(RedisModuleCtx *ctx, RedisModuleString **argv, int argi, long long max_value, long long* range_value, const char* type_errmsg, const char* bounds_errmsg)
@@ -26,7 +26,10 @@
 #ifndef __UTILS_H
 #define __UTILS_H
 
+#include <stdint.h>
+#include <string.h>
 #include "redismodule.h"
+#include "arena.h"
 
 #define max(a,b) \
    ({ __typeof__ (a) _a = (a); \
@@ -38,8 +41,87 @@
        __typeof__ (b) _b = (b); \
      _a <= _b ? _a : _b; })
 
-int GridType_setRedisString(RedisModuleString** source, char** destination);
-int GridType_resetRedisString(RedisModuleString** source, char** destination);
+// A cell is stored in the grid's arena as a length prefix, the raw bytes, and a
+// terminating NUL so the bytes can also be handed to C string functions.
+typedef uint32_t GridCellLength;
+
+static inline size_t GridCell_length(const char *cell)
+{
+    GridCellLength len;
+    memcpy(&len, cell, sizeof(len));
+    return len;
+}
+
+static inline const char *GridCell_data(const char *cell)
+{
+    return cell + sizeof(GridCellLength);
+}
+
+static inline size_t GridCell_size(const char *cell)
+{
+    return sizeof(GridCellLength) + GridCell_length(cell) + 1;
+}
+
+// A slot holds a value of up to GRID_SLOT_INLINE bytes in place, followed by a
+// NUL, so a short value needs neither an arena cell nor a pointer to follow.
+// Longer values point to an arena cell. The last byte is the length of an
+// inline value, 0 for an empty slot, or GRID_SLOT_CELL.
+#define GRID_SLOT_SIZE 16
+#define GRID_SLOT_INLINE (GRID_SLOT_SIZE - 2)
+#define GRID_SLOT_CELL 0xff
+
+struct GridSlot {
+    union {
+        struct {
+            char data[GRID_SLOT_SIZE - 1];
+            unsigned char tag;
+        };
+        char *cell;
+    };
+};
+
+static inline int GridSlot_isEmpty(const struct GridSlot *slot)
+{
+    return slot->tag == 0;
+}
+
+static inline const char *GridSlot_data(const struct GridSlot *slot, size_t *len)
+{
+    if (slot->tag == GRID_SLOT_CELL)
+    {
+        *len = GridCell_length(slot->cell);
+        return GridCell_data(slot->cell);
+    }
+
+    *len = slot->tag;
+    return slot->tag ? slot->data : NULL;
+}
+
+char *GridCell_create(struct Arena *arena, const char *data, size_t len);
+char *GridCell_copy(struct Arena *arena, const char *cell);
+void GridCell_reply(RedisModuleCtx *ctx, const char *cell);
+int GridCell_toDouble(const char *cell, double *value);
+
+// Large enough for the canonical text of any int64 or double.
+#define GRID_NUMBER_BUFSIZE 32
+
+size_t GridType_formatLongLong(long long value, char *buf);
+size_t GridType_formatDouble(double value, char *buf);
+int GridType_parseLongLong(const char *s, size_t len, long long *value);
+int GridType_parseDouble(const char *s, size_t len, double *value);
+
+size_t GridType_measureRedisStrings(RedisModuleString** source, size_t len);
+int GridType_setRedisString(struct Arena *arena, RedisModuleString** source, char** destination);
+int GridType_resetRedisString(struct Arena *arena, RedisModuleString** source, char** destination);
+int GridType_resetString(struct Arena *arena, const char *data, size_t len, char **destination);
+size_t GridSlot_measureRedisStrings(RedisModuleString** source, size_t len);
+void GridSlot_clear(struct Arena *arena, struct GridSlot *slot);
+int GridSlot_set(struct Arena *arena, const char *data, size_t len, struct GridSlot *slot);
+int GridSlot_setRedisString(struct Arena *arena, RedisModuleString *source, struct GridSlot *slot);
+int GridSlot_copy(struct Arena *arena, struct GridSlot *slot);
+char *GridSlot_toCell(struct Arena *scratch, const struct GridSlot *slot);
+void GridSlot_reply(RedisModuleCtx *ctx, const struct GridSlot *slot);
+int GridSlot_toDouble(const struct GridSlot *slot, double *value);
 int GridType_getRangeValue(RedisModuleCtx *ctx, RedisModuleString **argv, int argi, long long max_value, long long* range_value, const char* type_errmsg, const char* bounds_errmsg);
 
 #endif //  __UTILS_H
\ No newline at end of file
@@ -0,0 +1,106 @@
+/* Copyright (c) 2018, Rob Blackbourn
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *   * Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above copyright
+ *     notice, this list of conditions and the following disclaimer in the
+ *     documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+
+#include "redismodule.h"
+#include "worker.h"
+
+struct WorkerJob {
+    WorkerFunc run;
+    void *arg;
+    struct WorkerJob *next;
+};
+
+// A fixed pool of threads taking jobs from a single queue in submission order.
+static pthread_mutex_t worker_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t worker_ready = PTHREAD_COND_INITIALIZER;
+static struct WorkerJob *worker_head = NULL;
+static struct WorkerJob *worker_tail = NULL;
+static size_t worker_count = 0;
+
+static void *Worker_main(void *unused)
+{
+    (void)unused;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&worker_lock);
+        while (!worker_head)
+            pthread_cond_wait(&worker_ready, &worker_lock);
+
+        struct WorkerJob *job = worker_head;
+        worker_head = job->next;
+        if (!worker_head)
+            worker_tail = NULL;
+        pthread_mutex_unlock(&worker_lock);
+
+        job->run(job->arg);
+        RedisModule_Free(job);
+    }
+
+    return NULL;
+}
+
+int Worker_start(size_t threads)
+{
+    for (size_t i = 0; i < threads; ++i)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, Worker_main, NULL) != 0)
+            return worker_count > 0 ? REDISMODULE_OK : REDISMODULE_ERR;
+        pthread_detach(thread);
+        ++worker_count;
+    }
+
+    return REDISMODULE_OK;
+}
+
+int Worker_isRunning(void)
+{
+    return worker_count > 0;
+}
+
+int Worker_submit(WorkerFunc run, void *arg)
+{
+    if (worker_count == 0)
+        return REDISMODULE_ERR;
+
+    struct WorkerJob *job = (struct WorkerJob*)RedisModule_Alloc(sizeof(struct WorkerJob));
+    job->run = run;
+    job->arg = arg;
+    job->next = NULL;
+
+    pthread_mutex_lock(&worker_lock);
+    if (worker_tail)
+        worker_tail->next = job;
+    else
+        worker_head = job;
+    worker_tail = job;
+    pthread_cond_signal(&worker_ready);
+    pthread_mutex_unlock(&worker_lock);
+
+    return REDISMODULE_OK;
+}